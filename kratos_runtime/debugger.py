@@ -1,15 +1,32 @@
 from urllib import request, error
+import http.client
 import json
+import socket
+
+
+class _UnixHTTPConnection(http.client.HTTPConnection):
+    def __init__(self, path):
+        super().__init__("localhost")
+        self.path = path
+
+    def connect(self):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(self.path)
 
 
 class DebuggerMock:
-    def __init__(self, port=8888, design=None, prefix_top=""):
+    def __init__(self, port=8888, design=None, prefix_top="", socket_path=None):
+        # if socket_path is set, e.g. the runtime's KRATOS_SOCKET, requests go
+        # through the Unix domain socket instead of TCP
         self.port = port
+        self.socket_path = socket_path
+        self._conn = None
         self.design = design
         self.regs = []
         self.values = []
         self._get_values()
         self.prefix_top = prefix_top
+        self._event_seq = 0
 
     @staticmethod
     def _get_json_header():
@@ -30,19 +47,44 @@ class DebuggerMock:
             self.values = _kratos.passes.extract_var_names(design)
 
     def _post(self, sub_url, header=None, data=None):
+        if self.socket_path:
+            return self._socket_request("POST", sub_url, header, data)
         r = request.Request(
             "http://localhost:{0}/{1}".format(self.port, sub_url),
             method="POST")
         return self.__get_data(r, header, data)
 
-    def _get(self, sub_url, header=None):
+    def _get(self, sub_url, header=None, data=None, raw=False):
+        if self.socket_path:
+            return self._socket_request("GET", sub_url, header, data, raw)
         r = request.Request(
             "http://localhost:{0}/{1}".format(self.port, sub_url),
             method="GET")
-        return self.__get_data(r, header)
+        return self.__get_data(r, header, data, raw)
+
+    def _socket_request(self, method, sub_url, header=None, data=None,
+                        raw=False):
+        # the connection is kept alive across requests
+        for retry in range(2):
+            if self._conn is None:
+                self._conn = _UnixHTTPConnection(self.socket_path)
+            try:
+                body = data.encode("utf-8") if data is not None else None
+                self._conn.request(method, "/" + sub_url, body,
+                                   header if header is not None else {})
+                resp = self._conn.getresponse()
+                result = resp.read()
+            except (OSError, http.client.HTTPException):
+                self._conn.close()
+                self._conn = None
+                continue
+            if resp.status != 200:
+                return None
+            return result if raw else result.decode("ascii")
+        return None
 
     @staticmethod
-    def __get_data(r, header, data=None):
+    def __get_data(r, header, data=None, raw=False):
         if header is not None:
             for k, v in header.items():
                 r.add_header(k, v)
@@ -53,6 +95,8 @@ class DebuggerMock:
             result = resp.read()
             if resp.code != 200:
                 return None
+            if raw:
+                return result
             return result.decode("ascii")
         except error.URLError as ex:
             return None
@@ -86,6 +130,24 @@ class DebuggerMock:
             sleep *= 2
         assert connected, "Unable to connect"
 
+    def connect_stream(self, database):
+        # subscribe to the runtime's event stream instead of running a server
+        data = {"database": database, "stream": True}
+        r = self._post("connect", header=self._get_json_header(),
+                       data=json.dumps(data))
+        assert r is not None, "Unable to connect"
+        self._event_seq = 0
+
+    def get_events(self, timeout=10000):
+        # long-poll the events since the last call
+        r = self._get("events?since={0}&timeout={1}".format(self._event_seq,
+                                                             timeout))
+        if r is None:
+            return []
+        result = json.loads(r)
+        self._event_seq = result["next"]
+        return result["events"]
+
     def wait_till_finish(self):
         import time
         while True:
@@ -116,10 +178,117 @@ class DebuggerMock:
             r = int(r)
         return r
 
+    def get_values(self, handle_names, binary=True):
+        # reads several values in one request. with binary, values are sent
+        # as msgpack at their full width instead of truncated to 32 bits
+        names = handle_names
+        if self.prefix_top:
+            names = [".".join([self.prefix_top, n]) for n in handle_names]
+        data = json.dumps(names)
+        if binary:
+            from .util import decode_msgpack
+            r = self._get("values", {"Accept": "application/msgpack"}, data,
+                          raw=True)
+            if r is None:
+                return None
+            entries = decode_msgpack(r)
+            values = [v for _, v in entries]
+        else:
+            r = self._get("values", self._get_json_header(), data)
+            if r is None:
+                return None
+            values = [None if e["value"] == "ERROR" else int(e["value"])
+                      for e in json.loads(r)]
+        return dict(zip(handle_names, values))
+
+    def batch(self, commands):
+        # commands is a list of (method, path) or (method, path, body). only
+        # read-only requests can be batched. returns one
+        # {"status", "content_type", "body"} per command
+        entries = []
+        for command in commands:
+            entry = {"method": command[0], "path": command[1]}
+            if len(command) > 2:
+                entry["body"] = command[2]
+            entries.append(entry)
+        r = self._post("batch", self._get_json_header(), json.dumps(entries))
+        assert r is not None, "Unable to run batch"
+        return json.loads(r)
+
+    def set_values(self, values, mode="deposit"):
+        # values is a dictionary of handle name -> value. wide values can be
+        # passed in as hex string, e.g. "0xdeadbeef"
+        entries = []
+        for handle_name, value in values.items():
+            if self.prefix_top:
+                handle_name = ".".join([self.prefix_top, handle_name])
+            # the runtime reads JSON numbers as doubles
+            if isinstance(value, int) and abs(value) > 1 << 53:
+                value = str(value)
+            entries.append({"handle": handle_name, "value": value,
+                            "mode": mode})
+        r = self._post("values", self._get_json_header(), json.dumps(entries))
+        assert r is not None, "Unable to set values"
+        return r
+
+    def add_monitors(self, handle_names):
+        # returns the monitor id of each signal, -1 if it's not found
+        r = self._post("monitors", self._get_json_header(),
+                       json.dumps(self._get_full_names(handle_names)))
+        assert r is not None, "Unable to add monitors"
+        return json.loads(r)
+
+    def remove_monitors(self, handle_names):
+        r = request.Request(
+            "http://localhost:{0}/monitors".format(self.port), method="DELETE")
+        data = json.dumps(self._get_full_names(handle_names))
+        if self.socket_path:
+            r = self._socket_request("DELETE", "monitors",
+                                     self._get_json_header(), data)
+        else:
+            r = self.__get_data(r, self._get_json_header(), data)
+        assert r is not None, "Unable to remove monitors"
+        return int(r)
+
+    def add_scope_monitor(self, scope):
+        # monitors every signal under the scope. returns the group id and
+        # the number of signals
+        name = self._get_full_names([scope])[0]
+        r = self._post("monitors/scope/" + name)
+        assert r is not None, "Unable to monitor scope " + scope
+        result = json.loads(r)
+        return result["group"], result["size"]
+
+    def enable_monitor_group(self, group, on=True):
+        r = self._post("monitors/group/{0}/{1}".format(
+            group, "enable" if on else "disable"))
+        assert r is not None, "Unable to change monitor group"
+
+    def remove_monitor_group(self, group):
+        sub_url = "monitors/group/{0}".format(group)
+        if self.socket_path:
+            r = self._socket_request("DELETE", sub_url)
+        else:
+            r = request.Request(
+                "http://localhost:{0}/{1}".format(self.port, sub_url),
+                method="DELETE")
+            r = self.__get_data(r, None)
+        assert r is not None, "Unable to remove monitor group"
+
+    def _get_full_names(self, handle_names):
+        if not self.prefix_top:
+            return list(handle_names)
+        return [".".join([self.prefix_top, n]) for n in handle_names]
+
     def set_pause_on_clock(self, on=True):
         r = self._post("clock/" + ("on" if on else "off"))
         assert r is not None, "Unable to pause on clock edge"
 
+    def set_time(self, time):
+        # only a paused replay (kratos-replay) can move to another time
+        r = self._post("time/{0}".format(int(time)))
+        assert r is not None, "Unable to move to time {0}".format(time)
+
     def get_all_reg_values(self, reg_only=True):
         values = {}
         vs = self.regs if reg_only else self.values
@@ -131,46 +300,116 @@ class DebuggerMock:
             values[name] = value
         return values
 
-    def get_io_values(self):
-        in_ = {}
-        out_ = {}
+    def _get_ports(self):
+        # returns (handle name, is input) for every port
+        ports = []
         if self.design is not None:
             import _kratos
             port_names = self.design.internal_generator.get_port_names()
             for port_name in port_names:
                 p = self.design.ports[port_name]
-                handle_name = p.handle_name()
-                v = self.get_value(handle_name)
-                if v is None:
-                    raise Exception(
-                        "Unable to get value for {0}. Got {1}".format(
-                            handle_name, v))
-                if p.port_direction == _kratos.PortDirection.In:
-                    in_[handle_name] = v
-                else:
-                    out_[handle_name] = v
+                ports.append((p.handle_name(),
+                              p.port_direction == _kratos.PortDirection.In))
+        return ports
+
+    def get_io_values(self):
+        in_ = {}
+        out_ = {}
+        for handle_name, is_input in self._get_ports():
+            v = self.get_value(handle_name)
+            if v is None:
+                raise Exception(
+                    "Unable to get value for {0}. Got {1}".format(
+                        handle_name, v))
+            if is_input:
+                in_[handle_name] = v
+            else:
+                out_[handle_name] = v
 
         return in_, out_
 
-    def record_state(self, num_wait_reset=1, reg_only=True):
-        # start the simulation until it ends
+    def start_capture(self, filename, handle_names, sample=False):
+        # the runtime writes the values of the signals at every clock edge to
+        # the file without pausing. with sample, the current state is captured
+        # as well. read the file with kratos_runtime.util.read_capture
+        import os
+        data = json.dumps({"filename": os.path.abspath(filename),
+                           "signals": self._get_full_names(handle_names),
+                           "sample": sample})
+        r = self._post("capture", self._get_json_header(), data)
+        assert r is not None, "Unable to start capture"
+
+    def stop_capture(self):
+        # returns the number of rows captured
+        if self.socket_path:
+            r = self._socket_request("DELETE", "capture")
+        else:
+            r = request.Request(
+                "http://localhost:{0}/capture".format(self.port),
+                method="DELETE")
+            r = self.__get_data(r, None)
+        assert r is not None, "Unable to stop capture"
+        return int(r)
+
+    def start_golden(self, filename, sample=False):
+        # the runtime compares the state at every clock edge with the trace
+        # and pauses at the first mismatch. with sample, the current state is
+        # compared with the first row
+        import os
+        data = json.dumps({"filename": os.path.abspath(filename),
+                           "sample": sample})
+        r = self._post("golden", self._get_json_header(), data)
+        assert r is not None, "Unable to start golden trace comparison"
+
+    def get_golden(self):
+        # the progress, or the mismatches once the comparison stopped
+        r = self._get("golden")
+        assert r is not None, "Unable to get golden trace comparison"
+        return json.loads(r)
+
+    def record_state(self, num_wait_reset=1, reg_only=True, filename=None):
+        # the runtime captures the state at every clock edge into a file, so
+        # the simulation runs without pausing until it ends
+        import os
+        import tempfile
+        from .util import read_capture
         assert self.is_paused()
         self.set_pause_on_clock(True)
         for _ in range(num_wait_reset):
             self.continue_()
             self.wait_till_pause()
-        states = []
-        # start recording the state
-        while self.is_paused():
-            regs = self.get_all_reg_values(reg_only)
-            if reg_only:
-                in_, out_ = self.get_io_values()
-                states.append((in_, regs, out_))
-            else:
-                states.append(regs)
+        regs = list(self.regs if reg_only else self.values)
+        ports = self._get_ports() if reg_only else []
+        names = regs + [name for name, _ in ports]
+        remove_file = filename is None
+        if remove_file:
+            fd, filename = tempfile.mkstemp(suffix=".kcap")
+            os.close(fd)
+        try:
+            # the simulation is paused at a clock edge, which is the first state
+            self.start_capture(filename, names, sample=True)
+            self.set_pause_on_clock(False)
             self.continue_()
-            self.wait_till_pause()
-        self.wait_till_finish()
+            self.wait_till_finish()
+            _, times, columns = read_capture(filename)
+        finally:
+            if remove_file:
+                os.remove(filename)
+        states = []
+        for row in range(len(times)):
+            values = [int(column[row]) for column in columns]
+            reg = dict(zip(regs, values))
+            if not reg_only:
+                states.append(reg)
+                continue
+            in_ = {}
+            out_ = {}
+            for (name, is_input), v in zip(ports, values[len(regs):]):
+                if is_input:
+                    in_[name] = v
+                else:
+                    out_[name] = v
+            states.append((in_, reg, out_))
         return states
 
     @staticmethod
@@ -39,3 +39,149 @@ def dump_icc_report(cov_directory, dst_filename, cwd=None):
         f.write(command_str)
     # call imc to dump the result
     subprocess.check_call([imc, "-exec", filename], cwd=cwd)
+
+
+def decode_msgpack(data):
+    # decodes the subset of MessagePack the runtime sends. binary values are
+    # little-endian signal values and are returned as int
+    import struct
+
+    def read(pos):
+        b = data[pos]
+        pos += 1
+        if b <= 0x7f:
+            return b, pos
+        if b >= 0xe0:
+            return b - 0x100, pos
+        if 0x80 <= b <= 0x8f:
+            return read_map(b & 0x0f, pos)
+        if 0x90 <= b <= 0x9f:
+            return read_array(b & 0x0f, pos)
+        if 0xa0 <= b <= 0xbf:
+            size = b & 0x1f
+            return data[pos:pos + size].decode("utf-8"), pos + size
+        if b == 0xc0:
+            return None, pos
+        if b in (0xc2, 0xc3):
+            return b == 0xc3, pos
+        if b in (0xc4, 0xc5, 0xc6):
+            size, pos = read_size(b - 0xc4, pos)
+            return int.from_bytes(data[pos:pos + size], "little"), pos + size
+        if b == 0xcb:
+            return struct.unpack(">d", data[pos:pos + 8])[0], pos + 8
+        if 0xcc <= b <= 0xcf:
+            size = 1 << (b - 0xcc)
+            return int.from_bytes(data[pos:pos + size], "big"), pos + size
+        if b == 0xd3:
+            return struct.unpack(">q", data[pos:pos + 8])[0], pos + 8
+        if b in (0xd9, 0xda, 0xdb):
+            size, pos = read_size(b - 0xd9, pos)
+            return data[pos:pos + size].decode("utf-8"), pos + size
+        if b in (0xdc, 0xdd):
+            size, pos = read_size(b - 0xdb, pos)
+            return read_array(size, pos)
+        if b in (0xde, 0xdf):
+            size, pos = read_size(b - 0xdd, pos)
+            return read_map(size, pos)
+        raise ValueError("Unsupported msgpack type 0x{0:02x}".format(b))
+
+    def read_size(index, pos):
+        size = 1 << index
+        return int.from_bytes(data[pos:pos + size], "big"), pos + size
+
+    def read_array(size, pos):
+        result = []
+        for _ in range(size):
+            value, pos = read(pos)
+            result.append(value)
+        return result, pos
+
+    def read_map(size, pos):
+        result = {}
+        for _ in range(size):
+            key, pos = read(pos)
+            value, pos = read(pos)
+            result[key] = value
+        return result, pos
+
+    return read(0)[0]
+
+
+def read_capture(filename):
+    # reads a file written by the runtime's POST /capture. returns the signal
+    # names, the times and one array per signal, in the order they were
+    # requested. columns are read as they are, without parsing every row
+    import array
+    import struct
+    import sys
+    with open(filename, "rb") as f:
+        data = f.read()
+    magic, version, num_signals = struct.unpack_from("<8sII", data, 0)
+    assert magic == b"KRATOSCP" and version == 1, "Invalid capture file"
+    pos = 16
+    names = []
+    for _ in range(num_signals):
+        _, size = struct.unpack_from("<II", data, pos)
+        pos += 8
+        names.append(data[pos:pos + size].decode("utf-8"))
+        pos += size
+    columns = [array.array("Q") for _ in range(num_signals + 1)]
+    while pos < len(data):
+        num_rows, _ = struct.unpack_from("<II", data, pos)
+        pos += 8
+        size = num_rows * 8
+        for column in columns:
+            column.frombytes(data[pos:pos + size])
+            pos += size
+    if sys.byteorder != "little":
+        for column in columns:
+            column.byteswap()
+    return names, columns[0], columns[1:]
+
+
+def write_capture(filename, names, times, columns, widths=None):
+    # writes the columns in the format of the runtime's POST /capture, e.g. to
+    # use as a golden trace for POST /golden. values are masked to the width of
+    # their signal, 64 bits by default, so negative values are written in two's
+    # complement
+    import array
+    import struct
+    import sys
+    if widths is None:
+        widths = [64] * len(names)
+    with open(filename, "wb") as f:
+        f.write(struct.pack("<8sII", b"KRATOSCP", 1, len(names)))
+        for name, width in zip(names, widths):
+            data = name.encode("utf-8")
+            f.write(struct.pack("<II", width, len(data)) + data)
+        if not times:
+            return
+        f.write(struct.pack("<II", len(times), 0))
+        masks = [(1 << 64) - 1] + [(1 << min(w, 64)) - 1 for w in widths]
+        for column, mask in zip([times] + list(columns), masks):
+            values = array.array("Q", [value & mask for value in column])
+            if sys.byteorder != "little":
+                values.byteswap()
+            f.write(values.tobytes())
+
+
+def convert_state(state_filename, capture_filename):
+    # converts the output of DebuggerMock.dump_state into a golden trace. rows
+    # are numbered by clock edge. dump_state reads signed 32-bit values, so the
+    # signals are written as 32 bits wide and only their low bits are compared
+    import json
+    with open(state_filename) as f:
+        state = json.load(f)
+    names = []
+    for entry in state[:1]:
+        for key in ("in", "reg", "out"):
+            names += list(entry[key].keys())
+    columns = [[] for _ in names]
+    for entry in state:
+        values = {}
+        for key in ("in", "reg", "out"):
+            values.update(entry[key])
+        for column, name in zip(columns, names):
+            column.append(values[name])
+    write_capture(capture_filename, names, list(range(len(state))), columns,
+                  [32] * len(names))
@@ -0,0 +1,154 @@
+#include "capture.hh"
+
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+constexpr char CAPTURE_MAGIC[8] = {'K', 'R', 'A', 'T', 'O', 'S', 'C', 'P'};
+constexpr uint32_t CAPTURE_VERSION = 1;
+
+// the file starts with this header, followed by the width, name size and name of every
+// signal. each chunk starts with the number of rows and 4 bytes of padding, then the times
+// and the signal columns as little-endian 64-bit integers
+struct CaptureHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_signals;
+};
+
+template <typename T>
+static void write_raw(std::ofstream &stream, const T *data, uint64_t size) {
+    stream.write(reinterpret_cast<const char *>(data),
+                 static_cast<std::streamsize>(size * sizeof(T)));
+}
+
+StateCapture::~StateCapture() { close(); }
+
+bool StateCapture::open(const std::string &filename, const std::vector<std::string> &names,
+                        const std::vector<vpiHandle> &handles) {
+    stream_.open(filename, std::ios::binary | std::ios::trunc);
+    if (!stream_) return false;
+    handles_ = handles;
+    widths_.clear();
+    widths_.reserve(handles.size());
+    for (auto *handle : handles) {
+        widths_.emplace_back(static_cast<uint32_t>(vpi_get(vpiSize, handle)));
+    }
+    times_.resize(CHUNK_SIZE);
+    values_.resize(static_cast<uint64_t>(CHUNK_SIZE) * handles.size());
+    num_rows_ = 0;
+    total_rows_ = 0;
+
+    CaptureHeader header{};
+    std::memcpy(header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    header.version = CAPTURE_VERSION;
+    header.num_signals = static_cast<uint32_t>(handles.size());
+    write_raw(stream_, &header, 1);
+    for (uint64_t i = 0; i < names.size(); i++) {
+        auto size = static_cast<uint32_t>(names[i].size());
+        write_raw(stream_, &widths_[i], 1);
+        write_raw(stream_, &size, 1);
+        stream_.write(names[i].data(), size);
+    }
+    return static_cast<bool>(stream_);
+}
+
+void StateCapture::sample(uint64_t time) {
+    if (!stream_.is_open()) return;
+    times_[num_rows_] = time;
+    for (uint64_t i = 0; i < handles_.size(); i++) {
+        values_[i * CHUNK_SIZE + num_rows_] = read_signal_value(handles_[i], widths_[i]);
+    }
+    if (++num_rows_ == CHUNK_SIZE) write_chunk();
+}
+
+void StateCapture::write_chunk() {
+    if (num_rows_ == 0) return;
+    uint32_t header[2] = {num_rows_, 0};
+    write_raw(stream_, header, 2);
+    write_raw(stream_, times_.data(), num_rows_);
+    for (uint64_t i = 0; i < handles_.size(); i++) {
+        write_raw(stream_, values_.data() + i * CHUNK_SIZE, num_rows_);
+    }
+    total_rows_ += num_rows_;
+    num_rows_ = 0;
+}
+
+uint64_t StateCapture::close() {
+    if (!stream_.is_open()) return total_rows_;
+    write_chunk();
+    stream_.close();
+    return total_rows_;
+}
+
+uint64_t get_vector_value(const s_vpi_vecval *vector, uint32_t width, uint64_t *unknown) {
+    uint64_t result = static_cast<uint32_t>(vector[0].aval);
+    uint64_t bval = static_cast<uint32_t>(vector[0].bval);
+    if (width > 32) {
+        result |= static_cast<uint64_t>(vector[1].aval) << 32u;
+        bval |= static_cast<uint64_t>(vector[1].bval) << 32u;
+    }
+    auto mask = width >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t(1) << width) - 1;
+    if (unknown) *unknown = bval & mask;
+    return result & mask;
+}
+
+uint64_t read_signal_value(vpiHandle handle, uint32_t width, uint64_t *unknown) {
+    s_vpi_value value;
+    value.format = vpiVectorVal;
+    vpi_get_value(handle, &value);
+    return get_vector_value(value.value.vector, width, unknown);
+}
+
+template <typename T>
+static bool read_raw(const std::string &data, uint64_t &pos, T *value, uint64_t size = 1) {
+    if (data.size() - pos < size * sizeof(T)) return false;
+    std::memcpy(value, data.data() + pos, size * sizeof(T));
+    pos += size * sizeof(T);
+    return true;
+}
+
+std::optional<CaptureData> read_capture_file(const std::string &filename) {
+    std::ifstream stream(filename, std::ios::binary);
+    if (!stream) return std::nullopt;
+    std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    uint64_t pos = 0;
+    CaptureHeader header{};
+    if (!read_raw(data, pos, &header) ||
+        std::memcmp(header.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 ||
+        header.version != CAPTURE_VERSION)
+        return std::nullopt;
+    CaptureData result;
+    for (uint32_t i = 0; i < header.num_signals; i++) {
+        uint32_t width, size;
+        if (!read_raw(data, pos, &width) || !read_raw(data, pos, &size) ||
+            data.size() - pos < size)
+            return std::nullopt;
+        result.widths.emplace_back(width);
+        result.names.emplace_back(data.substr(pos, size));
+        pos += size;
+    }
+    // chunks are read first and then merged into whole columns
+    std::vector<std::pair<uint64_t, uint32_t>> chunks;
+    while (pos < data.size()) {
+        uint32_t chunk[2];
+        if (!read_raw(data, pos, chunk, 2)) return std::nullopt;
+        auto size = static_cast<uint64_t>(chunk[0]) * (header.num_signals + 1) * sizeof(uint64_t);
+        if (data.size() - pos < size) return std::nullopt;
+        chunks.emplace_back(pos, chunk[0]);
+        pos += size;
+    }
+    uint64_t num_rows = 0;
+    for (auto const &[offset, rows] : chunks) num_rows += rows;
+    result.times.resize(num_rows);
+    result.values.resize(num_rows * header.num_signals);
+    uint64_t row = 0;
+    for (auto [offset, rows] : chunks) {
+        read_raw(data, offset, result.times.data() + row, rows);
+        for (uint32_t i = 0; i < header.num_signals; i++) {
+            read_raw(data, offset, result.values.data() + i * num_rows + row, rows);
+        }
+        row += rows;
+    }
+    return result;
+}
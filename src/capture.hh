@@ -0,0 +1,63 @@
+#ifndef KRATOS_RUNTIME_CAPTURE_HH
+#define KRATOS_RUNTIME_CAPTURE_HH
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "std/vpi_user.h"
+
+// contents of a capture file
+struct CaptureData {
+    std::vector<std::string> names;
+    std::vector<uint32_t> widths;
+    std::vector<uint64_t> times;
+    // column-major, times.size() values per signal
+    std::vector<uint64_t> values;
+};
+
+std::optional<CaptureData> read_capture_file(const std::string &filename);
+// values wider than 64 bits are truncated. the bits that are X or Z are set in unknown if it's
+// given
+uint64_t get_vector_value(const s_vpi_vecval *vector, uint32_t width, uint64_t *unknown = nullptr);
+uint64_t read_signal_value(vpiHandle handle, uint32_t width, uint64_t *unknown = nullptr);
+
+// captures the state of a fixed set of signals at every clock edge into a columnar file,
+// without pausing the simulation. rows are buffered and written in chunks, and every chunk
+// stores the times and then one column per signal, so a reader can load each column as an
+// array. kratos_runtime.util.read_capture reads the file
+class StateCapture {
+public:
+    // rows per chunk
+    static constexpr uint32_t CHUNK_SIZE = 4096;
+
+    StateCapture() = default;
+    // writes the rows that are still buffered
+    ~StateCapture();
+    StateCapture(const StateCapture &) = delete;
+    StateCapture &operator=(const StateCapture &) = delete;
+
+    // truncates the file and writes the header. returns false if it can't be written
+    bool open(const std::string &filename, const std::vector<std::string> &names,
+              const std::vector<vpiHandle> &handles);
+    // reads every signal. values wider than 64 bits are truncated
+    void sample(uint64_t time);
+    // returns the number of rows captured
+    uint64_t close();
+
+private:
+    void write_chunk();
+
+    std::ofstream stream_;
+    std::vector<vpiHandle> handles_;
+    std::vector<uint32_t> widths_;
+    std::vector<uint64_t> times_;
+    // column-major, CHUNK_SIZE values per signal
+    std::vector<uint64_t> values_;
+    uint32_t num_rows_ = 0;
+    uint64_t total_rows_ = 0;
+};
+
+#endif  // KRATOS_RUNTIME_CAPTURE_HH
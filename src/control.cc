@@ -2,33 +2,89 @@
 
 #include <unistd.h>
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <regex>
+#include <set>
+#include <shared_mutex>
 #include <unordered_map>
 
+#include "capture.hh"
 #include "db.hh"
+#include "event.hh"
 #include "expr.hh"
+#include "golden.hh"
 #include "fmt/format.h"
 #include "httplib.h"
+#include "journal.hh"
 #include "json11/json11.hpp"
+#include "monitor.hh"
+#include "recorder.hh"
 #include "sim.hh"
+#include "socket.hh"
 #include "std/vpi_user.h"
 #include "util.hh"
+#include "wire.hh"
 
 // constants
 uint16_t runtime_port = 8888;
 constexpr int BUFFER_SIZE = 1024;
+constexpr size_t DEFAULT_EVENT_QUEUE_SIZE = 4096;
+constexpr size_t DEFAULT_EVENT_STREAM_SIZE = 4096;
+constexpr uint32_t DEFAULT_POLL_TIMEOUT_MS = 10000;
+constexpr uint32_t MAX_POLL_TIMEOUT_MS = 60000;
+constexpr uint32_t DEFAULT_SUMMARY_BUCKETS = 1000;
 
 std::unique_ptr<httplib::Server> http_server = nullptr;
-std::unique_ptr<httplib::Client> http_client = nullptr;
+// same-host debuggers can connect through a Unix domain socket instead, set by KRATOS_SOCKET
+std::unique_ptr<UnixSocketServer> socket_server = nullptr;
+std::thread socket_thread;
+// notifications to the debugger are sent from a different thread
+std::unique_ptr<EventSender> event_sender = nullptr;
+// history of the monitored signals, set by KRATOS_RECORD
+std::unique_ptr<WaveformRecorder> recorder = nullptr;
+// breakpoint hits, set by KRATOS_JOURNAL
+std::unique_ptr<BreakpointJournal> journal = nullptr;
+// whether the journal stores the frame of every hit, set by KRATOS_JOURNAL_FRAMES
+bool journal_frames = false;
+// per-clock state capture started through POST /capture
+std::unique_ptr<StateCapture> capture = nullptr;
+std::mutex capture_lock;
+// expected trace compared at every clock edge, set through POST /golden
+std::unique_ptr<GoldenTrace> golden = nullptr;
+std::vector<vpiHandle> golden_handles;
+std::vector<uint32_t> golden_widths;
+std::vector<uint64_t> golden_values;
+std::vector<uint64_t> golden_unknown;
+// result of the last comparison, null while it's running
+json11::Json golden_result;
+std::mutex golden_lock;
+// debuggers that can't run a server subscribe to the events through GET /events instead
+EventStream event_stream(DEFAULT_EVENT_STREAM_SIZE);
 std::thread runtime_thread;
-std::unique_ptr<Database> db_;
+// the debug database is loaded in the background after the debugger connects. db_ is only
+// set once it's ready and has to be accessed through get_db() or wait_db()
+std::shared_ptr<Database> db_;
+DatabaseState db_state = DatabaseState::Disconnected;
+std::mutex db_lock;
+std::condition_variable db_cond;
+std::thread db_thread;
+std::mutex db_thread_lock;
 std::unordered_map<uint32_t, std::unordered_map<std::string, std::string>>
     breakpoint_symbol_mapping;
 // this is for vpi optimization
 std::unordered_map<std::string, vpiHandle> vpi_handle_map;
+std::mutex vpi_handle_lock;
 // include the dot to make things easier
 std::string top_name_ = "TOP.";  // NOLINT
 // this is used for remote debugging
@@ -36,115 +92,347 @@ std::string top_name_ = "TOP.";  // NOLINT
 // dst_path is where the code is compiled on the server
 std::string src_path;
 std::string dst_path;
-// mutex
-std::mutex runtime_lock;
-std::mutex vpi_lock;
+// requests that only read the simulation state share vpi_lock and run concurrently. requests
+// that change it, such as writes, breakpoints and monitors, take it exclusively. requests that
+// only query the debug database don't take it at all
+std::shared_mutex vpi_lock;
+// set while the thread holds vpi_lock, e.g. to run the requests of a batch
+thread_local bool holds_vpi_lock = false;
 // step over. notice that this is not mutex protected. You should not set step over during
 // the simulation
 bool step_over = false;
 // is the simulation paused
-bool paused = false;
+std::atomic<bool> paused = false;
 // whether to pause at the the clock edge
 bool pause_clock_edge = false;
-// current scope it has to be set to get the connections
+// current scope it has to be set to get the connections. protected by graph_value_lock
 std::string current_scope;
 // we don't want to send back the values if it's never stopped
 bool has_paused_on_clock = false;
 // if no client server, we don't need to send information back
 bool use_client_request = false;
+// the debugger subscribes to the event stream
+bool use_event_stream = false;
 
 std::optional<std::string> get_value(std::string handle_name);
+std::optional<RawValue> get_raw_value(std::string handle_name);
 std::optional<std::string> get_simulation_time(const std::string &);
+uint64_t get_sim_time();
 bool evaluate_breakpoint_expr(uint32_t breakpoint_id);
+void invalidate_graph_value();
 
 // convert the [] name to . for arrays
 std::string process_var_front_name(const std::string &name);
 
-struct CbHandle {
-    s_vpi_time time;
-    s_vpi_value value;
-    s_cb_data cb_data;
-    vpiHandle cb_handle = nullptr;
-    char *name = nullptr;
-};
+// only set by replays
+std::function<void(uint64_t)> time_seek;
+
+void set_time_seek(std::function<void(uint64_t)> seek) { time_seek = std::move(seek); }
+
+bool has_event_listener() { return event_sender || use_event_stream; }
+
+void notify(Event event) {
+    if (use_event_stream) event_stream.publish(event);
+    if (event_sender) event_sender->send(std::move(event));
+}
+
+// simulators don't expect VPI calls from other threads. while the simulation is paused, the
+// simulator thread runs them on behalf of the request threads
+std::mutex sim_task_lock;
+std::condition_variable sim_task_cond;
+std::deque<std::function<void()>> sim_tasks;
+// the simulator thread is waiting in pause_sim()
+bool sim_waiting = false;
+// a pause has been announced to the debugger and pause_sim() hasn't returned yet. resumes
+// outside of a pause are ignored, so a stray /continue can't skip the next one
+bool pause_pending = false;
+// un_pause_sim() has been called for the pending pause. pause_sim() returns immediately if
+// it's set, which covers a resume that arrives before the simulator thread starts waiting
+bool resume_sim = false;
+thread_local bool in_sim_task = false;
+
+void flush_monitor_values();
+
+void begin_pause() {
+    // the debugger gets the values at the pause before it's told about the pause
+    flush_monitor_values();
+    std::lock_guard guard(sim_task_lock);
+    if (pause_pending) return;
+    pause_pending = true;
+    resume_sim = false;
+}
 
 void pause_sim() {
+    begin_pause();
     paused = true;
-    runtime_lock.lock();
+    std::unique_lock lock(sim_task_lock);
+    sim_waiting = true;
+    while (true) {
+        sim_task_cond.wait(lock, []() { return resume_sim || !sim_tasks.empty(); });
+        while (!sim_tasks.empty()) {
+            auto task = std::move(sim_tasks.front());
+            sim_tasks.pop_front();
+            lock.unlock();
+            in_sim_task = true;
+            task();
+            in_sim_task = false;
+            lock.lock();
+        }
+        if (resume_sim) break;
+    }
+    resume_sim = false;
+    pause_pending = false;
+    sim_waiting = false;
+    paused = false;
 }
 
 void un_pause_sim() {
+    invalidate_graph_value();
+    end_pause_values();
     paused = false;
-    runtime_lock.unlock();
+    {
+        std::lock_guard guard(sim_task_lock);
+        if (!pause_pending) return;
+        resume_sim = true;
+    }
+    sim_task_cond.notify_all();
 }
 
-// this is for vpi cb struct
-std::unordered_map<std::string, CbHandle *> cb_handle_map;
+// runs on the simulator thread if it's paused, otherwise on the calling thread
+void run_on_sim_thread(const std::function<void()> &fn) {
+    std::unique_lock lock(sim_task_lock);
+    if (!sim_waiting || in_sim_task) {
+        lock.unlock();
+        fn();
+        return;
+    }
+    auto task = std::make_shared<std::packaged_task<void()>>(fn);
+    auto result = task->get_future();
+    sim_tasks.emplace_back([task]() { (*task)(); });
+    lock.unlock();
+    sim_task_cond.notify_all();
+    // rethrows if fn throws
+    result.get();
+}
 
-std::string get_breakpoint_value(uint32_t instance_id, uint32_t id) {
-    std::vector<std::pair<std::string, std::string>> gen_vars;
-    std::vector<std::pair<std::string, std::string>> local_vars;
-    if (db_) {
-        auto variables = db_->get_variable_mapping(instance_id, id);
-        for (auto const &variable : variables) {
-            // decide if we need to append the top name
-            if (variable.is_var) {
-                auto value = get_value(fmt::format("{0}.{1}", variable.handle, variable.value));
-                std::string v;
-                if (value)
-                    v = value.value();
-                else
-                    v = "ERROR";
-                // we need some process here to replace the [] in array notion, if any
-                auto var_name = process_var_front_name(variable.value);
-                gen_vars.emplace_back(std::make_pair(var_name, v));
-            } else {
-                gen_vars.emplace_back(variable.name, variable.value);
-            }
+void read_sim(const std::function<void()> &fn) {
+    // already inside a read, e.g. a batched request
+    if (holds_vpi_lock || in_sim_task) {
+        fn();
+        return;
+    }
+    std::shared_lock lock(vpi_lock);
+    holds_vpi_lock = true;
+    try {
+        run_on_sim_thread(fn);
+    } catch (...) {
+        holds_vpi_lock = false;
+        throw;
+    }
+    holds_vpi_lock = false;
+}
+
+void write_sim(const std::function<void()> &fn) {
+    std::unique_lock lock(vpi_lock);
+    holds_vpi_lock = true;
+    try {
+        run_on_sim_thread(fn);
+    } catch (...) {
+        holds_vpi_lock = false;
+        throw;
+    }
+    holds_vpi_lock = false;
+}
+
+// returns nullptr if the database is not ready
+std::shared_ptr<Database> get_db() {
+    std::lock_guard guard(db_lock);
+    return db_;
+}
+
+// blocks while the database is loading. returns nullptr if the debugger hasn't connected, e.g.
+// in client mode, or the load failed. the simulator thread and threads holding vpi_lock never
+// wait, since that would stall the simulation and every write
+std::shared_ptr<Database> wait_db() {
+    std::unique_lock lock(db_lock);
+    if (in_sim_task || holds_vpi_lock) return db_;
+    db_cond.wait(lock, []() { return db_state != DatabaseState::Loading; });
+    return db_;
+}
+
+DatabaseState get_db_state() {
+    std::lock_guard guard(db_lock);
+    return db_state;
+}
+
+void load_db(const std::string &filename) {
+    std::lock_guard thread_guard(db_thread_lock);
+    // only one load at a time
+    if (db_thread.joinable()) db_thread.join();
+    {
+        std::lock_guard guard(db_lock);
+        db_ = nullptr;
+        db_state = DatabaseState::Loading;
+    }
+    // the simulation keeps running while the database is loading. VPI handles are not
+    // resolved here since VPI calls are only safe from the simulator thread or during a pause
+    db_thread = std::thread([filename]() {
+        std::shared_ptr<Database> db;
+        try {
+            db = std::make_shared<Database>(filename);
+        } catch (const std::exception &ex) {
+            std::cerr << "Unable to load " << filename << ": " << ex.what() << std::endl;
         }
-        auto context_vars = db_->get_context_variable(instance_id, id);
-        for (auto const &variable : context_vars) {
-            if (variable.is_var) {
-                auto handle_name = fmt::format("{0}.{1}", variable.handle, variable.value);
-                auto value = get_value(handle_name);
-                std::string v;
-                if (value)
-                    v = value.value();
-                else
-                    v = "ERROR";
-                local_vars.emplace_back(std::make_pair(variable.name, v));
-            } else {
-                local_vars.emplace_back(std::make_pair(variable.name, variable.value));
-            }
+        {
+            std::lock_guard guard(db_lock);
+            db_ = db;
+            db_state = db ? DatabaseState::Ready : DatabaseState::Error;
         }
-    }
+        db_cond.notify_all();
+    });
+}
 
-    // send over the line number and filename as well
+void unload_db() {
+    std::lock_guard thread_guard(db_thread_lock);
+    if (db_thread.joinable()) db_thread.join();
+    std::lock_guard guard(db_lock);
+    db_ = nullptr;
+    db_state = DatabaseState::Disconnected;
+}
+
+// a frame variable is either a constant from the debug database or a signal that is read
+// when the frame is sent
+struct FrameVariable {
+    std::string name;
+    std::string value;
+    bool is_signal;
+};
+
+struct BreakpointFrame {
+    uint32_t id;
+    uint32_t instance_id;
+    std::vector<FrameVariable> local;
+    std::vector<FrameVariable> generator;
     std::string filename;
-    std::string line_num;
+    std::optional<uint32_t> line_num;
     std::string instance_name;
-    if (db_) {
-        auto bp = db_->get_breakpoint_info(id);
-        if (bp) {
-            filename = bp.value().first;
-            line_num = fmt::format("{0}", bp.value().second);
-            // convert them if necessary
-            // replace the path if necessary
-            if (!src_path.empty() && !dst_path.empty()) {
-                replace(filename, dst_path, src_path);
-            }
+};
+
+BreakpointFrame collect_breakpoint_frame(uint32_t instance_id, uint32_t id) {
+    BreakpointFrame frame{id, instance_id, {}, {}, "", std::nullopt, ""};
+    auto db = get_db();
+    if (!db) return frame;
+    auto variables = db->get_variable_mapping(instance_id, id);
+    for (auto const &variable : variables) {
+        // decide if we need to append the top name
+        if (variable.is_var) {
+            // we need some process here to replace the [] in array notion, if any
+            frame.generator.emplace_back(
+                FrameVariable{process_var_front_name(variable.value),
+                              fmt::format("{0}.{1}", variable.handle, variable.value), true});
+        } else {
+            frame.generator.emplace_back(FrameVariable{variable.name, variable.value, false});
+        }
+    }
+    auto context_vars = db->get_context_variable(instance_id, id);
+    for (auto const &variable : context_vars) {
+        if (variable.is_var) {
+            frame.local.emplace_back(FrameVariable{
+                variable.name, fmt::format("{0}.{1}", variable.handle, variable.value), true});
+        } else {
+            frame.local.emplace_back(FrameVariable{variable.name, variable.value, false});
         }
-        instance_name = db_->get_instance_name(instance_id);
     }
+
+    // send over the line number and filename as well
+    auto bp = db->get_breakpoint_info(id);
+    if (bp) {
+        frame.filename = bp.value().first;
+        frame.line_num = bp.value().second;
+        // convert them if necessary
+        // replace the path if necessary
+        if (!src_path.empty() && !dst_path.empty()) {
+            replace(frame.filename, dst_path, src_path);
+        }
+    }
+    frame.instance_name = db->get_instance_name(instance_id);
+    return frame;
+}
+
+json11::Json get_breakpoint_frame(uint32_t instance_id, uint32_t id) {
+    auto frame = collect_breakpoint_frame(instance_id, id);
+    auto to_pairs = [](const std::vector<FrameVariable> &variables) {
+        std::vector<std::pair<std::string, std::string>> result;
+        result.reserve(variables.size());
+        for (auto const &variable : variables) {
+            if (!variable.is_signal) {
+                result.emplace_back(variable.name, variable.value);
+                continue;
+            }
+            auto value = get_pause_value(variable.value);
+            result.emplace_back(variable.name, value ? *value : "ERROR");
+        }
+        return result;
+    };
+    auto line_num = frame.line_num ? fmt::format("{0}", *frame.line_num) : "";
     json11::Json result = json11::Json::object({{"id", fmt::format("{0}", id)},
-                                                {"local", local_vars},
-                                                {"generator", gen_vars},
-                                                {"filename", filename},
+                                                {"local", to_pairs(frame.local)},
+                                                {"generator", to_pairs(frame.generator)},
+                                                {"filename", frame.filename},
                                                 {"line_num", line_num},
-                                                {"instance_name", instance_name},
+                                                {"instance_name", frame.instance_name},
                                                 {"instance_id", std::to_string(instance_id)}});
-    return result.dump();
+    return result;
+}
+
+// same keys as the JSON frame, but signals are read at their full width and numbers are sent
+// as integers. signals that can't be found are nil
+void write_breakpoint_frame(MsgPackWriter &writer, uint32_t instance_id, uint32_t id) {
+    auto frame = collect_breakpoint_frame(instance_id, id);
+    auto write_variables = [&writer](const std::vector<FrameVariable> &variables) {
+        // sorted by name and the first one wins, as in the JSON object
+        std::map<std::string_view, const FrameVariable *> sorted;
+        for (auto const &variable : variables) sorted.emplace(variable.name, &variable);
+        writer.write_map(static_cast<uint32_t>(sorted.size()));
+        for (auto const &[name, variable] : sorted) {
+            writer.write_str(name);
+            if (!variable->is_signal) {
+                writer.write_str(variable->value);
+                continue;
+            }
+            auto value = get_raw_value(variable->value);
+            if (value) {
+                writer.write_value(*value);
+            } else {
+                writer.write_nil();
+            }
+        }
+    };
+    writer.write_map(7);
+    writer.write_str("filename");
+    writer.write_str(frame.filename);
+    writer.write_str("generator");
+    write_variables(frame.generator);
+    writer.write_str("id");
+    writer.write_uint(id);
+    writer.write_str("instance_id");
+    writer.write_uint(instance_id);
+    writer.write_str("instance_name");
+    writer.write_str(frame.instance_name);
+    writer.write_str("line_num");
+    if (frame.line_num) {
+        writer.write_uint(*frame.line_num);
+    } else {
+        writer.write_nil();
+    }
+    writer.write_str("local");
+    write_variables(frame.local);
+}
+
+std::string get_breakpoint_value(uint32_t instance_id, uint32_t id) {
+    return get_breakpoint_frame(instance_id, id).dump();
 }
+
 std::string process_var_front_name(const std::string &name) {
     std::string var_name;
     var_name.reserve(name.size());
@@ -157,6 +445,19 @@ std::string process_var_front_name(const std::string &name) {
     return var_name;
 }
 
+void add_journal_hit(uint32_t instance_id, uint32_t id, const std::string &frame) {
+    BreakpointHit hit{get_sim_time(), instance_id, id, "", 0, journal_frames ? frame : ""};
+    auto db = get_db();
+    if (db) {
+        auto bp = db->get_breakpoint_info(id);
+        if (bp) {
+            hit.filename = bp->first;
+            hit.line_num = bp->second;
+        }
+    }
+    journal->add(std::move(hit));
+}
+
 void breakpoint_trace(uint32_t instance_id, uint32_t id) {
     if (step_over || !should_continue_simulation(id)) {
         printf("hit breakpoint %d step_over: %d\n", id, step_over);
@@ -165,92 +466,186 @@ void breakpoint_trace(uint32_t instance_id, uint32_t id) {
         if (has_expr_breakpoint(id)) {
             if (!evaluate_breakpoint_expr(id)) return;
         }
+        begin_pause_values();
+        std::string content;
+        if (has_event_listener() || (journal && journal_frames)) {
+            content = get_breakpoint_value(instance_id, id);
+        }
+        if (journal && !step_over) add_journal_hit(instance_id, id, content);
         // tell the client that we have hit a clock
-        if (http_client) {
-            auto content = get_breakpoint_value(instance_id, id);
+        if (has_event_listener()) {
+            begin_pause();
             if (step_over) {
-                http_client->Post("/status/step", content, "application/json");
+                notify(Event{"/status/step", content, "application/json"});
             } else {
-                http_client->Post("/status/breakpoint", content, "application/json");
+                notify(Event{"/status/breakpoint", content, "application/json"});
             }
         }
         // pause the simulation
         // only pause when we know we can continue
-        if (http_client || use_client_request) pause_sim();
+        if (has_event_listener() || use_client_request)
+            pause_sim();
+        else
+            end_pause_values();
     }
 }
 
-json11::Json::object get_graph_value() {
+// graph values of the current scope at current pause. cleared whenever the simulation
+// continues or any value is written
+struct GraphValueCache {
+    std::string scope;
+    std::string time;
+    json11::Json::object result;
+    bool valid = false;
+};
+GraphValueCache graph_value_cache;
+std::mutex graph_value_lock;
+
+void invalidate_graph_value() {
+    std::lock_guard guard(graph_value_lock);
+    graph_value_cache.valid = false;
+}
+
+void set_current_scope(const std::string &scope) {
+    std::lock_guard guard(graph_value_lock);
+    current_scope = scope;
+}
+
+std::string get_current_scope() {
+    std::lock_guard guard(graph_value_lock);
+    return current_scope;
+}
+
+json11::Json::object get_graph_value(const std::string &scope) {
     auto time_val = get_simulation_time("");
     std::string time = "ERROR";
     if (time_val) time = *time_val;
     // we need to pull out all the values from the connections
-    auto modules = db_->get_hierarchy(current_scope);
+    auto db = get_db();
+    if (!db) return json11::Json::object({{"time", time}, {"value", json11::Json::object()}});
+    std::lock_guard guard(graph_value_lock);
+    if (graph_value_cache.valid && graph_value_cache.scope == scope &&
+        graph_value_cache.time == time) {
+        return graph_value_cache.result;
+    }
+    // connections that share the same driver are read only once
+    auto nets = db->get_nets(scope);
     std::map<std::string, std::string> values;
-    for (auto const &module : modules) {
-        auto handle = fmt::format("{0}.{1}", module.parent_handle, module.child);
-        auto conn_from = db_->get_connection_from(handle);
-        auto conn_to = db_->get_connection_to(handle);
-        for (auto &conn : conn_from) {
-            auto var_from_handle = fmt::format("{0}.{1}", conn.handle_from, conn.var_from);
-            auto var_to_handle = fmt::format("{0}.{1}", conn.handle_to, conn.var_to);
-            auto value = get_value(var_from_handle);
-            if (value) {
-                // from and to are the same
-                values.emplace(var_from_handle, *value);
-                values.emplace(var_to_handle, *value);
-            }
+    for (auto const &net : *nets) {
+        auto value = get_pause_value(net.driver);
+        if (!value) continue;
+        for (auto const &handle : net.handles) {
+            values.emplace(handle, *value);
         }
     }
-    return json11::Json::object({{"time", time}, {"value", values}});
+    graph_value_cache = GraphValueCache{scope, time,
+                                        json11::Json::object({{"time", time}, {"value", values}}),
+                                        true};
+    return graph_value_cache.result;
 }
 
-std::string get_context_value(std::string filename, uint32_t line_num) {
-    // get all the instance ids and line number
-    if (!db_) {
-        while (!db_) {
-            // sleep for 0.1 seconds
-            usleep(100000);
-        }
+// same as get_graph_value, but the values are read at their full width
+void write_graph_value(MsgPackWriter &writer, const std::string &scope) {
+    writer.write_map(2);
+    writer.write_str("time");
+    writer.write_value(*get_raw_value("time"));
+    writer.write_str("value");
+    auto db = get_db();
+    if (!db) {
+        writer.write_map(0);
+        return;
     }
-    if (db_) {
-        // replace the path if necessary
-        if (!src_path.empty() && !dst_path.empty()) {
-            replace(filename, src_path, dst_path);
+    auto nets = db->get_nets(scope);
+    std::map<std::string, RawValue> values;
+    for (auto const &net : *nets) {
+        auto value = get_raw_value(net.driver);
+        if (!value) continue;
+        for (auto const &handle : net.handles) {
+            values.emplace(handle, *value);
         }
-        auto bps = db_->get_breakpoints(filename, line_num);
-        if (!bps.empty()) {
-            std::vector<std::string> result;
-            result.reserve(bps.size());
+    }
+    writer.write_map(static_cast<uint32_t>(values.size()));
+    for (auto const &[handle, value] : values) {
+        writer.write_str(handle);
+        writer.write_value(value);
+    }
+}
 
-            for (auto const &bp : bps) {
-                auto v = get_breakpoint_value(bp.instance_id, bp.breakpoint_id);
-                result.emplace_back(v);
-            }
-            return json11::Json(result).dump();
-        }
+// breakpoints on the line, looked up with the path used in the debug database
+std::vector<Breakpoint> get_line_breakpoints(std::string filename, uint32_t line_num) {
+    auto db = wait_db();
+    if (!db) return {};
+    // replace the path if necessary
+    if (!src_path.empty() && !dst_path.empty()) {
+        replace(filename, src_path, dst_path);
     }
-    return "{}";
+    return db->get_breakpoints(filename, line_num);
 }
 
+// one frame per breakpoint on the line. null if there is none
+json11::Json get_context_frames(const std::string &filename, uint32_t line_num) {
+    auto bps = get_line_breakpoints(filename, line_num);
+    if (bps.empty()) return nullptr;
+    json11::Json::array result;
+    result.reserve(bps.size());
+    for (auto const &bp : bps) {
+        result.emplace_back(get_breakpoint_frame(bp.instance_id, bp.breakpoint_id));
+    }
+    return result;
+}
+
+void write_context_frames(MsgPackWriter &writer, const std::string &filename,
+                          uint32_t line_num) {
+    auto bps = get_line_breakpoints(filename, line_num);
+    if (bps.empty()) {
+        writer.write_nil();
+        return;
+    }
+    writer.write_array(static_cast<uint32_t>(bps.size()));
+    for (auto const &bp : bps) write_breakpoint_frame(writer, bp.instance_id, bp.breakpoint_id);
+}
+
+std::string get_context_value(const std::string &filename, uint32_t line_num) {
+    auto frames = get_context_frames(filename, line_num);
+    if (frames.is_null()) return "{}";
+    // frames are sent as strings in JSON
+    std::vector<std::string> result;
+    result.reserve(frames.array_items().size());
+    for (auto const &frame : frames.array_items()) {
+        result.emplace_back(frame.dump());
+    }
+    return json11::Json(result).dump();
+}
+
+void sample_monitors();
+void sample_capture();
+bool check_golden(bool can_pause = true);
+
 void breakpoint_clock(void) {
+    sample_monitors();
+    sample_capture();
+    if (check_golden()) return;
     if (pause_clock_edge) {
         has_paused_on_clock = true;
         printf("Pause on clock edge\n");
-        if (http_client && db_) {
-            auto content = json11::Json(get_graph_value());
-            http_client->Post("/status/clock",
-                              content.dump(),  // NOLINT
-                              "application/json");
+        begin_pause_values();
+        if (has_event_listener() && get_db()) {
+            auto content = json11::Json(get_graph_value(get_current_scope()));
+            begin_pause();
+            notify(Event{"/status/clock", content.dump(), "application/json"});
         }
-        if (http_client || use_client_request) pause_sim();
+        if (has_event_listener() || use_client_request)
+            pause_sim();
+        else
+            end_pause_values();
     }
 }
 
 PLI_INT32 cb_pause_at_synch(s_cb_data *) {
     printf("paused on synch\n");
-    if (http_client) {
-        http_client->Post("/status/synch", "Okay", "plain/text");
+    if (has_event_listener()) {
+        begin_pause();
+        notify(Event{"/status/synch", "Okay", "plain/text"});
     }
     pause_sim();
     return 0;
@@ -272,9 +667,11 @@ void pause_at_synch() {
 }
 
 void exception(uint32_t instance_id, uint32_t id) {
-    if (http_client) {
+    if (has_event_listener()) {
+        begin_pause_values();
         auto content = get_breakpoint_value(instance_id, id);
-        http_client->Post("/status/exception", content, "application/json");
+        begin_pause();
+        notify(Event{"/status/exception", content, "application/json"});
         pause_sim();
     }
 }
@@ -306,20 +703,15 @@ void set_breakpoint_content(const std::vector<std::pair<uint32_t, uint32_t>> &bp
 
 std::vector<std::pair<uint32_t, uint32_t>> get_breakpoint(const std::string &filename,
                                                                         uint32_t line_num) {
-    // hacky way
-    if (!db_) {
-        while (!db_) {
-            // sleep for 0.1 seconds
-            usleep(100000);
-        }
-    }
-    if (db_) {
-        auto bps = db_->get_breakpoint_id(filename, line_num);
+    // requests sent before the database is ready wait for the load to finish
+    auto db = wait_db();
+    if (db) {
+        auto bps = db->get_breakpoint_id(filename, line_num);
         if (!bps.empty()) {
             std::vector<std::pair<uint32_t, uint32_t>> result;
             result.reserve(bps.size());
             for (auto const &bp : bps) {
-                auto col = db_->get_breakpoint_column(bp);
+                auto col = db->get_breakpoint_column(bp);
                 result.emplace_back(std::make_pair(bp, col));
             }
             return result;
@@ -333,12 +725,13 @@ std::vector<std::pair<uint32_t, uint32_t>> get_breakpoint(const std::string &fil
 
 bool add_breakpoint_expr(uint32_t breakpoint_id, const std::string &expr) {
     if (expr.empty()) return true;
-    if (!db_) return false;
+    auto db = wait_db();
+    if (!db) return false;
     // query the local port variables
-    auto op_id = db_->get_instance_id(breakpoint_id);
+    auto op_id = db->get_instance_id(breakpoint_id);
     if (!op_id) return false;
-    auto const self_variables = db_->get_variable_mapping(*op_id, breakpoint_id);
-    auto const context_variables = db_->get_context_variable(*op_id, breakpoint_id);
+    auto const self_variables = db->get_variable_mapping(*op_id, breakpoint_id);
+    auto const context_variables = db->get_context_variable(*op_id, breakpoint_id);
     std::unordered_map<std::string, int64_t> constants;
     std::unordered_set<std::string> symbols;
     // need to extract the time
@@ -425,13 +818,14 @@ bool evaluate_breakpoint_expr(uint32_t breakpoint_id) {
 }
 
 std::vector<uint32_t> get_breakpoint_filename(std::string filename, httplib::Response &res) {
+    auto db = wait_db();
     if (!filename.empty()) {
-        if (db_) {
+        if (db) {
             res.status = 200;
             // return a list of breakpoints
             res.set_content("Okay", "text/plain");
             if (!src_path.empty() && !dst_path.empty()) replace(filename, src_path, dst_path);
-            auto bps = db_->get_all_breakpoints(filename);
+            auto bps = db->get_all_breakpoints(filename);
             struct BP {
                 uint32_t id;
                 [[nodiscard]] std::string to_json() const { return fmt::format("{0}", id); }
@@ -450,11 +844,9 @@ std::vector<uint32_t> get_breakpoint_filename(std::string filename, httplib::Res
     return {};
 }
 
-std::optional<std::string> get_value(std::string handle_name) {
-    if (handle_name == "time" || handle_name == "$time") {
-        return get_simulation_time("");
-    }
-    handle_name = get_handle_name(top_name_, handle_name);
+vpiHandle get_vpi_handle(const std::string &handle_name) {
+    // handle name has to be a full name
+    std::lock_guard guard(vpi_handle_lock);
     vpiHandle vh;
     if (vpi_handle_map.find(handle_name) != vpi_handle_map.end()) {
         vh = vpi_handle_map.at(handle_name);
@@ -463,6 +855,15 @@ std::optional<std::string> get_value(std::string handle_name) {
         vh = vpi_handle_by_name(handle, nullptr);
         vpi_handle_map.emplace(handle_name, vh);
     }
+    return vh;
+}
+
+std::optional<std::string> get_value(std::string handle_name) {
+    if (handle_name == "time" || handle_name == "$time") {
+        return get_simulation_time("");
+    }
+    handle_name = get_handle_name(top_name_, handle_name);
+    auto vh = get_vpi_handle(handle_name);
 
     if (!vh) {
         // not found
@@ -477,6 +878,183 @@ std::optional<std::string> get_value(std::string handle_name) {
     }
 }
 
+// reads the value at its real width instead of truncating it to an integer
+std::optional<RawValue> get_raw_value(std::string handle_name) {
+    if (handle_name == "time" || handle_name == "$time") {
+        s_vpi_time time;
+        time.type = vpiSimTime;
+        vpi_get_time(nullptr, &time);
+        return RawValue{64, {time.low, time.high}};
+    }
+    handle_name = get_handle_name(top_name_, handle_name);
+    auto vh = get_vpi_handle(handle_name);
+    if (!vh) return std::nullopt;
+
+    auto width = vpi_get(vpiSize, vh);
+    if (width <= 0) return std::nullopt;
+    s_vpi_value v;
+    v.format = vpiVectorVal;
+    vpi_get_value(vh, &v);
+    RawValue result{static_cast<uint32_t>(width), {}};
+    auto num_words = (result.width + 31) / 32;
+    result.words.reserve(num_words);
+    for (uint32_t i = 0; i < num_words; i++) {
+        result.words.emplace_back(v.value.vector[i].aval);
+    }
+    return result;
+}
+
+// signals are often referenced by several variables in the same frame, e.g. duplicated
+// variable rows or the same signal in both the context and generator tables. values read
+// during a pause are memoized so that each signal is only read once
+std::mutex pause_value_lock;
+std::unordered_map<std::string, std::optional<std::string>> pause_values;
+bool pause_value_enabled = false;
+
+std::optional<std::string> get_pause_value(const std::string &handle_name) {
+    std::lock_guard guard(pause_value_lock);
+    if (!pause_value_enabled) return get_value(handle_name);
+    if (pause_values.find(handle_name) == pause_values.end()) {
+        pause_values.emplace(handle_name, get_value(handle_name));
+    }
+    return pause_values.at(handle_name);
+}
+
+void begin_pause_values() {
+    std::lock_guard guard(pause_value_lock);
+    pause_values.clear();
+    pause_value_enabled = true;
+}
+
+void end_pause_values() {
+    std::lock_guard guard(pause_value_lock);
+    pause_values.clear();
+    pause_value_enabled = false;
+}
+
+void clear_pause_values() {
+    std::lock_guard guard(pause_value_lock);
+    pause_values.clear();
+}
+
+struct ValueWrite {
+    std::string handle_name;
+    vpiHandle handle;
+    // value is stored as string so that we can support wide values
+    std::string value;
+    PLI_INT32 format;
+    PLI_INT32 flag;
+};
+
+std::optional<ValueWrite> parse_value_write(const json11::Json &entry, std::string &error) {
+    auto handle_json = entry["handle"];
+    auto value_json = entry["value"];
+    auto mode_json = entry["mode"];
+    if (!handle_json.is_string()) {
+        error = "Invalid handle";
+        return std::nullopt;
+    }
+    ValueWrite write;
+    write.handle_name = handle_json.string_value();
+    // deposit by default
+    write.flag = vpiNoDelay;
+    if (mode_json.is_string()) {
+        auto const &mode = mode_json.string_value();
+        if (mode == "force") {
+            write.flag = vpiForceFlag;
+        } else if (mode == "release") {
+            write.flag = vpiReleaseFlag;
+        } else if (mode != "deposit") {
+            error = fmt::format("Invalid mode {0} for {1}", mode, write.handle_name);
+            return std::nullopt;
+        }
+    }
+    // release doesn't need a value
+    write.format = vpiDecStrVal;
+    if (value_json.is_number()) {
+        // JSON numbers are doubles, which only hold integers up to 2^53 exactly
+        constexpr double max_integer = 9007199254740992.0;
+        auto number = value_json.number_value();
+        if (std::trunc(number) != number || std::abs(number) > max_integer) {
+            error = fmt::format("Invalid value {0} for {1}. Use a string for values that are not "
+                                "integers or larger than 2^53",
+                                value_json.dump(), write.handle_name);
+            return std::nullopt;
+        }
+        write.value = fmt::format("{0}", static_cast<int64_t>(number));
+    } else if (value_json.is_string()) {
+        auto const &value = value_json.string_value();
+        if (value.size() > 2 && value[0] == '0' && (value[1] == 'x' || value[1] == 'X')) {
+            write.format = vpiHexStrVal;
+            write.value = value.substr(2);
+        } else if (value.size() > 2 && value[0] == '0' && (value[1] == 'b' || value[1] == 'B')) {
+            write.format = vpiBinStrVal;
+            write.value = value.substr(2);
+        } else if (!value.empty() && (is_digits(value) || (value[0] == '-' && value.size() > 1 &&
+                                                           is_digits(value.substr(1))))) {
+            write.value = value;
+        } else {
+            error = fmt::format("Invalid value {0} for {1}", value, write.handle_name);
+            return std::nullopt;
+        }
+    } else if (write.flag != vpiReleaseFlag) {
+        error = fmt::format("Missing value for {0}", write.handle_name);
+        return std::nullopt;
+    }
+
+    auto handle_name = get_handle_name(top_name_, write.handle_name);
+    write.handle = get_vpi_handle(handle_name);
+    if (!write.handle) {
+        error = fmt::format("Unable to find {0}", write.handle_name);
+        return std::nullopt;
+    }
+    return write;
+}
+
+bool put_values(const std::string &content, std::string &error) {
+    // vpi_put_value does nothing in a replay, which would otherwise report the writes as done
+    if (time_seek) {
+        error = "A replay can't be written to";
+        return false;
+    }
+    // we can only write values when the simulator is paused. the whole batch is applied
+    // before the simulation resumes
+    if (!paused) {
+        error = "Simulation is not paused";
+        return false;
+    }
+    auto json = json11::Json::parse(content, error);
+    if (!error.empty()) return false;
+    if (!json.is_array()) {
+        error = "Expect a list of values";
+        return false;
+    }
+    // we resolve every entry before we write anything so that the batch is applied
+    // as a whole
+    std::vector<ValueWrite> writes;
+    writes.reserve(json.array_items().size());
+    for (auto const &entry : json.array_items()) {
+        auto write = parse_value_write(entry, error);
+        if (!write) return false;
+        writes.emplace_back(std::move(*write));
+    }
+
+    for (auto &write : writes) {
+        s_vpi_value v;
+        if (write.flag == vpiReleaseFlag) {
+            // the simulator will write back the released value
+            v.format = vpiIntVal;
+        } else {
+            v.format = write.format;
+            v.value.str = const_cast<char *>(write.value.c_str());
+        }
+        vpi_put_value(write.handle, &v, nullptr, write.flag);
+    }
+    invalidate_graph_value();
+    clear_pause_values();
+    return true;
+}
+
 std::optional<std::string> get_simulation_time(const std::string &module_name = "") {
     s_vpi_time current_time;
     // verilator only supports vpiSimTime
@@ -499,89 +1077,322 @@ std::optional<std::string> get_simulation_time(const std::string &module_name =
     return std::nullopt;
 }
 
-int monitor_signal(p_cb_data cb_data_p) {
-    std::string signal_name = cb_data_p->user_data;
-    std::string value = fmt::format("{0}", cb_data_p->value->value.integer);
-    if (http_client) {
-        printf("sending value %s\n", signal_name.c_str());
-        auto json = json11::Json(json11::Json::object{{"handle", signal_name}, {"value", value}});
-        http_client->Post("/value", json.dump(), "application/json");
+// monitored values can change several times in a time step, e.g. through delta cycles. the
+// changes are collected and sent as one message with the final values once the time step
+// settles
+std::mutex monitor_lock;
+// monitor id -> value
+std::unordered_map<uint32_t, uint64_t> monitor_values;
+bool monitor_flush_scheduled = false;
+// set when a flush was held back. the next change or clock edge schedules it again, instead
+// of a callback at every time step until it can be sent. a pause sends it right away
+std::atomic<bool> monitor_flush_deferred = false;
+// minimum time between two messages, set by KRATOS_MONITOR_INTERVAL in ms
+std::chrono::milliseconds monitor_interval(0);
+std::chrono::steady_clock::time_point monitor_last_flush;
+
+void schedule_monitor_flush();
+int monitor_signal(p_cb_data cb_data_p);
+MonitorRegistry monitors(monitor_signal);
+
+std::string get_monitor_event_key(uint32_t group) {
+    if (group == MonitorRegistry::DEFAULT_GROUP) return "/values";
+    return fmt::format("/values/{0}", group);
+}
+
+// monitor_lock has to be held
+void send_monitor_values() {
+    auto time = get_simulation_time("");
+    // separate groups, such as scopes, are sent in their own messages
+    std::map<uint32_t, std::map<std::string, std::string>> groups;
+    for (auto const &[id, value] : monitor_values) {
+        groups[monitors.get_report_group(id)].emplace(monitors.get_name(id),
+                                                      fmt::format("{0}", value));
     }
-    return 0;
+    for (auto const &[group, values] : groups) {
+        json11::Json::object content = {{"time", time ? *time : "ERROR"}, {"values", values}};
+        if (group != MonitorRegistry::DEFAULT_GROUP) {
+            content.emplace("group", static_cast<int>(group));
+        }
+        // only one message per group is queued at a time, so nothing is lost to coalescing
+        notify(Event{"/values", json11::Json(content).dump(), "application/json",
+                     get_monitor_event_key(group)});
+    }
+    monitor_values.clear();
+    monitor_last_flush = std::chrono::steady_clock::now();
 }
 
-bool setup_monitor(std::string signal_name) {
-    signal_name = get_handle_name(top_name_, signal_name);
-    // get the handle
-    vpiHandle vh;
-    if (vpi_handle_map.find(signal_name) != vpi_handle_map.end()) {
-        vh = vpi_handle_map.at(signal_name);
-    } else {
-        auto handle = const_cast<char *>(signal_name.c_str());
-        vh = vpi_handle_by_name(handle, nullptr);
+// monitor_lock has to be held
+bool is_monitor_event_pending() {
+    if (!event_sender) return false;
+    std::set<uint32_t> groups;
+    for (auto const &iter : monitor_values) {
+        groups.emplace(monitors.get_report_group(iter.first));
     }
-    if (!vh) {
-        // not found
-        return false;
+    for (auto group : groups) {
+        if (event_sender->is_pending(get_monitor_event_key(group))) return true;
+    }
+    return false;
+}
+
+PLI_INT32 cb_flush_monitor_values(p_cb_data) {
+    std::lock_guard guard(monitor_lock);
+    monitor_flush_scheduled = false;
+    if (monitor_values.empty() || !has_event_listener()) return 0;
+    auto throttled = std::chrono::steady_clock::now() - monitor_last_flush < monitor_interval;
+    // keep collecting if the debugger hasn't received the previous message yet
+    auto busy = is_monitor_event_pending();
+    if (throttled || busy) {
+        monitor_flush_deferred = true;
     } else {
-        if (cb_handle_map.find(signal_name) != cb_handle_map.end()) return true;
-        auto cb_handle = new CbHandle();
-        cb_handle_map.emplace(signal_name, cb_handle);
-        cb_handle->time = {vpiSimTime};
-        cb_handle->value = {vpiIntVal};
+        send_monitor_values();
+    }
+    return 0;
+}
 
-        cb_handle->cb_data = {cbValueChange, monitor_signal, nullptr, &(cb_handle->time),
-                              &(cb_handle->value)};
-        cb_handle->cb_data.cb_rtn = monitor_signal;
-        cb_handle->cb_data.obj = vh;
-        cb_handle->name = (char *)calloc(0, signal_name.size() + 1);
-        strncpy(cb_handle->name, signal_name.c_str(), signal_name.size());
-        cb_handle->cb_data.user_data = cb_handle->name;
+// flushes at the end of the current time step. monitor_lock has to be held
+void schedule_monitor_flush() {
+    if (monitor_flush_scheduled) return;
+    static s_vpi_time time;
+    time = {vpiSimTime, 0, 0, 0};
+    s_cb_data cb_data;
+    cb_data.reason = cbReadOnlySynch;
+    cb_data.cb_rtn = &cb_flush_monitor_values;
+    cb_data.obj = nullptr;
+    cb_data.time = &time;
+    cb_data.value = nullptr;
+    cb_data.index = 0;
+    cb_data.user_data = nullptr;
+    auto handle = vpi_register_cb(&cb_data);
+    if (!handle) {
+        std::cerr << "ERROR: failed to register monitor flush" << std::endl;
+        return;
+    }
+    vpi_free_object(handle);
+    monitor_flush_scheduled = true;
+    monitor_flush_deferred = false;
+}
 
-        auto r = vpi_register_cb(&cb_handle->cb_data);
+uint64_t get_sim_time() {
+    s_vpi_time time{vpiSimTime, 0, 0, 0};
+    vpi_get_time(nullptr, &time);
+    return static_cast<uint64_t>(time.high) << 32u | time.low;
+}
 
-        cb_handle->cb_handle = r;
+void sample_capture() {
+    std::lock_guard guard(capture_lock);
+    if (capture) capture->sample(get_sim_time());
+}
 
-        printf("monitor added to %s\n", signal_name.c_str());
+json11::Json get_golden_mismatch(const std::string &name, const GoldenMismatch &mismatch) {
+    std::vector<json11::Json> sources;
+    auto db = get_db();
+    if (db) {
+        // the database doesn't know the top name the simulator uses
+        auto db_name = name;
+        if (!top_name_.empty() && db_name.rfind(top_name_, 0) == 0) {
+            db_name = db_name.substr(top_name_.size());
+            if (!db_name.empty() && db_name.front() == '.') db_name = db_name.substr(1);
+        }
+        for (auto const &[filename, line_num] : db->get_signal_sources(db_name, 4)) {
+            sources.emplace_back(json11::Json::object{{"filename", filename},
+                                                      {"line_num", static_cast<int>(line_num)}});
+        }
+    }
+    json11::Json::object result = {{"name", name},
+                                   {"expected", fmt::format("{0}", mismatch.expected)},
+                                   {"actual", fmt::format("{0}", mismatch.actual)},
+                                   {"sources", sources}};
+    // bits of the actual value that are X or Z
+    if (mismatch.unknown) result.emplace("unknown", fmt::format("{0}", mismatch.unknown));
+    return result;
+}
 
-        return true;
+// compares the state with the expected trace. returns true if the simulation paused because
+// of a mismatch
+bool check_golden(bool can_pause) {
+    std::vector<GoldenMismatch> mismatches;
+    std::vector<std::string> names;
+    uint64_t cycle, expected_time;
+    {
+        std::lock_guard guard(golden_lock);
+        if (!golden) return false;
+        for (uint64_t i = 0; i < golden_handles.size(); i++) {
+            golden_values[i] =
+                read_signal_value(golden_handles[i], golden_widths[i], &golden_unknown[i]);
+        }
+        cycle = golden->cycle();
+        expected_time = golden->expected_time();
+        golden->check(golden_values, golden_unknown, mismatches);
+        if (mismatches.empty()) {
+            if (!golden->done()) return false;
+            printf("Golden trace matched %lu cycles\n", static_cast<unsigned long>(cycle + 1));
+            golden_result = json11::Json::object{{"cycles", fmt::format("{0}", cycle + 1)},
+                                                 {"mismatches", json11::Json::array{}}};
+            golden = nullptr;
+            return false;
+        }
+        names = golden->names();
+        // only the first divergence is reported
+        golden = nullptr;
+    }
+    printf("Golden trace diverged at cycle %lu\n", static_cast<unsigned long>(cycle));
+    std::vector<json11::Json> signals;
+    signals.reserve(mismatches.size());
+    for (auto const &mismatch : mismatches) {
+        signals.emplace_back(get_golden_mismatch(names[mismatch.signal], mismatch));
+    }
+    auto time = get_simulation_time("");
+    auto result = json11::Json(json11::Json::object{{"cycle", fmt::format("{0}", cycle)},
+                                                    {"time", time ? *time : "ERROR"},
+                                                    {"expected_time",
+                                                     fmt::format("{0}", expected_time)},
+                                                    {"mismatches", signals}});
+    {
+        std::lock_guard guard(golden_lock);
+        golden_result = result;
+    }
+    if (!can_pause || (!has_event_listener() && !use_client_request)) return false;
+    begin_pause_values();
+    if (has_event_listener()) {
+        begin_pause();
+        notify(Event{"/status/golden", result.dump(), "application/json"});
+    }
+    pause_sim();
+    return true;
+}
+
+int monitor_signal(p_cb_data cb_data_p) {
+    auto id = MonitorRegistry::get_id(cb_data_p);
+    if (!monitors.record_change(id)) return 0;
+    auto value = get_vector_value(cb_data_p->value->value.vector, monitors.get_width(id));
+    if (recorder) {
+        auto const *time = cb_data_p->time;
+        auto sim_time = static_cast<uint64_t>(time->high) << 32u | time->low;
+        recorder->record(monitors.get_name(id), sim_time, static_cast<int64_t>(value),
+                         monitors.get_width(id));
+    }
+    if (!has_event_listener()) return 0;
+    std::lock_guard guard(monitor_lock);
+    monitor_values[id] = value;
+    schedule_monitor_flush();
+    return 0;
+}
+
+// changes read by the runtime instead of a value change callback
+void report_monitor_changes(const std::vector<std::pair<uint32_t, int64_t>> &changes) {
+    if (recorder && !changes.empty()) {
+        auto time = get_sim_time();
+        for (auto const &[id, value] : changes) {
+            recorder->record(monitors.get_name(id), time, value, monitors.get_width(id));
+        }
+    }
+    if (changes.empty() || !has_event_listener()) return;
+    std::lock_guard guard(monitor_lock);
+    for (auto const &[id, value] : changes) {
+        monitor_values[id] = static_cast<uint64_t>(value);
+    }
+    schedule_monitor_flush();
+}
+
+// polled monitors are read at every clock edge. the changes are sent the same way as the ones
+// from value change callbacks
+void sample_monitors() {
+    if (monitor_flush_deferred) {
+        std::lock_guard guard(monitor_lock);
+        schedule_monitor_flush();
     }
+    static std::vector<std::pair<uint32_t, int64_t>> changes;
+    changes.clear();
+    monitors.sample(changes);
+    report_monitor_changes(changes);
+}
+
+// sends whatever is left, including a held-back flush, e.g. when the simulation pauses or
+// finishes
+void flush_monitor_values() {
+    std::lock_guard guard(monitor_lock);
+    monitor_flush_deferred = false;
+    if (monitor_values.empty() || !has_event_listener()) return;
+    // the previous message has to be delivered first, otherwise the two are coalesced and the
+    // values only in the previous one are lost
+    if (is_monitor_event_pending()) event_sender->flush();
+    send_monitor_values();
+}
+
+std::optional<uint32_t> setup_monitor(std::string signal_name,
+                                      uint32_t group = MonitorRegistry::DEFAULT_GROUP) {
+    signal_name = get_handle_name(top_name_, signal_name);
+    auto vh = get_vpi_handle(signal_name);
+    // not found
+    if (!vh) return std::nullopt;
+    return monitors.add(signal_name, vh, group);
 }
 
 bool remove_monitor(std::string signal_name) {
     signal_name = get_handle_name(top_name_, signal_name);
-    if (cb_handle_map.find(signal_name) == cb_handle_map.end()) return false;
-    auto cb = cb_handle_map.at(signal_name);
-    printf("monitor removed from %s\n", signal_name.c_str());
+    auto id = monitors.remove(signal_name);
+    if (!id) return false;
+    // the id may be reused by the next monitor
+    std::lock_guard guard(monitor_lock);
+    monitor_values.erase(*id);
+    return true;
+}
 
-    auto r = vpi_remove_cb(cb->cb_handle);
+// nets and registers under the scope, including the ones in child instances
+void get_scope_signals(vpiHandle scope, std::vector<std::pair<std::string, vpiHandle>> &signals) {
+    for (auto type : {vpiNet, vpiReg}) {
+        auto iter = vpi_iterate(type, scope);
+        if (!iter) continue;
+        // the iterator is freed once the scan is done
+        while (auto handle = vpi_scan(iter)) {
+            auto name = vpi_get_str(vpiFullName, handle);
+            if (name) signals.emplace_back(name, handle);
+        }
+    }
+    auto iter = vpi_iterate(vpiModule, scope);
+    if (!iter) return;
+    while (auto handle = vpi_scan(iter)) {
+        get_scope_signals(handle, signals);
+    }
+}
 
-    free(cb->name);
-    vpi_free_object(cb->cb_handle);
-    delete cb;
+// returns the group and the number of signals monitored
+std::optional<std::pair<uint32_t, uint32_t>> setup_scope_monitor(std::string scope_name) {
+    scope_name = get_handle_name(top_name_, scope_name);
+    auto scope = get_vpi_handle(scope_name);
+    if (!scope) return std::nullopt;
+    std::vector<std::pair<std::string, vpiHandle>> signals;
+    get_scope_signals(scope, signals);
+    auto group = monitors.add_group(true);
+    uint32_t count = 0;
+    for (auto const &[name, handle] : signals) {
+        // signals that are already monitored stay in their group
+        auto id = monitors.add(name, handle, group);
+        if (id && monitors.get_report_group(*id) == group) count++;
+    }
+    return std::make_pair(group, count);
+}
 
-    return r == 1;
+void remove_monitor_group(uint32_t group) {
+    auto ids = monitors.remove_group(group);
+    std::lock_guard guard(monitor_lock);
+    for (auto id : ids) {
+        monitor_values.erase(id);
+    }
 }
 
 void remove_all_monitor() {
-    std::unordered_set<CbHandle *> handles;
-    for (auto const &iter : cb_handle_map) {
-        auto cb = iter.second;
-        vpi_remove_cb(cb->cb_handle);
-        handles.emplace(cb);
-    }
-    cb_handle_map.clear();
-    for (auto cb : handles) {
-        free(cb->name);
-        vpi_free_object(cb->cb_handle);
-        delete cb;
-    }
-    printf("monitors removed\n");
+    monitors.clear();
+    std::lock_guard guard(monitor_lock);
+    monitor_values.clear();
 }
 
 std::string get_connection_str(const std::string &handle_name, bool is_from) {
+    auto db = get_db();
+    if (!db) return "[]";
     auto result =
-        is_from ? db_->get_connection_from(handle_name) : db_->get_connection_to(handle_name);
+        is_from ? db->get_connection_from(handle_name) : db->get_connection_to(handle_name);
     struct ConnectionWrapper {
         std::string handle_from;
         std::string var_from;
@@ -655,13 +1466,86 @@ void set_error(int error_code, const std::string &error_message, httplib::Respon
     res.set_content(error_message, "text/plain");
 }
 
+std::unique_ptr<EventSender> create_event_sender(const std::string &ip, int port) {
+    auto client = std::make_shared<httplib::Client>(ip.c_str(), port);
+    // reuse the same connection for every event
+    client->set_keep_alive(true);
+    auto capacity = DEFAULT_EVENT_QUEUE_SIZE;
+    auto env_size = std::getenv("KRATOS_EVENT_QUEUE_SIZE");
+    if (env_size) {
+        try {
+            capacity = std::stoul(env_size);
+        } catch (const std::invalid_argument &) {
+            std::cerr << "Unable to set event queue size to " << env_size << std::endl;
+        }
+    }
+    auto policy = BackpressurePolicy::Coalesce;
+    auto env_policy = std::getenv("KRATOS_EVENT_POLICY");
+    if (env_policy) {
+        auto value = parse_backpressure_policy(env_policy);
+        if (value) {
+            policy = *value;
+        } else {
+            std::cerr << "Unknown event policy " << env_policy << std::endl;
+        }
+    }
+    return std::make_unique<EventSender>(
+        [client](const Event &event) {
+            client->Post(event.path.c_str(), event.content, event.content_type.c_str());
+        },
+        capacity, policy);
+}
+
+uint32_t get_uint_param(const httplib::Request &req, const char *name, uint32_t default_value) {
+    if (!req.has_param(name)) return default_value;
+    try {
+        return static_cast<uint32_t>(std::stoul(req.get_param_value(name)));
+    } catch (...) {
+        return default_value;
+    }
+}
+
+// handlers that read the simulation through VPI
+httplib::Server::Handler reader(httplib::Server::Handler handler) {
+    return [handler](const httplib::Request &req, httplib::Response &res) {
+        read_sim([&]() { handler(req, res); });
+    };
+}
+
+// readers that need the database wait for it to load before taking the lock
+httplib::Server::Handler db_reader(httplib::Server::Handler handler) {
+    return [handler](const httplib::Request &req, httplib::Response &res) {
+        wait_db();
+        read_sim([&]() { handler(req, res); });
+    };
+}
+
+// every route is served by both the TCP and the Unix domain socket server
+struct Routes {
+    void Get(const char *pattern, const httplib::Server::Handler &handler) {
+        http_server->Get(pattern, handler);
+        socket_server->Get(pattern, handler);
+    }
+    void Post(const char *pattern, const httplib::Server::Handler &handler) {
+        http_server->Post(pattern, handler);
+        socket_server->Post(pattern, handler);
+    }
+    void Delete(const char *pattern, const httplib::Server::Handler &handler) {
+        http_server->Delete(pattern, handler);
+        socket_server->Delete(pattern, handler);
+    }
+};
+
 void initialize_runtime() {
     using namespace httplib;
     http_server = std::make_unique<Server>();
+    socket_server = std::make_unique<UnixSocketServer>();
+    Routes routes;
 
     // setup call backs
-    http_server->Get(R"(/breakpoint/(.*))", [](const Request &req, Response &res) {
-        vpi_lock.lock();
+    // breakpoint lookups may wait for the database to load, so they are done before taking
+    // the vpi lock to avoid blocking other requests
+    routes.Get(R"(/breakpoint/(.*))", [](const Request &req, Response &res) {
         auto op_fn_ln = get_fn_ln(req.matches.size() > 1 ? req.matches[1].str(): "");
         if (op_fn_ln) {
             auto const &[fn, ln] = *op_fn_ln;
@@ -670,83 +1554,87 @@ void initialize_runtime() {
         } else {
             set_error(401, "Invalid breakpoint request", res);
         }
-        vpi_lock.unlock();
     });
 
-    http_server->Post("/breakpoint", [](const Request &req, Response &res) {
-        vpi_lock.lock();
+    routes.Post("/breakpoint", [](const Request &req, Response &res) {
         auto bp_info = parse_bp_json(req.body);
-        if (bp_info) {
+        // expressions need the database
+        if (bp_info && !bp_info->second.empty()) wait_db();
+        if (!bp_info) {
+            set_error(401, "Invalid breakpoint request", res);
+            return;
+        }
+        write_sim([&]() {
             auto const &[bp_id, expr] = *bp_info;
             add_break_point(bp_id);
             if (!expr.empty()) {
                 add_breakpoint_expr(bp_id, expr);
             }
-        } else {
-            set_error(401, "Invalid breakpoint request", res);
-        }
-        vpi_lock.unlock();
+        });
     });
 
-    http_server->Delete("/breakpoint", [](const Request &req, Response &res) {
-        vpi_lock.lock();
+    routes.Delete("/breakpoint", [](const Request &req, Response &res) {
         auto op_fn_ln = get_fn_ln(req.matches.size() > 1 ? req.matches[1].str(): "");
+        std::vector<std::pair<uint32_t, uint32_t>> bps;
         if (op_fn_ln) {
             auto const &[fn, ln] = *op_fn_ln;
-            auto bps = get_breakpoint(fn, ln);
-            if (db_ && !bps.empty()) {
-                for (auto const &[id, col] : bps) {
-                    remove_break_point(id);
-                    remove_expr(id);
-
-                    printf("Breakpoint removed from %d\n", id);
-                }
-            } else {
-                res.status = 401;
-                res.set_content("ERROR", "text/plain");
-            }
-        } else {
+            bps = get_breakpoint(fn, ln);
+        }
+        if (!op_fn_ln) {
             set_error(401, "ERROR", res);
+            return;
+        }
+        if (bps.empty()) {
+            res.status = 401;
+            res.set_content("ERROR", "text/plain");
+            return;
         }
-        vpi_lock.unlock();
+        write_sim([&]() {
+            for (auto const &[id, col] : bps) {
+                remove_break_point(id);
+                remove_expr(id);
+
+                printf("Breakpoint removed from %d\n", id);
+            }
+        });
     });
 
-    http_server->Delete(R"(/breakpoint/(\d+))", [](const Request &req, Response &res) {
+    routes.Delete(R"(/breakpoint/(\d+))", [](const Request &req, Response &res) {
         auto num = req.matches[1];
-        vpi_lock.lock();
+        int id;
         try {
-            auto id = std::stoi(num);
-            remove_break_point(id);
-            remove_expr(id);
-            vpi_lock.unlock();
-            printf("Breakpoint removed from %d\n", id);
-            res.status = 200;
-            res.set_content("Okay", "text/plain");
-            return;
+            id = std::stoi(num);
         } catch (...) {
-            vpi_lock.unlock();
             res.status = 401;
             res.set_content("ERROR", "text/plain");
             return;
         }
+        write_sim([&]() {
+            remove_break_point(id);
+            remove_expr(id);
+        });
+        printf("Breakpoint removed from %d\n", id);
+        res.status = 200;
+        res.set_content("Okay", "text/plain");
     });
 
     // delete all breakpoint from a file
-    http_server->Delete(R"(/breakpoint/file/(.*))", [](const Request &req, Response &res) {
+    routes.Delete(R"(/breakpoint/file/(.*))", [](const Request &req, Response &res) {
         auto filename = req.matches[1];
-        vpi_lock.lock();
         auto bps = get_breakpoint_filename(filename, res);
-        for (auto const &bp : bps) {
-            remove_break_point(bp);
-            remove_expr(bp);
-        }
-        vpi_lock.unlock();
+        write_sim([&]() {
+            for (auto const &bp : bps) {
+                remove_break_point(bp);
+                remove_expr(bp);
+            }
+        });
     });
 
     // get all the files
-    http_server->Get("/files", [](const Request &req, Response &res) {
-        if (db_) {
-            auto names = db_->get_all_files();
+    routes.Get("/files", [](const Request &req, Response &res) {
+        auto db = get_db();
+        if (db) {
+            auto names = db->get_all_files();
             struct StrValue {
                 std::string value;
                 [[nodiscard]] std::string to_json() const { return value; }
@@ -765,7 +1653,7 @@ void initialize_runtime() {
         }
     });
 
-    http_server->Get(R"(/value/([\w.$]+))", [](const Request &req, Response &res) {
+    routes.Get(R"(/value/([\w.$]+))", reader([](const Request &req, Response &res) {
         auto name = req.matches[1];
         auto result = get_value(name);
         if (result) {
@@ -775,13 +1663,32 @@ void initialize_runtime() {
             res.status = 401;
             res.set_content("ERROR", "text/plain");
         }
-    });
+    }));
 
-    http_server->Get("/values", [](const Request &req, Response &res) {
+    routes.Get("/values", reader([](const Request &req, Response &res) {
         std::string err;
         auto json = json11::Json::parse(req.body, err);
         if (err.empty()) {
             auto const &lst = json.array_items();
+            if (accept_msgpack(req.get_header_value("Accept"))) {
+                // [[name, value], ...] with values at their full width. nil if not found
+                MsgPackWriter writer;
+                writer.write_array(static_cast<uint32_t>(lst.size()));
+                for (auto const &entry : lst) {
+                    auto const &name = entry.string_value();
+                    writer.write_array(2);
+                    writer.write_str(name);
+                    auto v = get_raw_value(name);
+                    if (v) {
+                        writer.write_value(*v);
+                    } else {
+                        writer.write_nil();
+                    }
+                }
+                res.status = 200;
+                res.set_content(writer.data(), MSGPACK_CONTENT_TYPE);
+                return;
+            }
             struct Entry {
                 std::string name;
                 std::string value;
@@ -809,9 +1716,21 @@ void initialize_runtime() {
             res.status = 401;
             res.set_content("[]", "application/json");
         }
+    }));
+
+    routes.Post("/values", [](const Request &req, Response &res) {
+        std::string error;
+        bool result = false;
+        write_sim([&]() { result = put_values(req.body, error); });
+        if (result) {
+            res.status = 200;
+            res.set_content("Okay", "text/plain");
+        } else {
+            set_error(401, error, res);
+        }
     });
 
-    http_server->Get("/time", [](const Request &req, Response &res) {
+    routes.Get("/time", reader([](const Request &req, Response &res) {
         auto time = get_simulation_time("");
         if (time) {
             res.status = 200;
@@ -820,13 +1739,42 @@ void initialize_runtime() {
             res.status = 401;
             res.set_content("ERROR", "text/plain");
         }
+    }));
+
+    // moves a replay to the time. simulations can't go back in time
+    routes.Post(R"(/time/(\d+))", [](const Request &req, Response &res) {
+        uint64_t time;
+        try {
+            time = std::stoull(req.matches[1]);
+        } catch (...) {
+            set_error(401, "Invalid time", res);
+            return;
+        }
+        std::string error;
+        write_sim([&]() {
+            if (!time_seek) {
+                error = "Only replays can move the time";
+            } else if (!paused) {
+                error = "Replay is not paused";
+            } else {
+                time_seek(time);
+                // values read before are stale
+                clear_pause_values();
+                invalidate_graph_value();
+            }
+        });
+        if (!error.empty()) {
+            set_error(401, error, res);
+            return;
+        }
+        res.status = 200;
+        res.set_content("Okay", "text/plain");
     });
 
-    http_server->Post(R"(/monitor/([\w.$]+))", [](const Request &req, Response &res) {
+    routes.Post(R"(/monitor/([\w.$]+))", [](const Request &req, Response &res) {
         auto name = req.matches[1];
-        vpi_lock.lock();
-        auto result = setup_monitor(name);
-        vpi_lock.unlock();
+        bool result;
+        write_sim([&]() { result = setup_monitor(name).has_value(); });
         if (result) {
             res.status = 200;
             res.set_content("Okay", "text/plain");
@@ -836,11 +1784,10 @@ void initialize_runtime() {
         }
     });
 
-    http_server->Delete(R"(/monitor/([\w.$]+))", [](const Request &req, Response &res) {
+    routes.Delete(R"(/monitor/([\w.$]+))", [](const Request &req, Response &res) {
         auto name = req.matches[1];
-        vpi_lock.lock();
-        auto result = remove_monitor(name);
-        vpi_lock.unlock();
+        bool result;
+        write_sim([&]() { result = remove_monitor(name); });
         if (result) {
             res.status = 200;
             res.set_content("Okay", "text/plain");
@@ -850,36 +1797,328 @@ void initialize_runtime() {
         }
     });
 
-    http_server->Delete("/monitor", [](const Request &req, Response &res) {
-        vpi_lock.lock();
-        remove_all_monitor();
-        vpi_lock.unlock();
+    routes.Delete("/monitor", [](const Request &req, Response &res) {
+        write_sim([]() { remove_all_monitor(); });
+        res.status = 200;
+        res.set_content("Okay", "text/plain");
+    });
+
+    // monitors a list of signals, e.g. a whole register file, in one request. returns the
+    // monitor ids in the same order, -1 if the signal is not found. the signals form a group
+    // that is either watched with callbacks or polled at clock edges
+    routes.Post("/monitors", [](const Request &req, Response &res) {
+        std::string err;
+        auto json = json11::Json::parse(req.body, err);
+        if (!err.empty() || !json.is_array()) {
+            set_error(401, "Invalid monitor request", res);
+            return;
+        }
+        std::vector<int> ids;
+        ids.reserve(json.array_items().size());
+        write_sim([&]() {
+            auto group = monitors.add_group();
+            for (auto const &name : json.array_items()) {
+                auto id = setup_monitor(name.string_value(), group);
+                ids.emplace_back(id ? static_cast<int>(*id) : -1);
+            }
+        });
+        res.status = 200;
+        res.set_content(json11::Json(ids).dump(), "application/json");
+    });
+
+    // monitors every net and register under a scope, including child instances, as one group.
+    // its values are sent in their own messages with the group id
+    routes.Post(R"(/monitors/scope/([\w.$]+))", [](const Request &req, Response &res) {
+        auto name = req.matches[1];
+        std::optional<std::pair<uint32_t, uint32_t>> result;
+        write_sim([&]() { result = setup_scope_monitor(name); });
+        if (!result) {
+            set_error(401, fmt::format("Scope {0} not found", std::string(name)), res);
+            return;
+        }
+        auto [group, size] = *result;
+        auto json = json11::Json(json11::Json::object{{"group", static_cast<int>(group)},
+                                                      {"size", static_cast<int>(size)}});
+        res.status = 200;
+        res.set_content(json.dump(), "application/json");
+    });
+
+    routes.Post(R"(/monitors/group/(\d+)/(enable|disable))",
+                [](const Request &req, Response &res) {
+                    auto group = static_cast<uint32_t>(std::stoul(req.matches[1]));
+                    auto enabled = req.matches[2] == "enable";
+                    bool result = false;
+                    write_sim([&]() {
+                        // signals that changed while the group was disabled
+                        std::vector<std::pair<uint32_t, int64_t>> changes;
+                        result = monitors.set_group_enabled(group, enabled, changes);
+                        report_monitor_changes(changes);
+                    });
+                    if (result) {
+                        res.status = 200;
+                        res.set_content("Okay", "text/plain");
+                    } else {
+                        set_error(401, "Monitor group not found", res);
+                    }
+                });
+
+    routes.Delete(R"(/monitors/group/(\d+))", [](const Request &req, Response &res) {
+        auto group = static_cast<uint32_t>(std::stoul(req.matches[1]));
+        write_sim([&]() { remove_monitor_group(group); });
         res.status = 200;
         res.set_content("Okay", "text/plain");
     });
 
-    http_server->Post("/continue", [](const Request &req, Response &res) {
+    // value of a recorded signal at ?time=
+    routes.Get(R"(/record/value/([\w.$]+))", [](const Request &req, Response &res) {
+        if (!recorder || !req.has_param("time")) {
+            set_error(401, "Invalid record request", res);
+            return;
+        }
+        auto name = get_handle_name(top_name_, req.matches[1]);
+        std::optional<int64_t> value;
+        try {
+            value = recorder->get_value(name, std::stoull(req.get_param_value("time")));
+        } catch (...) {
+            set_error(401, "Invalid time", res);
+            return;
+        }
+        if (!value) {
+            set_error(401, fmt::format("No value recorded for {0}", name), res);
+            return;
+        }
+        res.status = 200;
+        res.set_content(fmt::format("{0}", *value), "text/plain");
+    });
+
+    // changes of a recorded signal in [?begin=, ?end=] as a list of [time, value]
+    routes.Get(R"(/record/changes/([\w.$]+))", [](const Request &req, Response &res) {
+        if (!recorder) {
+            set_error(401, "Recording is not enabled", res);
+            return;
+        }
+        auto name = get_handle_name(top_name_, req.matches[1]);
+        uint64_t begin = 0, end = std::numeric_limits<uint64_t>::max();
+        try {
+            if (req.has_param("begin")) begin = std::stoull(req.get_param_value("begin"));
+            if (req.has_param("end")) end = std::stoull(req.get_param_value("end"));
+        } catch (...) {
+            set_error(401, "Invalid time", res);
+            return;
+        }
+        std::vector<json11::Json> changes;
+        for (auto const &[time, value] : recorder->get_changes(name, begin, end)) {
+            // times and values are strings, like in /values, so that they keep 64 bits
+            changes.emplace_back(json11::Json::array{fmt::format("{0}", time),
+                                                     fmt::format("{0}", value)});
+        }
+        res.status = 200;
+        res.set_content(json11::Json(changes).dump(), "application/json");
+    });
+
+    // overview of a recorded signal in [?begin=, ?end=] with at most about ?buckets= buckets.
+    // buckets without changes are left out
+    routes.Get(R"(/record/summary/([\w.$]+))", [](const Request &req, Response &res) {
+        if (!recorder) {
+            set_error(401, "Recording is not enabled", res);
+            return;
+        }
+        auto name = get_handle_name(top_name_, req.matches[1]);
+        uint64_t begin = 0, end = std::numeric_limits<uint64_t>::max();
+        try {
+            if (req.has_param("begin")) begin = std::stoull(req.get_param_value("begin"));
+            if (req.has_param("end")) end = std::stoull(req.get_param_value("end"));
+        } catch (...) {
+            set_error(401, "Invalid time", res);
+            return;
+        }
+        auto max_buckets = get_uint_param(req, "buckets", DEFAULT_SUMMARY_BUCKETS);
+        std::vector<json11::Json> buckets;
+        for (auto const &bucket : recorder->get_summary(name, begin, end, max_buckets)) {
+            buckets.emplace_back(json11::Json::object{{"time", fmt::format("{0}", bucket.time)},
+                                                      {"width", fmt::format("{0}", bucket.width)},
+                                                      {"min", fmt::format("{0}", bucket.min)},
+                                                      {"max", fmt::format("{0}", bucket.max)},
+                                                      {"count", fmt::format("{0}", bucket.count)},
+                                                      {"last", fmt::format("{0}", bucket.last)}});
+        }
+        res.status = 200;
+        res.set_content(json11::Json(buckets).dump(), "application/json");
+    });
+
+    // captures a set of signals at every clock edge into a columnar file, without pausing.
+    // the body is {"filename", "signals": [handles], "sample": true} where sample also
+    // captures the current state, e.g. when paused at a clock edge
+    routes.Post("/capture", [](const Request &req, Response &res) {
+        std::string err;
+        auto json = json11::Json::parse(req.body, err);
+        if (!err.empty() || !json["filename"].is_string() || !json["signals"].is_array()) {
+            set_error(401, "Invalid capture request", res);
+            return;
+        }
+        std::optional<std::string> missing;
+        bool opened = false;
+        write_sim([&]() {
+            std::vector<std::string> names;
+            std::vector<vpiHandle> handles;
+            for (auto const &signal : json["signals"].array_items()) {
+                auto name = get_handle_name(top_name_, signal.string_value());
+                auto vh = get_vpi_handle(name);
+                if (!vh) {
+                    missing = name;
+                    return;
+                }
+                names.emplace_back(name);
+                handles.emplace_back(vh);
+            }
+            auto state_capture = std::make_unique<StateCapture>();
+            if (!state_capture->open(json["filename"].string_value(), names, handles)) return;
+            if (json["sample"].bool_value()) state_capture->sample(get_sim_time());
+            std::lock_guard guard(capture_lock);
+            capture = std::move(state_capture);
+            opened = true;
+        });
+        if (missing) {
+            set_error(401, fmt::format("Unable to find {0}", *missing), res);
+        } else if (!opened) {
+            set_error(401, "Unable to open capture file", res);
+        } else {
+            res.status = 200;
+            res.set_content("Okay", "text/plain");
+        }
+    });
+
+    // compares the state at every clock edge with an expected trace in the capture format and
+    // pauses at the first mismatch. the body is {"filename", "sample": true}, where sample
+    // also compares the current state with the first row
+    routes.Post("/golden", [](const Request &req, Response &res) {
+        std::string err;
+        auto json = json11::Json::parse(req.body, err);
+        if (!err.empty() || !json["filename"].is_string()) {
+            set_error(401, "Invalid golden request", res);
+            return;
+        }
+        auto data = read_capture_file(json["filename"].string_value());
+        if (!data) {
+            set_error(401, "Unable to read golden trace", res);
+            return;
+        }
+        auto trace = std::make_unique<GoldenTrace>(std::move(*data));
+        std::optional<std::string> missing;
+        write_sim([&]() {
+            std::vector<vpiHandle> handles;
+            std::vector<uint32_t> widths;
+            auto const &names = trace->names();
+            for (uint64_t i = 0; i < names.size(); i++) {
+                auto vh = get_vpi_handle(get_handle_name(top_name_, names[i]));
+                if (!vh) {
+                    missing = names[i];
+                    return;
+                }
+                handles.emplace_back(vh);
+                // a trace narrower than the signal, e.g. one converted from dump_state, is
+                // compared with the low bits only
+                auto width = static_cast<uint32_t>(vpi_get(vpiSize, vh));
+                widths.emplace_back(std::min(width, trace->widths()[i]));
+            }
+            {
+                std::lock_guard guard(golden_lock);
+                golden = std::move(trace);
+                golden_handles = std::move(handles);
+                golden_widths = std::move(widths);
+                golden_values.assign(golden_handles.size(), 0);
+                golden_unknown.assign(golden_handles.size(), 0);
+                golden_result = nullptr;
+            }
+            // the simulation is already paused, so a mismatch is only reported
+            if (json["sample"].bool_value()) check_golden(false);
+        });
+        if (missing) {
+            set_error(401, fmt::format("Unable to find {0}", *missing), res);
+            return;
+        }
+        res.status = 200;
+        res.set_content("Okay", "text/plain");
+    });
+
+    // progress of the comparison, or its result once it's done
+    routes.Get("/golden", [](const Request &req, Response &res) {
+        json11::Json result;
+        {
+            std::lock_guard guard(golden_lock);
+            if (golden) {
+                result = json11::Json::object{
+                    {"cycle", fmt::format("{0}", golden->cycle())},
+                    {"rows", fmt::format("{0}", golden->num_rows())}};
+            } else {
+                result = golden_result;
+            }
+        }
+        res.status = 200;
+        res.set_content(result.dump(), "application/json");
+    });
+
+    routes.Delete("/golden", [](const Request &req, Response &res) {
+        {
+            std::lock_guard guard(golden_lock);
+            golden = nullptr;
+        }
+        res.status = 200;
+        res.set_content("Okay", "text/plain");
+    });
+
+    // stops the capture and returns the number of rows captured
+    routes.Delete("/capture", [](const Request &req, Response &res) {
+        uint64_t rows = 0;
+        {
+            std::lock_guard guard(capture_lock);
+            if (capture) rows = capture->close();
+            capture = nullptr;
+        }
+        res.status = 200;
+        res.set_content(std::to_string(rows), "text/plain");
+    });
+
+    // removes a list of monitors. returns the number of monitors removed
+    routes.Delete("/monitors", [](const Request &req, Response &res) {
+        std::string err;
+        auto json = json11::Json::parse(req.body, err);
+        if (!err.empty() || !json.is_array()) {
+            set_error(401, "Invalid monitor request", res);
+            return;
+        }
+        uint32_t count = 0;
+        write_sim([&]() {
+            for (auto const &name : json.array_items()) {
+                if (remove_monitor(name.string_value())) count++;
+            }
+        });
+        res.status = 200;
+        res.set_content(std::to_string(count), "text/plain");
+    });
+
+    routes.Post("/continue", [](const Request &req, Response &res) {
         step_over = false;
         un_pause_sim();
         res.status = 200;
         res.set_content("Okay", "text/plain");
     });
 
-    http_server->Post("/step_over", [](const Request &req, Response &res) {
+    routes.Post("/step_over", [](const Request &req, Response &res) {
         step_over = true;
         un_pause_sim();
         res.status = 200;
         res.set_content("Okay", "text/plain");
     });
 
-    http_server->Post("/top_name", [](const Request &req, Response &res) {
+    routes.Post("/top_name", [](const Request &req, Response &res) {
         std::string value = req.body;
         top_name_ = value + ".";
         res.status = 200;
         res.set_content("Okay", "text/plain");
     });
 
-    http_server->Post(R"(/clock/(\w+))", [](const Request &req, Response &res) {
+    routes.Post(R"(/clock/(\w+))", [](const Request &req, Response &res) {
         std::string value = req.matches[1];
         // set the bool to be true
         printf("pause on clock_edge %s\n", value.c_str());
@@ -889,38 +2128,77 @@ void initialize_runtime() {
         res.set_content("Okay", "text/plain");
     });
 
-    http_server->Post(R"(/hierarchy/([\w.$]+))", [](const Request &req, Response &res) {
+    routes.Post(R"(/hierarchy/([\w.$]+))", [](const Request &req, Response &res) {
         std::string name = req.matches[1];
-        if (db_) {
+        auto db = get_db();
+        if (db) {
             if (name == "$") name = "";
-            auto result = db_->get_hierarchy(name);
+            // large scopes can be paged with offset and limit
+            auto offset = get_uint_param(req, "offset", 0);
+            auto limit = get_uint_param(req, "limit", std::numeric_limits<uint32_t>::max());
+            auto result = db->get_hierarchy(name, offset, limit);
             // set the current scope
-            current_scope = name;
+            set_current_scope(name);
 
             std::vector<std::string> names;
+            std::vector<int> sizes;
             names.reserve(result.size());
+            sizes.reserve(result.size());
             for (auto const &h : result) {
                 names.emplace_back(fmt::format("{0}.{1}", h.parent_handle, h.child));
+                sizes.emplace_back(static_cast<int>(h.size));
             }
-            std::string content;
+            auto total = db->get_num_children(name);
+            res.status = 200;
+            if (accept_msgpack(req.get_header_value("Accept"))) {
+                // same keys as the JSON object, with the values at their full width
+                MsgPackWriter writer;
+                writer.write_map(has_paused_on_clock ? 4 : 3);
+                writer.write_str("name");
+                writer.write_array(static_cast<uint32_t>(names.size()));
+                for (auto const &n : names) writer.write_str(n);
+                writer.write_str("size");
+                writer.write_array(static_cast<uint32_t>(sizes.size()));
+                for (auto const size : sizes) writer.write_uint(size);
+                writer.write_str("total");
+                writer.write_uint(total);
+                if (has_paused_on_clock) {
+                    writer.write_str("value");
+                    read_sim([&]() { write_graph_value(writer, name); });
+                }
+                res.set_content(writer.data(), MSGPACK_CONTENT_TYPE);
+                return;
+            }
+            json11::Json::object object = {
+                {"name", names}, {"size", sizes}, {"total", static_cast<int>(total)}};
             if (has_paused_on_clock) {
-                auto values = get_graph_value();
-                content =
-                    json11::Json(json11::Json::object({{"name", names}, {"value", values}})).dump();
-            } else {
-                content = json11::Json(json11::Json::object({{"name", names}})).dump();
+                read_sim([&]() { object.emplace("value", get_graph_value(name)); });
             }
-            res.status = 200;
-            res.set_content(content, "application/json");
+            res.set_content(json11::Json(object).dump(), "application/json");
         } else {
             res.status = 403;
             res.set_content("[]", "application/json");
         }
     });
 
-    http_server->Get(R"(/connection/to/([\w.$]+))", [](const Request &req, Response &res) {
+    // glob (* and ?) or prefix search over instance names
+    routes.Get("/hierarchy/search", [](const Request &req, Response &res) {
+        auto db = get_db();
+        if (!db || !req.has_param("pattern")) {
+            res.status = 403;
+            res.set_content("[]", "application/json");
+            return;
+        }
+        auto pattern = req.get_param_value("pattern");
+        auto limit = get_uint_param(req, "limit", 100);
+        auto names = db->search_hierarchy(pattern, limit);
+        res.status = 200;
+        res.set_content(json11::Json(names).dump(), "application/json");
+    });
+
+    routes.Get(R"(/connection/to/([\w.$]+))", [](const Request &req, Response &res) {
         auto const handle_name = req.matches[1];
-        if (db_) {
+        if (get_db()) {
             auto content = get_connection_str(handle_name, false);
             res.status = 200;
             res.set_content(content, "application/json");
@@ -930,9 +2208,9 @@ void initialize_runtime() {
         }
     });
 
-    http_server->Get(R"(/connection/from/([\w.$]+))", [](const Request &req, Response &res) {
+    routes.Get(R"(/connection/from/([\w.$]+))", [](const Request &req, Response &res) {
         auto const handle_name = req.matches[1];
-        if (db_) {
+        if (get_db()) {
             auto content = get_connection_str(handle_name, true);
             res.status = 200;
             res.set_content(content, "application/json");
@@ -942,7 +2220,7 @@ void initialize_runtime() {
         }
     });
 
-    http_server->Post("/connect", [](const Request &req, Response &res) {
+    routes.Post("/connect", [](const Request &req, Response &res) {
         // parse the content
         auto const &body = req.body;
         std::string err;
@@ -952,6 +2230,8 @@ void initialize_runtime() {
         auto db_json = payload["database"];
         auto src_path_json = payload["src_path"];
         auto dst_path_json = payload["dst_path"];
+        // the debugger polls GET /events instead of running its own server
+        auto stream = payload["stream"].is_bool() && payload["stream"].bool_value();
         // this is a short cut
         if (!ip_json.is_null() && ip_json.is_string()) {
             if (ip_json.string_value() == "255.255.255.255") {
@@ -971,8 +2251,11 @@ void initialize_runtime() {
         }
 
         bool has_error = false;
-        if (port_json.is_null() || ip_json.is_null() || db_json.is_null() ||
-            !port_json.is_number() || !ip_json.is_string() || !db_json.is_string()) {
+        if (db_json.is_null() || !db_json.is_string()) {
+            has_error = true;
+        }
+        if (!stream && (port_json.is_null() || ip_json.is_null() || !port_json.is_number() ||
+                        !ip_json.is_string())) {
             has_error = true;
         }
         if (!has_error) {
@@ -988,13 +2271,22 @@ void initialize_runtime() {
                 has_error = true;
             } else {
                 try {
-                    http_client = std::make_unique<Client>(ip.c_str(), port);
-                    // load up the database
-                    db_ = std::make_unique<Database>(db_filename);
-                    printf("Debugger connected to %s:%d\n", ip.c_str(), port);
+                    if (stream) {
+                        event_sender = nullptr;
+                        use_event_stream = true;
+                    } else {
+                        event_sender = create_event_sender(ip, port);
+                    }
+                    // load up the database in the background. use /status to check
+                    // whether it's ready
+                    load_db(db_filename);
+                    if (stream) {
+                        printf("Debugger connected through event stream\n");
+                    } else {
+                        printf("Debugger connected to %s:%d\n", ip.c_str(), port);
+                    }
                 } catch (...) {
-                    http_client = nullptr;
-                    db_ = nullptr;
+                    event_sender = nullptr;
                     has_error = true;
                 }
             }
@@ -1009,8 +2301,40 @@ void initialize_runtime() {
         }
     });
 
+    // long-poll for the events since a given sequence number
+    routes.Get("/events", [](const Request &req, Response &res) {
+        uint64_t since = 0;
+        try {
+            if (req.has_param("since")) since = std::stoull(req.get_param_value("since"));
+        } catch (...) {
+            set_error(401, "Invalid sequence number", res);
+            return;
+        }
+        auto timeout =
+            std::min(get_uint_param(req, "timeout", DEFAULT_POLL_TIMEOUT_MS), MAX_POLL_TIMEOUT_MS);
+        auto batch = event_stream.poll(since, std::chrono::milliseconds(timeout));
+        struct EventEntry {
+            StreamEvent entry;
+            [[nodiscard]] json11::Json to_json() const {
+                return json11::Json::object{{{"seq", static_cast<double>(entry.seq)},
+                                             {"path", entry.event.path},
+                                             {"content", entry.event.content},
+                                             {"content_type", entry.event.content_type}}};
+            }
+        };
+        std::vector<EventEntry> events;
+        events.reserve(batch.events.size());
+        for (auto &entry : batch.events) events.emplace_back(EventEntry{std::move(entry)});
+        auto content = json11::Json(json11::Json::object{
+            {{"next", static_cast<double>(batch.next_seq)},
+             {"missed", batch.missed},
+             {"events", events}}});
+        res.status = 200;
+        res.set_content(content.dump(), "application/json");
+    });
+
     // stop
-    http_server->Post("/stop", [](const Request &req, Response &res) {
+    routes.Post("/stop", [](const Request &req, Response &res) {
         printf("stop\n");
         // stop the simulation
         vpi_control(vpiFinish, 1);
@@ -1021,18 +2345,54 @@ void initialize_runtime() {
     });
 
     // get status
-    http_server->Get("/status", [](const Request &req, Response &res) {
+    routes.Get("/status", [](const Request &req, Response &res) {
         std::string result;
-        if (db_)
-            result = "Connected";
-        else
-            result = "Disconnected";
+        switch (get_db_state()) {
+            case DatabaseState::Disconnected:
+                result = "Disconnected";
+                break;
+            case DatabaseState::Loading:
+                result = "Loading";
+                break;
+            case DatabaseState::Ready:
+                result = "Connected";
+                break;
+            case DatabaseState::Error:
+                result = "Error";
+                break;
+        }
         res.status = 200;
         res.set_content(result, "text/plain");
     });
 
+    // get database query statistics
+    routes.Get("/status/db", [](const Request &req, Response &res) {
+        auto db = get_db();
+        if (db) {
+            struct StatEntry {
+                QueryStat stat;
+                [[nodiscard]] json11::Json to_json() const {
+                    return json11::Json::object{
+                        {{"name", stat.name},
+                         {"count", static_cast<double>(stat.count)},
+                         {"total_us", static_cast<double>(stat.total_ns) / 1000},
+                         {"max_us", static_cast<double>(stat.max_ns) / 1000}}};
+                }
+            };
+            auto stats = db->get_query_stats();
+            std::vector<StatEntry> entries;
+            entries.reserve(stats.size());
+            for (auto const &stat : stats) entries.emplace_back(StatEntry{stat});
+            res.status = 200;
+            res.set_content(json11::Json(entries).dump(), "application/json");
+        } else {
+            res.status = 401;
+            res.set_content("[]", "application/json");
+        }
+    });
+
     // get simulation status
-    http_server->Get("/status/simulation", [](const Request &req, Response &res) {
+    routes.Get("/status/simulation", [](const Request &req, Response &res) {
         std::string result;
         if (paused)
             result = "Paused";
@@ -1043,7 +2403,7 @@ void initialize_runtime() {
     });
 
     // get context info based on filename and line number
-    http_server->Get("/context/(.*)", [](const Request &req, Response &res) {
+    routes.Get("/context/(.*)", db_reader([](const Request &req, Response &res) {
         auto const &body = req.body;
         auto const fn_ln = req.matches[1];
         auto tokens = get_tokens(fn_ln, ":");
@@ -1051,13 +2411,84 @@ void initialize_runtime() {
         if (tokens.size() == 2) {
             auto const &filename = tokens[0];
             auto line_num_value = static_cast<uint32_t>(std::stoi(tokens[1]));
+            if (accept_msgpack(req.get_header_value("Accept"))) {
+                // frames are sent as maps instead of nested JSON strings
+                MsgPackWriter writer;
+                write_context_frames(writer, filename, line_num_value);
+                res.status = 200;
+                res.set_content(writer.data(), MSGPACK_CONTENT_TYPE);
+                return;
+            }
             result = get_context_value(filename, line_num_value);
         } else {
             res.status = 401;
             result = "[]";
         }
         res.set_content(result, "application/json");
-    });
+    }));
+
+    // runs several read-only requests, e.g. an IDE refresh after a pause, in one round trip.
+    // requests that change the simulation are held off so all of them see the same state.
+    // the whole batch takes vpi_lock once
+    routes.Post("/batch", db_reader([](const Request &req, Response &res) {
+        // none of these change the simulation
+        static const std::regex batch_routes(
+            R"((GET /(value/.+|values|time|files|connection/(to|from)/.+|status(/db|/simulation)?)"
+            R"(|context/.+|hierarchy/search))|(POST /hierarchy/.+))");
+        std::string err;
+        auto json = json11::Json::parse(req.body, err);
+        if (!err.empty() || !json.is_array()) {
+            set_error(401, "Invalid batch request", res);
+            return;
+        }
+        auto use_msgpack = accept_msgpack(req.get_header_value("Accept"));
+        auto const &commands = json.array_items();
+        json11::Json::array results;
+        MsgPackWriter writer;
+        writer.write_array(static_cast<uint32_t>(commands.size()));
+
+        for (auto const &command : commands) {
+            Request sub_req;
+            Response sub_res;
+            sub_req.method = command["method"].is_string() ? command["method"].string_value()
+                                                            : "GET";
+            UnixSocketServer::parse_target(command["path"].string_value(), sub_req);
+            sub_req.body = command["body"].string_value();
+            if (use_msgpack) sub_req.headers.emplace("Accept", MSGPACK_CONTENT_TYPE);
+            if (std::regex_match(sub_req.method + " " + sub_req.path, batch_routes)) {
+                socket_server->handle(sub_req, sub_res);
+            } else {
+                sub_res.status = 400;
+                sub_res.set_content("Not allowed in a batch", "text/plain");
+            }
+            auto content_type = sub_res.headers.find("Content-Type");
+            std::string type = content_type != sub_res.headers.end() ? content_type->second : "";
+            if (use_msgpack) {
+                writer.write_map(3);
+                writer.write_str("status");
+                writer.write_int(sub_res.status);
+                writer.write_str("content_type");
+                writer.write_str(type);
+                writer.write_str("body");
+                // msgpack results are embedded as they are
+                if (type == MSGPACK_CONTENT_TYPE) {
+                    writer.write_raw(sub_res.body);
+                } else {
+                    writer.write_str(sub_res.body);
+                }
+            } else {
+                results.emplace_back(json11::Json::object{{"status", sub_res.status},
+                                                          {"content_type", type},
+                                                          {"body", sub_res.body}});
+            }
+        }
+        res.status = 200;
+        if (use_msgpack) {
+            res.set_content(writer.data(), MSGPACK_CONTENT_TYPE);
+        } else {
+            res.set_content(json11::Json(results).dump(), "application/json");
+        }
+    }));
 
     // start the http in a different thread
     // get port number from environment variable
@@ -1070,17 +2501,70 @@ void initialize_runtime() {
             std::cerr << "Unable to set port to " << env_port_s;
         }
     }
-    runtime_thread = std::thread([=]() {
-        std::cout << "Kratos runtime server runs at 0.0.0.0:" << runtime_port << std::endl;
-        auto r = http_server->listen("0.0.0.0", runtime_port);
-        if (!r) {
-            std::cerr << "Unable to start server at 0.0.0.0:" << runtime_port << std::endl;
-            return;
+    auto env_interval = std::getenv("KRATOS_MONITOR_INTERVAL");
+    if (env_interval) {
+        try {
+            monitor_interval = std::chrono::milliseconds(std::stoul(env_interval));
+        } catch (const std::invalid_argument &) {
+            std::cerr << "Unable to set monitor interval to " << env_interval << std::endl;
         }
-    });
+    }
+    auto env_mode = std::getenv("KRATOS_MONITOR_MODE");
+    if (env_mode) {
+        auto mode = parse_monitor_mode(env_mode);
+        if (mode) {
+            monitors.set_mode(*mode);
+        } else {
+            std::cerr << "Unable to set monitor mode to " << env_mode << std::endl;
+        }
+    }
+    auto env_record = std::getenv("KRATOS_RECORD");
+    if (env_record) {
+        recorder = std::make_unique<WaveformRecorder>();
+        if (recorder->open(env_record)) {
+            std::cout << "Recording monitored signals to " << env_record << std::endl;
+        } else {
+            std::cerr << "Unable to record to " << env_record << std::endl;
+            recorder = nullptr;
+        }
+    }
+    auto env_journal = std::getenv("KRATOS_JOURNAL");
+    if (env_journal) {
+        journal = std::make_unique<BreakpointJournal>();
+        if (journal->open(env_journal)) {
+            std::cout << "Recording breakpoint hits to " << env_journal << std::endl;
+        } else {
+            std::cerr << "Unable to record breakpoint hits to " << env_journal << std::endl;
+            journal = nullptr;
+        }
+        auto env_frames = std::getenv("KRATOS_JOURNAL_FRAMES");
+        journal_frames = env_frames && std::string(env_frames) != "0";
+    }
+    // the debugger may continue as soon as it connects
+    begin_pause();
+    auto env_socket = std::getenv("KRATOS_SOCKET");
+    if (env_socket) {
+        std::string socket_path = env_socket;
+        if (socket_server->bind(socket_path)) {
+            std::cout << "Kratos runtime server runs at " << socket_path << std::endl;
+            socket_thread = std::thread([]() { socket_server->listen(); });
+        } else {
+            std::cerr << "Unable to start server at " << socket_path << std::endl;
+        }
+    }
+    // TCP is still available when a port is given explicitly
+    if (!env_socket || env_port_s) {
+        runtime_thread = std::thread([=]() {
+            std::cout << "Kratos runtime server runs at 0.0.0.0:" << runtime_port << std::endl;
+            auto r = http_server->listen("0.0.0.0", runtime_port);
+            if (!r) {
+                std::cerr << "Unable to start server at 0.0.0.0:" << runtime_port << std::endl;
+                return;
+            }
+        });
+    }
 
-    // by default it's locked
-    runtime_lock.lock();
+    // wait for the debugger to connect
     pause_sim();
 }
 
@@ -1090,14 +2574,42 @@ PLI_INT32 initialize_server_vpi(s_cb_data *) {
 }
 
 void teardown_runtime() {
+    flush_monitor_values();
+    {
+        std::lock_guard guard(capture_lock);
+        if (capture) capture->close();
+    }
+    if (recorder) recorder->flush();
+    if (journal) {
+        journal->flush();
+        printf("Breakpoint hits recorded: %lu\n", static_cast<unsigned long>(journal->size()));
+        // builds the indexes
+        journal = nullptr;
+    }
     // send stop signal to the debugger
-    if (http_client) {
-        http_client->Post("/stop", "", "text/plain");
+    if (use_event_stream) {
+        event_stream.publish(Event{"/stop", "", "text/plain"});
+    }
+    // wake up the pending polls so that the server can stop
+    event_stream.close();
+    if (event_sender) {
+        event_sender->send(Event{"/stop", "", "text/plain"});
+        // wait for all the pending events to be sent
+        auto stats = event_sender->stats();
+        event_sender = nullptr;
+        if (stats.coalesced || stats.dropped) {
+            printf("Events coalesced: %lu dropped: %lu\n",
+                   static_cast<unsigned long>(stats.coalesced),
+                   static_cast<unsigned long>(stats.dropped));
+        }
     }
     un_pause_sim();
     http_server->stop();
     // this may take some time due to system resource allocation
-    runtime_thread.join();
+    if (runtime_thread.joinable()) runtime_thread.join();
+    socket_server->stop();
+    if (socket_thread.joinable()) socket_thread.join();
+    unload_db();
 }
 
 PLI_INT32 teardown_server_vpi(s_cb_data *) {
@@ -2,9 +2,51 @@
 #define KRATOS_RUNTIME_CONTROL_HH
 
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+class Database;
 
 void initialize_runtime();
 void teardown_runtime();
+// set when a recorded run is replayed instead of simulated. POST /time/<t> calls it to move
+// the replay to the time while it's paused
+void set_time_seek(std::function<void(uint64_t)> seek);
+
+// the simulator thread waits in pause_sim() until un_pause_sim() and runs the tasks that
+// request threads hand to run_on_sim_thread() in the meantime
+void pause_sim();
+void un_pause_sim();
+// announces a pause before the debugger is notified, so that a resume that arrives before
+// pause_sim() waits still ends it. un_pause_sim() outside of a pause is ignored
+void begin_pause();
+// runs on the simulator thread if it's paused, otherwise on the calling thread
+void run_on_sim_thread(const std::function<void()> &fn);
+// requests that only read the simulation share vpi_lock and writes take it exclusively. fn
+// runs through run_on_sim_thread(). a read inside another read or a sim task runs inline
+void read_sim(const std::function<void()> &fn);
+void write_sim(const std::function<void()> &fn);
+// signal values read between begin_pause_values() and un_pause_sim() are memoized.
+// clear_pause_values() drops them after the simulation state is changed, e.g. by a write
+std::optional<std::string> get_pause_value(const std::string &handle_name);
+void begin_pause_values();
+void end_pause_values();
+void clear_pause_values();
+// writes a JSON list of {"handle", "value", "mode"} while the simulation is paused. nothing is
+// written if any entry is invalid
+bool put_values(const std::string &content, std::string &error);
+
+// the debug database is loaded in the background after the debugger connects
+enum class DatabaseState { Disconnected, Loading, Ready, Error };
+void load_db(const std::string &filename);
+// blocks while the database is loading, except on the simulator thread and while holding
+// vpi_lock. returns nullptr unless the database is ready
+std::shared_ptr<Database> wait_db();
+DatabaseState get_db_state();
+// waits for a pending load and drops the database
+void unload_db();
 
 extern "C" {
 // this is the breakpoint insert by kratos for each statement
@@ -1,301 +1,373 @@
 #include "db.hh"
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
 #include "fmt/format.h"
 
-Database::Database(const std::string& filename) {
+Database::Database(const std::string& filename) : filename_(filename) {
     // we assume the file already exists
     storage_ = std::make_unique<Storage>(kratos::init_storage(filename));
     storage_->sync_schema();
+    load_debug_info();
 }
 
-std::vector<uint32_t> Database::get_breakpoint_id(const std::string& filename, uint32_t line_num,
-                                                  uint32_t column) {
-    using namespace sqlite_orm;
-    using namespace kratos;
-    std::vector<uint32_t> result;
-    try {
-        if (column > 0) {
-            auto bps = storage_->get_all<BreakPoint>(where(c(&BreakPoint::filename) == filename and
-                                                           c(&BreakPoint::line_num) == line_num and
-                                                           c(&BreakPoint::column_num) == column));
-            for (auto const& bp : bps) {
-                result.emplace_back(bp.id);
-            }
-        } else {
-            auto bps = storage_->get_all<BreakPoint>(where(c(&BreakPoint::filename) == filename and
-                                                           c(&BreakPoint::line_num) == line_num));
-            for (auto const& bp : bps) {
-                result.emplace_back(bp.id);
-            }
+// the cache is keyed by the SQLite header, which contains the file change counter,
+// together with the file size and modification time. hashing the entire database would
+// take as long as loading it
+uint64_t get_database_key(const std::string& filename) {
+    namespace fs = std::filesystem;
+    constexpr uint64_t fnv_prime = 1099511628211ull;
+    uint64_t key = 14695981039346656037ull;
+    auto update = [&](const char* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            key ^= static_cast<uint8_t>(data[i]);
+            key *= fnv_prime;
         }
-        return result;
-    } catch (...) {
-        return {};
+    };
+    char header[100] = {};
+    std::ifstream stream(filename, std::ios::binary);
+    stream.read(header, sizeof(header));
+    update(header, static_cast<size_t>(stream.gcount()));
+    std::error_code ec;
+    auto size = static_cast<int64_t>(fs::file_size(filename, ec));
+    auto mtime =
+        static_cast<int64_t>(fs::last_write_time(filename, ec).time_since_epoch().count());
+    update(reinterpret_cast<const char*>(&size), sizeof(size));
+    update(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+    return key;
+}
+
+std::string get_cache_filename(uint64_t key) {
+    namespace fs = std::filesystem;
+    fs::path dir;
+    if (auto const* cache_dir = std::getenv("KRATOS_CACHE_DIR")) {
+        dir = cache_dir;
+    } else if (auto const* xdg = std::getenv("XDG_CACHE_HOME")) {
+        dir = fs::path(xdg) / "kratos";
+    } else if (auto const* home = std::getenv("HOME")) {
+        dir = fs::path(home) / ".cache" / "kratos";
+    } else {
+        return "";
     }
+    return (dir / fmt::format("{0:016x}.kdbg", key)).string();
 }
 
-std::vector<Breakpoint> Database::get_breakpoints(const std::string& filename, uint32_t line_num,
-                                                  uint32_t column) {
-    using namespace sqlite_orm;
-    std::vector<Breakpoint> result;
-    try {
-        if (column > 0) {
-            auto bps = storage_->select(
-                columns(&kratos::InstanceSetEntry::instance_id, &kratos::BreakPoint::id),
-                where(is_equal(&kratos::BreakPoint::filename, filename) and
-                      is_equal(&kratos::BreakPoint::line_num, line_num) and
-                      is_equal(&kratos::BreakPoint::column_num, column) and
-                      is_equal(&kratos::InstanceSetEntry::breakpoint_id, &kratos::BreakPoint::id)));
-            for (auto const& [instance_id, breakpoint_id] : bps) {
-                result.emplace_back(Breakpoint{.instance_id = *instance_id,
-                                               .breakpoint_id = static_cast<int>(breakpoint_id),
-                                               .column = static_cast<int>(column)});
-            }
-        } else {
-            auto bps = storage_->select(
-                columns(&kratos::InstanceSetEntry::instance_id, &kratos::BreakPoint::id,
-                        &kratos::BreakPoint::column_num),
-                where(is_equal(&kratos::BreakPoint::filename, filename) and
-                      is_equal(&kratos::BreakPoint::line_num, line_num) and
-                      is_equal(&kratos::InstanceSetEntry::breakpoint_id, &kratos::BreakPoint::id)));
-            for (auto const& [instance_id, breakpoint_id, col] : bps) {
-                result.emplace_back(Breakpoint{.instance_id = *instance_id,
-                                               .breakpoint_id = static_cast<int>(breakpoint_id),
-                                               .column = static_cast<int>(col)});
-            }
-        }
+// every query is served from the debug information, so the lookups are timed per query
+// instead of per statement
+std::vector<QueryStat> Database::get_query_stats() {
+    std::vector<QueryStat> result = {load_stat_};
+    auto stats = lookup_stats_.stats();
+    result.insert(result.end(), stats.begin(), stats.end());
+    return result;
+}
 
-        return result;
-    } catch (...) {
-        return {};
+template <typename T>
+uint32_t to_id(const T& value) {
+    if constexpr (std::is_arithmetic_v<T>) {
+        return static_cast<uint32_t>(value);
+    } else {
+        // foreign keys are nullable
+        return value ? static_cast<uint32_t>(*value) : std::numeric_limits<uint32_t>::max();
     }
 }
 
-uint32_t Database::get_breakpoint_column(uint32_t breakpoint_id) {
-    using namespace sqlite_orm;
-    try {
-        auto cols = storage_->select(columns(&kratos::BreakPoint::column_num),
-                                     where(is_equal(&kratos::BreakPoint::id, breakpoint_id)));
-        if (!cols.empty()) {
-            // use the first one
-            return std::get<0>(cols.front());
-        } else {
-            return 0;
+void Database::load_debug_info() {
+    auto start = std::chrono::steady_clock::now();
+    auto key = get_database_key(filename_);
+    auto cache_filename = get_cache_filename(key);
+    std::string source = "cache";
+    std::optional<DebugInfo> info;
+    if (!cache_filename.empty()) info = DebugInfo::open_cache(cache_filename, key);
+    if (info) {
+        info_ = std::move(*info);
+    } else {
+        source = "database";
+        info_ = read_debug_info(key);
+        if (!cache_filename.empty() && !info_.write_cache(cache_filename)) {
+            std::cerr << "Unable to write debug information cache to " << cache_filename
+                      << std::endl;
         }
-    } catch (...) {
-        return 0;
     }
+    auto end = std::chrono::steady_clock::now();
+    auto ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    load_stat_ = QueryStat{fmt::format("debug_info_{0}", source), 1, ns, ns};
+    printf("Debug information loaded from %s in %.1f ms (%zu breakpoints, %zu frames)\n",
+           source.c_str(), static_cast<double>(ns) / 1e6, info_.num_breakpoints(),
+           info_.num_frames());
 }
 
-std::vector<uint32_t> Database::get_all_breakpoints(const std::string& filename) {
+DebugInfo Database::read_debug_info(uint64_t key) {
     using namespace sqlite_orm;
-    using namespace kratos;
-    std::vector<uint32_t> result;
+    DebugInfoBuilder builder;
     try {
-        auto bps = storage_->get_all<BreakPoint>(where(c(&BreakPoint::filename) == filename));
-        result.reserve(bps.size());
+        auto instances =
+            storage_->select(columns(&kratos::Instance::id, &kratos::Instance::handle_name));
+        for (auto const& [id, handle_name] : instances) {
+            builder.add_instance(to_id(id), handle_name);
+        }
+        auto bps = storage_->get_all<kratos::BreakPoint>();
         for (auto const& bp : bps) {
-            result.emplace_back(bp.id);
+            builder.add_breakpoint(to_id(bp.id), bp.filename, bp.line_num, bp.column_num);
+        }
+        auto instance_set = storage_->select(columns(&kratos::InstanceSetEntry::instance_id,
+                                                     &kratos::InstanceSetEntry::breakpoint_id));
+        for (auto const& [instance_id, breakpoint_id] : instance_set) {
+            builder.add_instance_set(to_id(instance_id), to_id(breakpoint_id));
+        }
+        // SELECT generator_variable.name, variable.value, variable.is_var, variable.handle
+        //     FROM generator_variable, variable WHERE generator_variable.variable_id = variable.id
+        auto gen_vars = storage_->select(
+            columns(&kratos::GeneratorVariable::name, &kratos::Variable::value,
+                    &kratos::Variable::is_var, &kratos::Variable::handle),
+            where(is_equal(&kratos::GeneratorVariable::variable_id, &kratos::Variable::id)));
+        for (auto const& [name, value, is_var, handle] : gen_vars) {
+            builder.add_generator_variable(to_id(handle), name, value, is_var);
+        }
+        // SELECT context.name, variable.value, variable.is_var, variable.handle,
+        //     context.breakpoint_id FROM context, variable WHERE context.variable_id = variable.id
+        auto context_vars = storage_->select(
+            columns(&kratos::ContextVariable::name, &kratos::Variable::value,
+                    &kratos::Variable::is_var, &kratos::Variable::handle,
+                    &kratos::ContextVariable::breakpoint_id),
+            where(is_equal(&kratos::ContextVariable::variable_id, &kratos::Variable::id)));
+        for (auto const& [name, value, is_var, handle, breakpoint_id] : context_vars) {
+            builder.add_context_variable(to_id(handle), to_id(breakpoint_id), name, value, is_var);
+        }
+        auto children = storage_->select(
+            columns(&kratos::Hierarchy::parent_handle, &kratos::Hierarchy::child));
+        for (auto const& [parent_handle, child] : children) {
+            builder.add_child(to_id(parent_handle), child);
+        }
+        auto connections = storage_->select(
+            columns(&kratos::Connection::handle_from, &kratos::Connection::var_from,
+                    &kratos::Connection::handle_to, &kratos::Connection::var_to));
+        for (auto const& [handle_from, var_from, handle_to, var_to] : connections) {
+            builder.add_connection(to_id(handle_from), var_from, to_id(handle_to), var_to);
+        }
+        auto top_names =
+            storage_->get_all<kratos::MetaData>(where(c(&kratos::MetaData::name) == "top_name"));
+        if (!top_names.empty()) builder.set_top_name(top_names[0].value);
+    } catch (const std::exception& ex) {
+        std::cerr << "Unable to load debug information: " << ex.what() << std::endl;
+    }
+    return builder.build(key);
+}
+
+std::vector<uint32_t> Database::get_breakpoint_id(const std::string& filename, uint32_t line_num,
+                                                  uint32_t column) {
+    LookupTimer timer(lookup_stats_, "get_breakpoint_id");
+    std::vector<uint32_t> result;
+    for (auto const id : info_.get_breakpoints(filename, line_num)) {
+        if (column > 0 && info_.get_breakpoint(id)->column_num != column) continue;
+        result.emplace_back(id);
+    }
+    return result;
+}
+
+std::vector<Breakpoint> Database::get_breakpoints(const std::string& filename, uint32_t line_num,
+                                                  uint32_t column) {
+    LookupTimer timer(lookup_stats_, "get_breakpoints");
+    std::vector<Breakpoint> result;
+    for (auto const id : info_.get_breakpoints(filename, line_num)) {
+        auto const* bp = info_.get_breakpoint(id);
+        if (column > 0 && bp->column_num != column) continue;
+        for (auto const& entry : info_.get_instances(id)) {
+            result.emplace_back(Breakpoint{.instance_id = static_cast<int>(entry.instance_id),
+                                           .breakpoint_id = static_cast<int>(id),
+                                           .column = static_cast<int>(bp->column_num)});
         }
-    } catch (...) {
     }
     return result;
 }
 
+uint32_t Database::get_breakpoint_column(uint32_t breakpoint_id) {
+    LookupTimer timer(lookup_stats_, "get_breakpoint_column");
+    auto const* bp = info_.get_breakpoint(breakpoint_id);
+    return bp ? bp->column_num : 0;
+}
+
+std::vector<uint32_t> Database::get_all_breakpoints(const std::string& filename) {
+    LookupTimer timer(lookup_stats_, "get_all_breakpoints");
+    return info_.get_file_breakpoints(filename);
+}
+
 std::vector<std::string> Database::get_all_files() {
-    using namespace sqlite_orm;
-    // select distinct
-    auto names = storage_->select(distinct(&kratos::BreakPoint::filename));
+    LookupTimer timer(lookup_stats_, "get_all_files");
+    auto files = info_.get_files();
     std::vector<std::string> result;
-    result.reserve(names.size());
-    for (auto const& name : names) {
-        result.emplace_back(name);
+    result.reserve(files.size);
+    for (auto const& file : files) {
+        result.emplace_back(info_.str(file.filename));
     }
-    return names;
+    return result;
 }
 
 std::vector<Variable> Database::get_variable_mapping(uint32_t instance_id, uint32_t breakpoint_id) {
-    using namespace sqlite_orm;
-    try {
-        std::vector<Variable> result;
-        // SELECT generator_variable.name, variable.value, variable.is_var, instance.handle_name
-        //     FROM variable, instance, breakpoint, generator_variable.name WHERE
-        //     breakpoint.id = breakpoint_id AND breakpoint.handle = instance.id AND
-        //     variable.handle = instance.id AND
-        //     generator_variable.variable_id = variable.id
-        auto values = storage_->select(
-            columns(&kratos::GeneratorVariable::name, &kratos::Variable::value,
-                    &kratos::Variable::is_var, &kratos::Instance::handle_name,
-                    &kratos::BreakPoint::id),
-            where(is_equal(&kratos::BreakPoint::id, breakpoint_id) and
-                  is_equal(instance_id, &kratos::Variable::handle) and
-                  is_equal(&kratos::Instance::id, instance_id) and
-                  is_equal(&kratos::GeneratorVariable::variable_id, &kratos::Variable::id)));
-        for (auto const& v : values) {
-            auto const& [name, value, is_var, handle_name, a] = v;
-            (void)(a);
-            Variable var{name, value, handle_name, false, is_var};
-            result.emplace_back(var);
-        }
-
-        return result;
-    } catch (...) {
-        return {};
+    LookupTimer timer(lookup_stats_, "get_variable_mapping");
+    auto handle_name = info_.get_instance_name(instance_id);
+    if (handle_name.empty()) return {};
+    Span<VariableEntry> variables;
+    auto const* frame = info_.get_frame(instance_id, breakpoint_id);
+    if (frame) {
+        variables = info_.get_generator_variables(*frame);
+    } else if (info_.get_breakpoint(breakpoint_id)) {
+        variables = info_.get_generator_variables(instance_id);
     }
+    std::vector<Variable> result;
+    result.reserve(variables.size);
+    for (auto const& v : variables) {
+        result.emplace_back(Variable{std::string(info_.str(v.name)),
+                                     std::string(info_.str(v.value)), std::string(handle_name),
+                                     false, v.is_var != 0});
+    }
+    return result;
 }
 
 std::optional<std::pair<std::string, uint32_t>> Database::get_breakpoint_info(uint32_t id) {
-    using namespace sqlite_orm;
-    try {
-        auto bps = storage_->get_all<kratos::BreakPoint>(where(c(&kratos::BreakPoint::id) == id));
-        if (!bps.empty()) {
-            auto const& bp = bps[0];
-            return std::make_pair(bp.filename, bp.line_num);
+    LookupTimer timer(lookup_stats_, "get_breakpoint_info");
+    auto const* bp = info_.get_breakpoint(id);
+    if (bp) return std::make_pair(std::string(info_.str(bp->filename)), bp->line_num);
+    return std::nullopt;
+}
+
+std::vector<std::pair<std::string, uint32_t>> Database::get_signal_sources(
+    const std::string& handle_name, uint32_t limit) {
+    LookupTimer timer(lookup_stats_, "get_signal_sources");
+    std::vector<std::pair<std::string, uint32_t>> result;
+    auto pos = handle_name.rfind('.');
+    if (pos == std::string::npos) return result;
+    auto instance_id = info_.get_instance_id(handle_name.substr(0, pos));
+    if (!instance_id) return result;
+    auto name = std::string_view(handle_name).substr(pos + 1);
+    auto shows_signal = [&](Span<VariableEntry> variables) {
+        for (auto const& v : variables) {
+            if (info_.str(v.value) == name) return true;
         }
-    } catch (...) {
+        return false;
+    };
+    for (auto const& frame : info_.get_frames(*instance_id)) {
+        if (result.size() >= limit) break;
+        if (!shows_signal(info_.get_context_variables(frame)) &&
+            !shows_signal(info_.get_generator_variables(frame)))
+            continue;
+        auto const* bp = info_.get_breakpoint(frame.breakpoint_id);
+        if (!bp) continue;
+        auto source = std::make_pair(std::string(info_.str(bp->filename)), bp->line_num);
+        if (std::find(result.begin(), result.end(), source) == result.end())
+            result.emplace_back(source);
     }
-    return std::nullopt;
+    return result;
 }
 
 std::vector<Variable> Database::get_context_variable(uint32_t instance_id, uint32_t id) {
-    using namespace sqlite_orm;
-    try {
-        std::vector<Variable> result;
-        auto values = storage_->select(
-            columns(&kratos::ContextVariable::name, &kratos::Variable::value,
-                    &kratos::Variable::is_var, &kratos::Instance::handle_name),
-            where(c(&kratos::ContextVariable::breakpoint_id) == id and
-                  c(&kratos::ContextVariable::variable_id) == &kratos::Variable::id and
-                  c(&kratos::Instance::id) == &kratos::Variable::handle and
-                  c(&kratos::Instance::id) == instance_id));
-        for (auto const& v : values) {
-            auto const& [name, value, is_var, handle_name] = v;
-            Variable var{name, value, handle_name, true, is_var};
-            result.emplace_back(var);
-        }
-        return result;
-    } catch (...) {
-        return {};
+    LookupTimer timer(lookup_stats_, "get_context_variable");
+    auto handle_name = info_.get_instance_name(instance_id);
+    auto const* frame = info_.get_frame(instance_id, id);
+    if (handle_name.empty() || !frame) return {};
+    auto variables = info_.get_context_variables(*frame);
+    std::vector<Variable> result;
+    result.reserve(variables.size);
+    for (auto const& v : variables) {
+        result.emplace_back(Variable{std::string(info_.str(v.name)),
+                                     std::string(info_.str(v.value)), std::string(handle_name),
+                                     true, v.is_var != 0});
     }
+    return result;
 }
 
-std::vector<Hierarchy> Database::get_hierarchy(std::string handle_name) {
-    using namespace sqlite_orm;
+std::vector<Hierarchy> Database::get_hierarchy(std::string handle_name, uint32_t offset,
+                                               uint32_t limit) {
+    LookupTimer timer(lookup_stats_, "get_hierarchy");
     if (handle_name.empty()) {
-        // query the handle name
-        try {
-            auto results = storage_->get_all<kratos::MetaData>(
-                where(c(&kratos::MetaData::name) == "top_name"));
-            if (!results.empty()) {
-                auto const result = results[0];
-                handle_name = result.value;
-            } else {
-                return {};
-            }
+        handle_name = info_.get_top_name();
+        if (handle_name.empty()) return {};
+    }
+    auto id = info_.find_instance(handle_name);
+    if (!id) return {};
+    auto children = info_.get_children(*id);
+    if (offset >= children.size) return {};
+    auto end = std::min<size_t>(children.size, static_cast<size_t>(offset) + limit);
+    std::vector<Hierarchy> result;
+    result.reserve(end - offset);
+    for (auto i = offset; i < end; i++) {
+        auto const& child = children[i];
+        auto size = child.child_id == NO_INSTANCE ? 0 : info_.get_subtree_size(child.child_id);
+        result.emplace_back(Hierarchy{handle_name, std::string(info_.str(child.name)), size});
+    }
+    return result;
+}
 
-        } catch (...) {
-            return {};
-        }
+uint32_t Database::get_num_children(std::string handle_name) {
+    LookupTimer timer(lookup_stats_, "get_num_children");
+    if (handle_name.empty()) handle_name = info_.get_top_name();
+    auto id = info_.find_instance(handle_name);
+    return id ? static_cast<uint32_t>(info_.get_children(*id).size) : 0;
+}
+
+std::vector<std::string> Database::search_hierarchy(const std::string& pattern, uint32_t limit) {
+    LookupTimer timer(lookup_stats_, "search_hierarchy");
+    auto ids = info_.search_instances(pattern, limit);
+    std::vector<std::string> result;
+    result.reserve(ids.size());
+    for (auto const id : ids) {
+        result.emplace_back(info_.get_instance_name(id));
     }
-    // query the hierarchy
-    try {
-        std::vector<Hierarchy> result;
-        auto values =
-            storage_->select(columns(&kratos::Instance::handle_name, &kratos::Hierarchy::child),
-                             where(c(&kratos::Instance::handle_name) == handle_name and
-                                   c(&kratos::Hierarchy::parent_handle) == &kratos::Instance::id));
-        for (auto const& [name, child] : values) {
-            Hierarchy h{name, child};
-            result.emplace_back(h);
-        }
-        return result;
-    } catch (...) {
-        return {};
+    return result;
+}
+
+std::vector<Connection> Database::get_connection(const std::string& handle_name, bool is_from) {
+    auto id = info_.find_instance(handle_name);
+    if (!id) return {};
+    std::vector<Connection> result;
+    auto add_connection = [&](const ConnectionEntry& entry) {
+        auto from = info_.get_instance_name(entry.handle_from);
+        auto to = info_.get_instance_name(entry.handle_to);
+        // same as the inner join in SQL
+        if (from.empty() || to.empty()) return;
+        result.emplace_back(Connection{std::string(from), std::string(info_.str(entry.var_from)),
+                                       std::string(to), std::string(info_.str(entry.var_to))});
+    };
+    if (is_from) {
+        for (auto const& entry : info_.get_connections_from(*id)) add_connection(entry);
+    } else {
+        for (auto const* entry : info_.get_connections_to(*id)) add_connection(*entry);
     }
+    return result;
 }
 
-std::vector<Connection> Database::get_connection_to(const std::string& handle_name) {
-    using namespace sqlite_orm;
-    try {
-        // a is from
-        using als_a = alias_a<kratos::Instance>;
-        using als_b = alias_b<kratos::Instance>;
-        // SELECT a.handle_name, c.var_from, b.handle_name, c.var_to FROM
-        //     instance a, instance b, connection c WHERE
-        //     b.id = c.handle_to AND b.handle_name = handle_name AND a.id = c.handle_from
-        auto values = storage_->select(
-            columns(
-                alias_column<als_a>(&kratos::Instance::handle_name), &kratos::Connection::var_from,
-                alias_column<als_b>(&kratos::Instance::handle_name), &kratos::Connection::var_to),
-            where(is_equal(alias_column<als_b>(&kratos::Instance::id),
-                           &kratos::Connection::handle_to) and
-                  is_equal(alias_column<als_b>(&kratos::Instance::handle_name), handle_name) and
-                  is_equal(alias_column<als_a>(&kratos::Instance::id),
-                           &kratos::Connection::handle_from)));
-        std::vector<Connection> result;
-        for (auto const& [handle_from, var_from, handle_to, var_to] : values) {
-            Connection conn{handle_from, var_from, handle_to, var_to};
-            result.emplace_back(conn);
-        }
-        return result;
-    } catch (...) {
-        return {};
+std::shared_ptr<const std::vector<Net>> Database::get_nets(const std::string& scope) {
+    LookupTimer timer(lookup_stats_, "get_nets");
+    std::lock_guard guard(nets_lock_);
+    if (nets_.find(scope) == nets_.end()) {
+        nets_.emplace(scope, std::make_shared<const std::vector<Net>>(info_.compute_nets(scope)));
     }
+    return nets_.at(scope);
+}
+
+std::vector<Connection> Database::get_connection_to(const std::string& handle_name) {
+    LookupTimer timer(lookup_stats_, "get_connection_to");
+    return get_connection(handle_name, false);
 }
 
 std::vector<Connection> Database::get_connection_from(const std::string& handle_name) {
-    using namespace sqlite_orm;
-    try {
-        // a is from
-        using als_a = alias_a<kratos::Instance>;
-        using als_b = alias_b<kratos::Instance>;
-        // SELECT a.handle_name, c.var_from, b.handle_name, c.var_to FROM
-        //     instance a, instance b, connection c WHERE
-        //     a.id = c.handle_from AND a.handle_name = handle_name AND b.id = c.handle_to
-        auto values = storage_->select(
-            columns(
-                alias_column<als_a>(&kratos::Instance::handle_name), &kratos::Connection::var_from,
-                alias_column<als_b>(&kratos::Instance::handle_name), &kratos::Connection::var_to),
-            where(is_equal(alias_column<als_a>(&kratos::Instance::id),
-                           &kratos::Connection::handle_from) and
-                  is_equal(alias_column<als_a>(&kratos::Instance::handle_name), handle_name) and
-                  is_equal(alias_column<als_b>(&kratos::Instance::id),
-                           &kratos::Connection::handle_to)));
-        std::vector<Connection> result;
-        for (auto const& [handle_from, var_from, handle_to, var_to] : values) {
-            Connection conn{handle_from, var_from, handle_to, var_to};
-            result.emplace_back(conn);
-        }
-        return result;
-    } catch (...) {
-        return {};
-    }
+    LookupTimer timer(lookup_stats_, "get_connection_from");
+    return get_connection(handle_name, true);
 }
 
 std::optional<uint32_t> Database::get_instance_id(uint32_t breakpoint_id) {
-    using namespace sqlite_orm;
-    try {
-        auto values = storage_->get_all<kratos::InstanceSetEntry>(
-            where(is_equal(&kratos::InstanceSetEntry::breakpoint_id, breakpoint_id)));
-        for (auto const& v : values) {
-            return *v.instance_id;
-        }
-    } catch (...) {
-        return std::nullopt;
-    }
+    LookupTimer timer(lookup_stats_, "get_instance_id");
+    auto instances = info_.get_instances(breakpoint_id);
+    if (!instances.empty()) return instances[0].instance_id;
     return std::nullopt;
 }
 
 std::string Database::get_instance_name(uint32_t instance_id) {
-    using namespace sqlite_orm;
-    try {
-        auto instances = storage_->get_all<kratos::Instance>(
-            where(is_equal(&kratos::Instance::id, instance_id)));
-        if (!instances.empty())
-            return instances[0].handle_name;
-        else
-            return "";
-    } catch (...) {
-        return "";
-    }
-}
\ No newline at end of file
+    LookupTimer timer(lookup_stats_, "get_instance_name");
+    return std::string(info_.get_instance_name(instance_id));
+}
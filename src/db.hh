@@ -2,7 +2,12 @@
 #define KRATOS_RUNTIME_DB_HH
 
 #include <any>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "debug_info.hh"
+#include "query.hh"
 #include "kratos/src/db.hh"
 #include "sqlite_orm/sqlite_orm.h"
 
@@ -18,6 +23,8 @@ struct Variable {
 struct Hierarchy {
     std::string parent_handle;
     std::string child;
+    // number of instances under the child, including itself
+    uint32_t size = 0;
 };
 
 struct Connection {
@@ -44,17 +51,43 @@ public:
     std::vector<uint32_t> get_all_breakpoints(const std::string &filename);
     std::vector<std::string> get_all_files();
     std::optional<std::pair<std::string, uint32_t>> get_breakpoint_info(uint32_t id);
+    // source lines whose frames show the signal
+    std::vector<std::pair<std::string, uint32_t>> get_signal_sources(const std::string &handle_name,
+                                                                     uint32_t limit);
     std::vector<Variable> get_context_variable(uint32_t instance_id, uint32_t id);
-    std::vector<Hierarchy> get_hierarchy(std::string handle_name);
+    // empty handle name is the top. children are sorted by name
+    std::vector<Hierarchy> get_hierarchy(std::string handle_name, uint32_t offset = 0,
+                                         uint32_t limit = std::numeric_limits<uint32_t>::max());
+    uint32_t get_num_children(std::string handle_name);
+    std::vector<std::string> search_hierarchy(const std::string &pattern, uint32_t limit);
     std::vector<Connection> get_connection_to(const std::string &handle_name);
     std::vector<Connection> get_connection_from(const std::string &handle_name);
+    // nets formed by the connections of every child module in the scope
+    std::shared_ptr<const std::vector<Net>> get_nets(const std::string &scope);
     std::optional<uint32_t> get_instance_id(uint32_t breakpoint_id);
     std::string get_instance_name(uint32_t instance_id);
 
+    [[nodiscard]] const DebugInfo &debug_info() const { return info_; }
+    std::vector<QueryStat> get_query_stats();
+
 private:
+    void load_debug_info();
+    DebugInfo read_debug_info(uint64_t key);
+    std::vector<Connection> get_connection(const std::string &handle_name, bool is_from);
+
+    std::string filename_;
+
     // see https://github.com/fnc12/sqlite_orm/wiki/FAQ
     using Storage = decltype(kratos::init_storage(""));
     std::unique_ptr<Storage> storage_;
+    // the debug tables are loaded into memory once since the database is immutable during
+    // the simulation. the compiled form is cached on disk and mmap-ed by later runs
+    DebugInfo info_;
+    QueryStat load_stat_;
+    LookupStats lookup_stats_;
+    // scope -> nets
+    std::mutex nets_lock_;
+    std::unordered_map<std::string, std::shared_ptr<const std::vector<Net>>> nets_;
 };
 
 #endif  // KRATOS_RUNTIME_DB_HH
@@ -0,0 +1,810 @@
+#include "debug_info.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <tuple>
+
+#include "fmt/format.h"
+
+constexpr char CACHE_MAGIC[8] = {'K', 'R', 'A', 'T', 'O', 'S', 'D', 'I'};
+constexpr uint32_t CACHE_VERSION = 2;
+
+enum Section : uint32_t {
+    STRINGS,
+    INSTANCES,
+    INSTANCE_NAMES,
+    BREAKPOINTS,
+    LINES,
+    LINE_BREAKPOINTS,
+    LINE_TABLE,
+    FILES,
+    INSTANCE_SET,
+    GENERATOR_VARIABLES,
+    GENERATOR_GROUPS,
+    CONTEXT_VARIABLES,
+    FRAMES,
+    CHILDREN,
+    SUBTREE_SIZES,
+    CONNECTIONS,
+    CONNECTIONS_TO,
+    METADATA,
+    NUM_SECTIONS
+};
+
+// metadata section layout
+enum Metadata : uint32_t { KEY, HAS_TOP_NAME, TOP_NAME_OFFSET, TOP_NAME_SIZE, NUM_METADATA };
+
+struct SectionEntry {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_sections;
+    uint64_t size;
+    SectionEntry sections[NUM_SECTIONS];
+};
+
+template <typename T>
+auto lower_bound_id(Span<T> values, uint32_t id) {
+    return std::lower_bound(values.begin(), values.end(), id,
+                            [](const T &entry, uint32_t value) { return entry.id < value; });
+}
+
+const BreakpointEntry *DebugInfo::get_breakpoint(uint32_t id) const {
+    auto it = lower_bound_id(breakpoints_, id);
+    if (it != breakpoints_.end() && it->id == id) return it;
+    return nullptr;
+}
+
+Span<uint32_t> DebugInfo::get_breakpoints(std::string_view filename, uint32_t line_num) const {
+    if (line_table_.empty()) return {};
+    auto mask = line_table_.size - 1;
+    auto slot = hash(filename, line_num) & mask;
+    while (line_table_[slot]) {
+        auto const &line = lines_[line_table_[slot] - 1];
+        if (line.line_num == line_num && str(line.filename) == filename) {
+            return Span<uint32_t>{line_breakpoints_.data + line.begin, line.end - line.begin};
+        }
+        slot = (slot + 1) & mask;
+    }
+    return {};
+}
+
+std::vector<uint32_t> DebugInfo::get_file_breakpoints(std::string_view filename) const {
+    std::vector<uint32_t> result;
+    auto it = std::lower_bound(files_.begin(), files_.end(), filename,
+                               [this](const FileEntry &entry, std::string_view value) {
+                                   return str(entry.filename) < value;
+                               });
+    if (it == files_.end() || str(it->filename) != filename) return result;
+    for (auto i = it->begin; i < it->end; i++) {
+        auto const &line = lines_[i];
+        result.insert(result.end(), line_breakpoints_.begin() + line.begin,
+                      line_breakpoints_.begin() + line.end);
+    }
+    return result;
+}
+
+Span<InstanceSetEntry> DebugInfo::get_instances(uint32_t breakpoint_id) const {
+    auto [lo, hi] = std::equal_range(
+        instance_set_.begin(), instance_set_.end(), InstanceSetEntry{breakpoint_id, 0},
+        [](const InstanceSetEntry &a, const InstanceSetEntry &b) {
+            return a.breakpoint_id < b.breakpoint_id;
+        });
+    return Span<InstanceSetEntry>{lo, static_cast<size_t>(hi - lo)};
+}
+
+std::string_view DebugInfo::get_instance_name(uint32_t instance_id) const {
+    auto it = lower_bound_id(instances_, instance_id);
+    if (it != instances_.end() && it->id == instance_id) return str(it->handle_name);
+    return {};
+}
+
+std::optional<uint32_t> DebugInfo::get_instance_id(std::string_view handle_name) const {
+    auto it = std::lower_bound(instance_names_.begin(), instance_names_.end(), handle_name,
+                               [this](uint32_t index, std::string_view value) {
+                                   return str(instances_[index].handle_name) < value;
+                               });
+    if (it != instance_names_.end() && str(instances_[*it].handle_name) == handle_name)
+        return instances_[*it].id;
+    return std::nullopt;
+}
+
+const FrameEntry *DebugInfo::get_frame(uint32_t instance_id, uint32_t breakpoint_id) const {
+    auto it = std::lower_bound(frames_.begin(), frames_.end(),
+                               std::make_pair(instance_id, breakpoint_id),
+                               [](const FrameEntry &entry, const std::pair<uint32_t, uint32_t> &v) {
+                                   return std::make_pair(entry.instance_id, entry.breakpoint_id) <
+                                          v;
+                               });
+    if (it != frames_.end() && it->instance_id == instance_id &&
+        it->breakpoint_id == breakpoint_id)
+        return it;
+    return nullptr;
+}
+
+Span<FrameEntry> DebugInfo::get_frames(uint32_t instance_id) const {
+    auto begin = std::lower_bound(frames_.begin(), frames_.end(), instance_id,
+                                  [](const FrameEntry &entry, uint32_t value) {
+                                      return entry.instance_id < value;
+                                  });
+    auto end = std::upper_bound(begin, frames_.end(), instance_id,
+                                [](uint32_t value, const FrameEntry &entry) {
+                                    return value < entry.instance_id;
+                                });
+    return Span<FrameEntry>{begin, static_cast<size_t>(end - begin)};
+}
+
+Span<VariableEntry> DebugInfo::get_generator_variables(uint32_t instance_id) const {
+    auto it = std::lower_bound(generator_groups_.begin(), generator_groups_.end(), instance_id,
+                               [](const VariableGroup &entry, uint32_t value) {
+                                   return entry.instance_id < value;
+                               });
+    if (it != generator_groups_.end() && it->instance_id == instance_id)
+        return Span<VariableEntry>{generator_variables_.data + it->begin, it->end - it->begin};
+    return {};
+}
+
+Span<VariableEntry> DebugInfo::get_generator_variables(const FrameEntry &frame) const {
+    return Span<VariableEntry>{generator_variables_.data + frame.gen_begin,
+                               frame.gen_end - frame.gen_begin};
+}
+
+Span<VariableEntry> DebugInfo::get_context_variables(const FrameEntry &frame) const {
+    return Span<VariableEntry>{context_variables_.data + frame.context_begin,
+                               frame.context_end - frame.context_begin};
+}
+
+Span<ChildEntry> DebugInfo::get_children(uint32_t instance_id) const {
+    auto [lo, hi] = std::equal_range(
+        children_.begin(), children_.end(), ChildEntry{instance_id, {0, 0}, NO_INSTANCE},
+        [](const ChildEntry &a, const ChildEntry &b) { return a.parent_id < b.parent_id; });
+    return Span<ChildEntry>{lo, static_cast<size_t>(hi - lo)};
+}
+
+uint32_t DebugInfo::get_subtree_size(uint32_t instance_id) const {
+    auto it = lower_bound_id(instances_, instance_id);
+    if (it == instances_.end() || it->id != instance_id) return 0;
+    return subtree_sizes_[it - instances_.begin()];
+}
+
+std::optional<uint32_t> DebugInfo::find_instance(std::string_view path) const {
+    // the first component is the root instance
+    auto pos = path.find('.');
+    auto id = get_instance_id(path.substr(0, pos));
+    while (id && pos != std::string_view::npos) {
+        auto next = path.find('.', pos + 1);
+        auto name = path.substr(pos + 1, next == std::string_view::npos ? next : next - pos - 1);
+        auto children = get_children(*id);
+        auto it = std::lower_bound(children.begin(), children.end(), name,
+                                   [this](const ChildEntry &entry, std::string_view value) {
+                                       return str(entry.name) < value;
+                                   });
+        if (it == children.end() || str(it->name) != name || it->child_id == NO_INSTANCE) {
+            id = std::nullopt;
+        } else {
+            id = it->child_id;
+        }
+        pos = next;
+    }
+    // instance names may contain dots, e.g. unrolled arrays
+    if (!id) return get_instance_id(path);
+    return id;
+}
+
+std::vector<uint32_t> DebugInfo::search_instances(std::string_view pattern, size_t limit) const {
+    auto prefix = pattern.substr(0, pattern.find_first_of("*?"));
+    bool is_prefix = prefix.size() == pattern.size();
+    auto it = std::lower_bound(instance_names_.begin(), instance_names_.end(), prefix,
+                               [this](uint32_t index, std::string_view value) {
+                                   return str(instances_[index].handle_name) < value;
+                               });
+    std::vector<uint32_t> result;
+    for (; it != instance_names_.end() && result.size() < limit; it++) {
+        auto name = str(instances_[*it].handle_name);
+        if (name.substr(0, prefix.size()) != prefix) break;
+        if (is_prefix || glob_match(pattern, name)) result.emplace_back(instances_[*it].id);
+    }
+    return result;
+}
+
+Span<ConnectionEntry> DebugInfo::get_connections_from(uint32_t instance_id) const {
+    auto [lo, hi] = std::equal_range(
+        connections_.begin(), connections_.end(), ConnectionEntry{instance_id, {0, 0}, 0, {0, 0}},
+        [](const ConnectionEntry &a, const ConnectionEntry &b) {
+            return a.handle_from < b.handle_from;
+        });
+    return Span<ConnectionEntry>{lo, static_cast<size_t>(hi - lo)};
+}
+
+std::vector<const ConnectionEntry *> DebugInfo::get_connections_to(uint32_t instance_id) const {
+    auto lo = std::partition_point(
+        connections_to_.begin(), connections_to_.end(),
+        [&](uint32_t index) { return connections_[index].handle_to < instance_id; });
+    auto hi = std::partition_point(lo, connections_to_.end(), [&](uint32_t index) {
+        return connections_[index].handle_to <= instance_id;
+    });
+    std::vector<const ConnectionEntry *> result;
+    result.reserve(hi - lo);
+    for (auto it = lo; it != hi; it++) result.emplace_back(&connections_[*it]);
+    return result;
+}
+
+std::string_view DebugInfo::get_top_name() const {
+    if (metadata_.size != NUM_METADATA || !metadata_[HAS_TOP_NAME]) return {};
+    return str(StrRef{static_cast<uint32_t>(metadata_[TOP_NAME_OFFSET]),
+                      static_cast<uint32_t>(metadata_[TOP_NAME_SIZE])});
+}
+
+std::vector<Net> DebugInfo::compute_nets(std::string_view scope) const {
+    auto scope_name = scope.empty() ? get_top_name() : scope;
+    auto scope_id = find_instance(scope_name);
+    if (!scope_id) return {};
+    // every endpoint is identified by its instance id and the interned variable name
+    std::unordered_map<uint64_t, uint32_t> endpoint_ids;
+    std::vector<std::pair<uint32_t, StrRef>> endpoints;
+    std::vector<uint32_t> parents;
+    auto get_endpoint = [&](uint32_t instance_id, const StrRef &var) {
+        auto key = (static_cast<uint64_t>(instance_id) << 32u) | var.offset;
+        if (endpoint_ids.find(key) == endpoint_ids.end()) {
+            auto id = static_cast<uint32_t>(endpoints.size());
+            endpoint_ids.emplace(key, id);
+            endpoints.emplace_back(instance_id, var);
+            parents.emplace_back(id);
+        }
+        return endpoint_ids.at(key);
+    };
+    auto find = [&](uint32_t id) {
+        while (parents[id] != id) {
+            parents[id] = parents[parents[id]];
+            id = parents[id];
+        }
+        return id;
+    };
+    // the first driver we see is the one that gets read
+    std::vector<uint32_t> drivers;
+    auto add_connection = [&](const ConnectionEntry &entry) {
+        if (get_instance_name(entry.handle_from).empty() ||
+            get_instance_name(entry.handle_to).empty())
+            return;
+        auto from = get_endpoint(entry.handle_from, entry.var_from);
+        auto to = get_endpoint(entry.handle_to, entry.var_to);
+        drivers.emplace_back(from);
+        auto root_from = find(from);
+        auto root_to = find(to);
+        if (root_from != root_to) parents[root_to] = root_from;
+    };
+    for (auto const &child : get_children(*scope_id)) {
+        if (child.child_id == NO_INSTANCE) continue;
+        for (auto const &entry : get_connections_from(child.child_id)) add_connection(entry);
+        for (auto const *entry : get_connections_to(child.child_id)) add_connection(*entry);
+    }
+
+    std::vector<Net> nets;
+    std::unordered_map<uint32_t, uint32_t> net_ids;
+    for (auto const driver : drivers) {
+        auto root = find(driver);
+        if (net_ids.find(root) != net_ids.end()) continue;
+        net_ids.emplace(root, static_cast<uint32_t>(nets.size()));
+        auto const &[instance_id, var] = endpoints[driver];
+        nets.emplace_back(Net{fmt::format("{0}.{1}", get_instance_name(instance_id),
+                                          str(var)),
+                              {}});
+    }
+    for (uint32_t id = 0; id < endpoints.size(); id++) {
+        auto const &[instance_id, var] = endpoints[id];
+        nets[net_ids.at(find(id))].handles.emplace_back(
+            fmt::format("{0}.{1}", get_instance_name(instance_id), str(var)));
+    }
+    return nets;
+}
+
+uint64_t DebugInfo::key() const { return metadata_.size == NUM_METADATA ? metadata_[KEY] : 0; }
+
+bool DebugInfo::glob_match(std::string_view pattern, std::string_view value) {
+    // greedy matching with backtracking to the last star
+    size_t p = 0, v = 0;
+    auto star = std::string_view::npos;
+    size_t star_v = 0;
+    while (v < value.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == value[v])) {
+            p++;
+            v++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            star_v = v;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            v = ++star_v;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+uint64_t DebugInfo::hash(std::string_view filename, uint32_t line_num) {
+    // FNV-1a
+    uint64_t value = 14695981039346656037ull;
+    for (auto const c : filename) {
+        value ^= static_cast<uint8_t>(c);
+        value *= 1099511628211ull;
+    }
+    value ^= line_num;
+    value *= 1099511628211ull;
+    return value ^ (value >> 32u);
+}
+
+template <typename T>
+bool map_section(const char *base, size_t size, const SectionEntry &section, Span<T> &span) {
+    if (section.offset % alignof(T) != 0 || section.size % sizeof(T) != 0 ||
+        section.offset > size || section.size > size - section.offset)
+        return false;
+    span = Span<T>{reinterpret_cast<const T *>(base + section.offset), section.size / sizeof(T)};
+    return true;
+}
+
+bool DebugInfo::valid() const {
+    auto valid_str = [this](const StrRef &ref) {
+        return static_cast<uint64_t>(ref.offset) + ref.size <= strings_.size;
+    };
+    auto valid_range = [](uint32_t begin, uint32_t end, size_t size) {
+        return begin <= end && end <= size;
+    };
+    // line table has to be a power of 2
+    if (metadata_.size != NUM_METADATA || subtree_sizes_.size != instances_.size ||
+        (line_table_.size & (line_table_.size - 1)) != 0)
+        return false;
+    if (metadata_[HAS_TOP_NAME]) {
+        auto offset = metadata_[TOP_NAME_OFFSET];
+        if (offset > strings_.size || metadata_[TOP_NAME_SIZE] > strings_.size - offset)
+            return false;
+    }
+    for (auto const &entry : instances_) {
+        if (!valid_str(entry.handle_name)) return false;
+    }
+    for (auto const index : instance_names_) {
+        if (index >= instances_.size) return false;
+    }
+    for (auto const &entry : breakpoints_) {
+        if (!valid_str(entry.filename)) return false;
+    }
+    for (auto const &entry : lines_) {
+        if (!valid_str(entry.filename) ||
+            !valid_range(entry.begin, entry.end, line_breakpoints_.size))
+            return false;
+    }
+    // the probe stops at the first empty slot, so at least one has to be empty
+    size_t used_slots = 0;
+    for (auto const slot : line_table_) {
+        if (slot > lines_.size) return false;
+        if (slot) used_slots++;
+    }
+    if (!line_table_.empty() && used_slots == line_table_.size) return false;
+    for (auto const &entry : files_) {
+        if (!valid_str(entry.filename) || !valid_range(entry.begin, entry.end, lines_.size))
+            return false;
+    }
+    for (auto const *variables : {&generator_variables_, &context_variables_}) {
+        for (auto const &entry : *variables) {
+            if (!valid_str(entry.name) || !valid_str(entry.value)) return false;
+        }
+    }
+    for (auto const &entry : generator_groups_) {
+        if (!valid_range(entry.begin, entry.end, generator_variables_.size)) return false;
+    }
+    for (auto const &entry : frames_) {
+        if (!valid_range(entry.gen_begin, entry.gen_end, generator_variables_.size) ||
+            !valid_range(entry.context_begin, entry.context_end, context_variables_.size))
+            return false;
+    }
+    for (auto const &entry : children_) {
+        if (!valid_str(entry.name)) return false;
+    }
+    for (auto const &entry : connections_) {
+        if (!valid_str(entry.var_from) || !valid_str(entry.var_to)) return false;
+    }
+    for (auto const index : connections_to_) {
+        if (index >= connections_.size) return false;
+    }
+    return true;
+}
+
+std::optional<DebugInfo> DebugInfo::from_buffer(std::shared_ptr<const char> owner, size_t size) {
+    if (size < sizeof(CacheHeader)) return std::nullopt;
+    auto const *base = owner.get();
+    auto const *header = reinterpret_cast<const CacheHeader *>(base);
+    if (std::memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header->version != CACHE_VERSION || header->num_sections != NUM_SECTIONS ||
+        header->size != size)
+        return std::nullopt;
+    DebugInfo info;
+    auto const &sections = header->sections;
+    bool valid = map_section(base, size, sections[STRINGS], info.strings_) &&
+                 map_section(base, size, sections[INSTANCES], info.instances_) &&
+                 map_section(base, size, sections[INSTANCE_NAMES], info.instance_names_) &&
+                 map_section(base, size, sections[BREAKPOINTS], info.breakpoints_) &&
+                 map_section(base, size, sections[LINES], info.lines_) &&
+                 map_section(base, size, sections[LINE_BREAKPOINTS], info.line_breakpoints_) &&
+                 map_section(base, size, sections[LINE_TABLE], info.line_table_) &&
+                 map_section(base, size, sections[FILES], info.files_) &&
+                 map_section(base, size, sections[INSTANCE_SET], info.instance_set_) &&
+                 map_section(base, size, sections[GENERATOR_VARIABLES],
+                             info.generator_variables_) &&
+                 map_section(base, size, sections[GENERATOR_GROUPS], info.generator_groups_) &&
+                 map_section(base, size, sections[CONTEXT_VARIABLES], info.context_variables_) &&
+                 map_section(base, size, sections[FRAMES], info.frames_) &&
+                 map_section(base, size, sections[CHILDREN], info.children_) &&
+                 map_section(base, size, sections[SUBTREE_SIZES], info.subtree_sizes_) &&
+                 map_section(base, size, sections[CONNECTIONS], info.connections_) &&
+                 map_section(base, size, sections[CONNECTIONS_TO], info.connections_to_) &&
+                 map_section(base, size, sections[METADATA], info.metadata_);
+    if (!valid || !info.valid()) return std::nullopt;
+    info.owner_ = std::move(owner);
+    info.size_ = size;
+    return info;
+}
+
+std::optional<DebugInfo> DebugInfo::open_cache(const std::string &filename, uint64_t key) {
+    auto fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return std::nullopt;
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(CacheHeader))) {
+        close(fd);
+        return std::nullopt;
+    }
+    auto size = static_cast<size_t>(st.st_size);
+    // the mapping is shared so that simulations on the same host share the same pages
+    auto *ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) return std::nullopt;
+    auto owner = std::shared_ptr<const char>(reinterpret_cast<const char *>(ptr),
+                                             [size](const char *p) {
+                                                 munmap(const_cast<char *>(p), size);
+                                             });
+    auto info = from_buffer(std::move(owner), size);
+    if (!info || info->key() != key) return std::nullopt;
+    return info;
+}
+
+bool DebugInfo::write_cache(const std::string &filename) const {
+    namespace fs = std::filesystem;
+    if (!owner_) return false;
+    std::error_code ec;
+    auto dir = fs::path(filename).parent_path();
+    if (!dir.empty()) fs::create_directories(dir, ec);
+    // write to a temporary file first so that readers never see a partial file
+    auto tmp = fmt::format("{0}.{1}", filename, getpid());
+    {
+        std::ofstream stream(tmp, std::ios::binary | std::ios::trunc);
+        if (!stream) return false;
+        stream.write(owner_.get(), static_cast<std::streamsize>(size_));
+        if (!stream) {
+            stream.close();
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    fs::rename(tmp, filename, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+StrRef DebugInfoBuilder::intern(const std::string &str) {
+    if (string_map_.find(str) != string_map_.end()) return string_map_.at(str);
+    StrRef ref{static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(str.size())};
+    strings_.append(str);
+    string_map_.emplace(str, ref);
+    return ref;
+}
+
+void DebugInfoBuilder::add_instance(uint32_t id, const std::string &handle_name) {
+    instances_.emplace_back(InstanceEntry{id, intern(handle_name)});
+}
+
+void DebugInfoBuilder::add_breakpoint(uint32_t id, const std::string &filename,
+                                      uint32_t line_num, uint32_t column_num) {
+    breakpoints_.emplace_back(BreakpointEntry{id, intern(filename), line_num, column_num});
+}
+
+void DebugInfoBuilder::add_instance_set(uint32_t instance_id, uint32_t breakpoint_id) {
+    instance_set_.emplace_back(InstanceSetEntry{breakpoint_id, instance_id});
+}
+
+void DebugInfoBuilder::add_generator_variable(uint32_t instance_id, const std::string &name,
+                                              const std::string &value, bool is_var) {
+    generator_variables_.emplace_back(
+        RawVariable{instance_id, 0, VariableEntry{intern(name), intern(value), is_var}});
+}
+
+void DebugInfoBuilder::add_context_variable(uint32_t instance_id, uint32_t breakpoint_id,
+                                            const std::string &name, const std::string &value,
+                                            bool is_var) {
+    context_variables_.emplace_back(RawVariable{
+        instance_id, breakpoint_id, VariableEntry{intern(name), intern(value), is_var}});
+}
+
+void DebugInfoBuilder::add_child(uint32_t parent_id, const std::string &name) {
+    children_.emplace_back(ChildEntry{parent_id, intern(name), NO_INSTANCE});
+}
+
+void DebugInfoBuilder::add_connection(uint32_t handle_from, const std::string &var_from,
+                                      uint32_t handle_to, const std::string &var_to) {
+    connections_.emplace_back(
+        ConnectionEntry{handle_from, intern(var_from), handle_to, intern(var_to)});
+}
+
+void DebugInfoBuilder::set_top_name(const std::string &top_name) { top_name_ = intern(top_name); }
+
+class BufferWriter {
+public:
+    BufferWriter() { buffer_.resize(sizeof(CacheHeader), 0); }
+
+    template <typename T>
+    void write(Section section, const T *data, size_t size) {
+        // every section is 8-byte aligned
+        buffer_.resize((buffer_.size() + 7u) & ~size_t(7u), 0);
+        header_.sections[section] = SectionEntry{buffer_.size(), size * sizeof(T)};
+        auto const *bytes = reinterpret_cast<const char *>(data);
+        buffer_.insert(buffer_.end(), bytes, bytes + size * sizeof(T));
+    }
+
+    template <typename T>
+    void write(Section section, const std::vector<T> &values) {
+        write(section, values.data(), values.size());
+    }
+
+    std::pair<std::shared_ptr<const char>, size_t> finish() {
+        std::memcpy(header_.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header_.version = CACHE_VERSION;
+        header_.num_sections = NUM_SECTIONS;
+        header_.size = buffer_.size();
+        std::memcpy(buffer_.data(), &header_, sizeof(CacheHeader));
+        // use 64-bit words to guarantee the alignment
+        auto num_words = (buffer_.size() + 7u) / 8u;
+        auto words = std::shared_ptr<uint64_t[]>(new uint64_t[num_words]);
+        std::memcpy(words.get(), buffer_.data(), buffer_.size());
+        return {std::shared_ptr<const char>(words, reinterpret_cast<const char *>(words.get())),
+                buffer_.size()};
+    }
+
+private:
+    CacheHeader header_ = {};
+    std::vector<char> buffer_;
+};
+
+DebugInfo DebugInfoBuilder::build(uint64_t key) {
+    std::sort(instances_.begin(), instances_.end(),
+              [](const InstanceEntry &a, const InstanceEntry &b) { return a.id < b.id; });
+    std::vector<uint32_t> instance_names(instances_.size());
+    for (uint32_t i = 0; i < instance_names.size(); i++) instance_names[i] = i;
+    std::sort(instance_names.begin(), instance_names.end(), [this](uint32_t a, uint32_t b) {
+        return str(instances_[a].handle_name) < str(instances_[b].handle_name);
+    });
+    std::sort(breakpoints_.begin(), breakpoints_.end(),
+              [](const BreakpointEntry &a, const BreakpointEntry &b) { return a.id < b.id; });
+
+    // group breakpoints by filename and line number
+    std::vector<const BreakpointEntry *> bps;
+    bps.reserve(breakpoints_.size());
+    for (auto const &bp : breakpoints_) bps.emplace_back(&bp);
+    std::sort(bps.begin(), bps.end(), [this](const BreakpointEntry *a, const BreakpointEntry *b) {
+        return std::make_tuple(str(a->filename), a->line_num, a->column_num, a->id) <
+               std::make_tuple(str(b->filename), b->line_num, b->column_num, b->id);
+    });
+    std::vector<LineEntry> lines;
+    std::vector<uint32_t> line_breakpoints;
+    line_breakpoints.reserve(bps.size());
+    for (auto const *bp : bps) {
+        auto index = static_cast<uint32_t>(line_breakpoints.size());
+        if (lines.empty() || lines.back().line_num != bp->line_num ||
+            str(lines.back().filename) != str(bp->filename)) {
+            lines.emplace_back(LineEntry{bp->filename, bp->line_num, index, index});
+        }
+        line_breakpoints.emplace_back(bp->id);
+        lines.back().end = index + 1;
+    }
+    std::vector<FileEntry> files;
+    for (uint32_t i = 0; i < lines.size(); i++) {
+        auto const &line = lines[i];
+        if (files.empty() || str(files.back().filename) != str(line.filename)) {
+            files.emplace_back(FileEntry{line.filename, i, i});
+        }
+        files.back().end = i + 1;
+    }
+    // hash table for line lookup. keep the load factor under 0.5
+    size_t table_size = 1;
+    while (table_size < lines.size() * 2) table_size <<= 1u;
+    std::vector<uint32_t> line_table(table_size, 0);
+    auto mask = table_size - 1;
+    for (uint32_t i = 0; i < lines.size(); i++) {
+        auto slot = DebugInfo::hash(str(lines[i].filename), lines[i].line_num) & mask;
+        while (line_table[slot]) slot = (slot + 1) & mask;
+        line_table[slot] = i + 1;
+    }
+
+    auto set_key = [](const InstanceSetEntry &a) {
+        return std::make_pair(a.breakpoint_id, a.instance_id);
+    };
+    std::sort(instance_set_.begin(), instance_set_.end(),
+              [&](const InstanceSetEntry &a, const InstanceSetEntry &b) {
+                  return set_key(a) < set_key(b);
+              });
+    instance_set_.erase(std::unique(instance_set_.begin(), instance_set_.end(),
+                                    [&](const InstanceSetEntry &a, const InstanceSetEntry &b) {
+                                        return set_key(a) == set_key(b);
+                                    }),
+                        instance_set_.end());
+
+    // generator variables are grouped by instance
+    std::stable_sort(generator_variables_.begin(), generator_variables_.end(),
+                     [](const RawVariable &a, const RawVariable &b) {
+                         return a.instance_id < b.instance_id;
+                     });
+    std::vector<VariableEntry> generator_variables;
+    std::vector<VariableGroup> generator_groups;
+    generator_variables.reserve(generator_variables_.size());
+    for (auto const &var : generator_variables_) {
+        auto index = static_cast<uint32_t>(generator_variables.size());
+        if (generator_groups.empty() || generator_groups.back().instance_id != var.instance_id) {
+            generator_groups.emplace_back(VariableGroup{var.instance_id, index, index});
+        }
+        generator_variables.emplace_back(var.entry);
+        generator_groups.back().end = index + 1;
+    }
+
+    // context variables are grouped by (instance, breakpoint), which is the frame key
+    std::stable_sort(context_variables_.begin(), context_variables_.end(),
+                     [](const RawVariable &a, const RawVariable &b) {
+                         return std::make_pair(a.instance_id, a.breakpoint_id) <
+                                std::make_pair(b.instance_id, b.breakpoint_id);
+                     });
+    std::vector<std::pair<uint32_t, uint32_t>> frame_keys;
+    frame_keys.reserve(instance_set_.size() + context_variables_.size());
+    for (auto const &entry : instance_set_)
+        frame_keys.emplace_back(entry.instance_id, entry.breakpoint_id);
+    for (auto const &var : context_variables_)
+        frame_keys.emplace_back(var.instance_id, var.breakpoint_id);
+    std::sort(frame_keys.begin(), frame_keys.end());
+    frame_keys.erase(std::unique(frame_keys.begin(), frame_keys.end()), frame_keys.end());
+
+    std::vector<VariableEntry> context_variables;
+    context_variables.reserve(context_variables_.size());
+    for (auto const &var : context_variables_) context_variables.emplace_back(var.entry);
+
+    std::vector<FrameEntry> frames;
+    frames.reserve(frame_keys.size());
+    uint32_t context_index = 0;
+    uint32_t group_index = 0;
+    for (auto const &[instance_id, breakpoint_id] : frame_keys) {
+        FrameEntry frame{instance_id, breakpoint_id, 0, 0, 0, 0};
+        // frame keys, generator groups and context variables are sorted by instance first
+        while (group_index < generator_groups.size() &&
+               generator_groups[group_index].instance_id < instance_id) {
+            group_index++;
+        }
+        if (group_index < generator_groups.size() &&
+            generator_groups[group_index].instance_id == instance_id) {
+            frame.gen_begin = generator_groups[group_index].begin;
+            frame.gen_end = generator_groups[group_index].end;
+        }
+        while (context_index < context_variables_.size() &&
+               std::make_pair(context_variables_[context_index].instance_id,
+                              context_variables_[context_index].breakpoint_id) <
+                   std::make_pair(instance_id, breakpoint_id)) {
+            context_index++;
+        }
+        frame.context_begin = context_index;
+        while (context_index < context_variables_.size() &&
+               context_variables_[context_index].instance_id == instance_id &&
+               context_variables_[context_index].breakpoint_id == breakpoint_id) {
+            context_index++;
+        }
+        frame.context_end = context_index;
+        frames.emplace_back(frame);
+    }
+
+    // hierarchy and connection adjacency lists
+    std::sort(children_.begin(), children_.end(), [this](const ChildEntry &a, const ChildEntry &b) {
+        return std::make_pair(a.parent_id, str(a.name)) < std::make_pair(b.parent_id, str(b.name));
+    });
+    auto find_index = [&](std::string_view name) -> std::optional<uint32_t> {
+        auto it = std::lower_bound(instance_names.begin(), instance_names.end(), name,
+                                   [this](uint32_t index, std::string_view value) {
+                                       return str(instances_[index].handle_name) < value;
+                                   });
+        if (it != instance_names.end() && str(instances_[*it].handle_name) == name) return *it;
+        return std::nullopt;
+    };
+    // child handle names follow the parent.child convention
+    std::vector<std::vector<uint32_t>> child_indices(instances_.size());
+    for (auto &child : children_) {
+        auto parent = lower_bound_id(Span<InstanceEntry>{instances_.data(), instances_.size()},
+                                     child.parent_id);
+        if (parent == instances_.data() + instances_.size() || parent->id != child.parent_id)
+            continue;
+        auto index = find_index(fmt::format("{0}.{1}", str(parent->handle_name), str(child.name)));
+        if (!index) continue;
+        child.child_id = instances_[*index].id;
+        child_indices[parent - instances_.data()].emplace_back(*index);
+    }
+    // post-order traversal. the visited flags guard against cycles in malformed databases
+    std::vector<uint32_t> subtree_sizes(instances_.size(), 0);
+    std::vector<bool> visited(instances_.size(), false);
+    for (uint32_t root = 0; root < instances_.size(); root++) {
+        if (visited[root]) continue;
+        std::vector<std::pair<uint32_t, bool>> stack = {{root, false}};
+        while (!stack.empty()) {
+            auto [index, expanded] = stack.back();
+            stack.pop_back();
+            if (expanded) {
+                subtree_sizes[index] = 1;
+                for (auto const child : child_indices[index]) {
+                    subtree_sizes[index] += subtree_sizes[child];
+                }
+                continue;
+            }
+            if (visited[index]) continue;
+            visited[index] = true;
+            stack.emplace_back(index, true);
+            for (auto const child : child_indices[index]) {
+                if (!visited[child]) stack.emplace_back(child, false);
+            }
+        }
+    }
+    std::stable_sort(connections_.begin(), connections_.end(),
+                     [](const ConnectionEntry &a, const ConnectionEntry &b) {
+                         return a.handle_from < b.handle_from;
+                     });
+    std::vector<uint32_t> connections_to(connections_.size());
+    for (uint32_t i = 0; i < connections_to.size(); i++) connections_to[i] = i;
+    std::stable_sort(connections_to.begin(), connections_to.end(), [this](uint32_t a, uint32_t b) {
+        return connections_[a].handle_to < connections_[b].handle_to;
+    });
+
+    std::vector<uint64_t> metadata(NUM_METADATA, 0);
+    metadata[KEY] = key;
+    if (top_name_) {
+        metadata[HAS_TOP_NAME] = 1;
+        metadata[TOP_NAME_OFFSET] = top_name_->offset;
+        metadata[TOP_NAME_SIZE] = top_name_->size;
+    }
+
+    BufferWriter writer;
+    writer.write(STRINGS, strings_.data(), strings_.size());
+    writer.write(INSTANCES, instances_);
+    writer.write(INSTANCE_NAMES, instance_names);
+    writer.write(BREAKPOINTS, breakpoints_);
+    writer.write(LINES, lines);
+    writer.write(LINE_BREAKPOINTS, line_breakpoints);
+    writer.write(LINE_TABLE, line_table);
+    writer.write(FILES, files);
+    writer.write(INSTANCE_SET, instance_set_);
+    writer.write(GENERATOR_VARIABLES, generator_variables);
+    writer.write(GENERATOR_GROUPS, generator_groups);
+    writer.write(CONTEXT_VARIABLES, context_variables);
+    writer.write(FRAMES, frames);
+    writer.write(CHILDREN, children_);
+    writer.write(SUBTREE_SIZES, subtree_sizes);
+    writer.write(CONNECTIONS, connections_);
+    writer.write(CONNECTIONS_TO, connections_to);
+    writer.write(METADATA, metadata);
+    auto [buffer, size] = writer.finish();
+
+    *this = DebugInfoBuilder();
+    return *DebugInfo::from_buffer(std::move(buffer), size);
+}
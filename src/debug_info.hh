@@ -0,0 +1,249 @@
+#ifndef KRATOS_RUNTIME_DEBUG_INFO_HH
+#define KRATOS_RUNTIME_DEBUG_INFO_HH
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// the debug database is immutable during the simulation, so we load everything we need
+// into flat arrays. all strings are stored in a single string table and referenced by
+// offset. the arrays are laid out in a single buffer that can be written to disk as is and
+// mmap-ed by later runs
+struct StrRef {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct InstanceEntry {
+    uint32_t id;
+    StrRef handle_name;
+};
+
+struct BreakpointEntry {
+    uint32_t id;
+    StrRef filename;
+    uint32_t line_num;
+    uint32_t column_num;
+};
+
+// breakpoints that share the same filename and line number
+struct LineEntry {
+    StrRef filename;
+    uint32_t line_num;
+    // range in the line breakpoint array
+    uint32_t begin;
+    uint32_t end;
+};
+
+struct FileEntry {
+    StrRef filename;
+    // range in the line array
+    uint32_t begin;
+    uint32_t end;
+};
+
+struct InstanceSetEntry {
+    uint32_t breakpoint_id;
+    uint32_t instance_id;
+};
+
+struct VariableEntry {
+    StrRef name;
+    StrRef value;
+    uint32_t is_var;
+};
+
+// variables owned by an instance (generator variables)
+struct VariableGroup {
+    uint32_t instance_id;
+    // range in the generator variable array
+    uint32_t begin;
+    uint32_t end;
+};
+
+// everything needed to build a frame when (instance_id, breakpoint_id) is hit
+struct FrameEntry {
+    uint32_t instance_id;
+    uint32_t breakpoint_id;
+    // range in the generator variable array
+    uint32_t gen_begin;
+    uint32_t gen_end;
+    // range in the context variable array
+    uint32_t context_begin;
+    uint32_t context_end;
+};
+
+struct ChildEntry {
+    uint32_t parent_id;
+    StrRef name;
+    // resolved from the handle name. NO_INSTANCE if the child is not in the instance table
+    uint32_t child_id;
+};
+
+constexpr uint32_t NO_INSTANCE = 0xFFFFFFFF;
+
+struct ConnectionEntry {
+    uint32_t handle_from;
+    StrRef var_from;
+    uint32_t handle_to;
+    StrRef var_to;
+};
+
+template <typename T>
+struct Span {
+    const T *data = nullptr;
+    size_t size = 0;
+
+    [[nodiscard]] const T *begin() const { return data; }
+    [[nodiscard]] const T *end() const { return data + size; }
+    [[nodiscard]] bool empty() const { return size == 0; }
+    const T &operator[](size_t index) const { return data[index]; }
+};
+
+// connections that share the same signal. only the driver has to be read
+struct Net {
+    std::string driver;
+    std::vector<std::string> handles;
+};
+
+class DebugInfo {
+public:
+    [[nodiscard]] std::string_view str(const StrRef &ref) const {
+        return std::string_view(strings_.data + ref.offset, ref.size);
+    }
+
+    [[nodiscard]] const BreakpointEntry *get_breakpoint(uint32_t id) const;
+    // breakpoint ids at given filename and line number, sorted by column
+    [[nodiscard]] Span<uint32_t> get_breakpoints(std::string_view filename,
+                                                 uint32_t line_num) const;
+    [[nodiscard]] std::vector<uint32_t> get_file_breakpoints(std::string_view filename) const;
+    [[nodiscard]] Span<FileEntry> get_files() const { return files_; }
+    [[nodiscard]] Span<InstanceSetEntry> get_instances(uint32_t breakpoint_id) const;
+    [[nodiscard]] std::string_view get_instance_name(uint32_t instance_id) const;
+    [[nodiscard]] std::optional<uint32_t> get_instance_id(std::string_view handle_name) const;
+    [[nodiscard]] const FrameEntry *get_frame(uint32_t instance_id, uint32_t breakpoint_id) const;
+    [[nodiscard]] Span<FrameEntry> get_frames(uint32_t instance_id) const;
+    [[nodiscard]] Span<VariableEntry> get_generator_variables(uint32_t instance_id) const;
+    [[nodiscard]] Span<VariableEntry> get_generator_variables(const FrameEntry &frame) const;
+    [[nodiscard]] Span<VariableEntry> get_context_variables(const FrameEntry &frame) const;
+    // sorted by name
+    [[nodiscard]] Span<ChildEntry> get_children(uint32_t instance_id) const;
+    // number of instances in the subtree, including the instance itself
+    [[nodiscard]] uint32_t get_subtree_size(uint32_t instance_id) const;
+    // walks down the hierarchy one level at a time
+    [[nodiscard]] std::optional<uint32_t> find_instance(std::string_view path) const;
+    // glob (* and ?) search over instance paths. patterns without any wildcard are
+    // treated as prefix. results are sorted by name
+    [[nodiscard]] std::vector<uint32_t> search_instances(std::string_view pattern,
+                                                         size_t limit) const;
+    [[nodiscard]] Span<ConnectionEntry> get_connections_from(uint32_t instance_id) const;
+    [[nodiscard]] std::vector<const ConnectionEntry *> get_connections_to(
+        uint32_t instance_id) const;
+    [[nodiscard]] std::string_view get_top_name() const;
+    // nets formed by the connections of every child instance in the scope. empty scope is the
+    // top
+    [[nodiscard]] std::vector<Net> compute_nets(std::string_view scope) const;
+
+    [[nodiscard]] size_t num_breakpoints() const { return breakpoints_.size; }
+    [[nodiscard]] size_t num_frames() const { return frames_.size; }
+    [[nodiscard]] uint64_t key() const;
+
+    static uint64_t hash(std::string_view filename, uint32_t line_num);
+    static bool glob_match(std::string_view pattern, std::string_view value);
+
+    // the binary cache is only valid for the database content identified by the key
+    static std::optional<DebugInfo> open_cache(const std::string &filename, uint64_t key);
+    bool write_cache(const std::string &filename) const;
+
+private:
+    // the buffer has to be 8-byte aligned. owner keeps the buffer alive
+    static std::optional<DebugInfo> from_buffer(std::shared_ptr<const char> owner, size_t size);
+    // every string reference, range and index has to stay inside its section
+    [[nodiscard]] bool valid() const;
+
+    std::shared_ptr<const char> owner_;
+    size_t size_ = 0;
+
+    Span<char> strings_;
+    // sorted by id
+    Span<InstanceEntry> instances_;
+    // index into instances_, sorted by handle name
+    Span<uint32_t> instance_names_;
+    // sorted by id
+    Span<BreakpointEntry> breakpoints_;
+    // sorted by (filename, line_num)
+    Span<LineEntry> lines_;
+    Span<uint32_t> line_breakpoints_;
+    // open addressing hash table of (filename, line_num) -> index + 1 in lines_
+    Span<uint32_t> line_table_;
+    // sorted by filename
+    Span<FileEntry> files_;
+    // sorted by (breakpoint_id, instance_id)
+    Span<InstanceSetEntry> instance_set_;
+    Span<VariableEntry> generator_variables_;
+    // sorted by instance_id
+    Span<VariableGroup> generator_groups_;
+    Span<VariableEntry> context_variables_;
+    // sorted by (instance_id, breakpoint_id)
+    Span<FrameEntry> frames_;
+    // sorted by (parent_id, name)
+    Span<ChildEntry> children_;
+    // parallel to instances_
+    Span<uint32_t> subtree_sizes_;
+    // sorted by handle_from
+    Span<ConnectionEntry> connections_;
+    // index into connections_, sorted by handle_to
+    Span<uint32_t> connections_to_;
+    // top name, key, etc
+    Span<uint64_t> metadata_;
+
+    friend class DebugInfoBuilder;
+};
+
+// collects the raw rows from the database and compiles them into a DebugInfo
+class DebugInfoBuilder {
+public:
+    void add_instance(uint32_t id, const std::string &handle_name);
+    void add_breakpoint(uint32_t id, const std::string &filename, uint32_t line_num,
+                        uint32_t column_num);
+    void add_instance_set(uint32_t instance_id, uint32_t breakpoint_id);
+    void add_generator_variable(uint32_t instance_id, const std::string &name,
+                                const std::string &value, bool is_var);
+    void add_context_variable(uint32_t instance_id, uint32_t breakpoint_id,
+                              const std::string &name, const std::string &value, bool is_var);
+    void add_child(uint32_t parent_id, const std::string &name);
+    void add_connection(uint32_t handle_from, const std::string &var_from, uint32_t handle_to,
+                        const std::string &var_to);
+    void set_top_name(const std::string &top_name);
+
+    DebugInfo build(uint64_t key = 0);
+
+private:
+    StrRef intern(const std::string &str);
+    [[nodiscard]] std::string_view str(const StrRef &ref) const {
+        return std::string_view(strings_.data() + ref.offset, ref.size);
+    }
+
+    struct RawVariable {
+        uint32_t instance_id;
+        uint32_t breakpoint_id;
+        VariableEntry entry;
+    };
+
+    std::string strings_;
+    std::unordered_map<std::string, StrRef> string_map_;
+    std::vector<InstanceEntry> instances_;
+    std::vector<BreakpointEntry> breakpoints_;
+    std::vector<InstanceSetEntry> instance_set_;
+    std::vector<RawVariable> generator_variables_;
+    std::vector<RawVariable> context_variables_;
+    std::vector<ChildEntry> children_;
+    std::vector<ConnectionEntry> connections_;
+    std::optional<StrRef> top_name_;
+};
+
+#endif  // KRATOS_RUNTIME_DEBUG_INFO_HH
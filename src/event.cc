@@ -0,0 +1,150 @@
+#include "event.hh"
+
+std::optional<BackpressurePolicy> parse_backpressure_policy(const std::string &policy) {
+    if (policy == "block") return BackpressurePolicy::Block;
+    if (policy == "coalesce") return BackpressurePolicy::Coalesce;
+    if (policy == "drop-oldest") return BackpressurePolicy::DropOldest;
+    return std::nullopt;
+}
+
+EventSender::EventSender(Transport transport, size_t capacity, BackpressurePolicy policy)
+    : transport_(std::move(transport)), capacity_(capacity > 0 ? capacity : 1), policy_(policy) {
+    thread_ = std::thread([this]() { run(); });
+}
+
+EventSender::~EventSender() {
+    {
+        std::lock_guard guard(lock_);
+        stop_ = true;
+    }
+    queue_cond_.notify_all();
+    space_cond_.notify_all();
+    thread_.join();
+}
+
+void EventSender::send(Event event) {
+    std::unique_lock lock(lock_);
+    auto seq = front_seq_ + queue_.size();
+    if (event.key.empty()) {
+        barrier_seq_ = seq;
+    } else {
+        if (policy_ == BackpressurePolicy::Coalesce) {
+            auto it = pending_keys_.find(event.key);
+            if (it != pending_keys_.end() && (!barrier_seq_ || it->second > *barrier_seq_)) {
+                queue_[it->second - front_seq_].event = std::move(event);
+                stats_.coalesced++;
+                return;
+            }
+        }
+        if (num_pending_ >= capacity_) {
+            if (policy_ == BackpressurePolicy::Block) {
+                space_cond_.wait(lock, [this]() { return num_pending_ < capacity_ || stop_; });
+                seq = front_seq_ + queue_.size();
+            } else {
+                drop_oldest();
+            }
+        }
+        pending_keys_[event.key] = seq;
+        num_pending_++;
+    }
+    queue_.emplace_back(QueuedEvent{std::move(event)});
+    queue_cond_.notify_one();
+}
+
+void EventSender::drop_oldest() {
+    for (uint64_t i = 0; i < queue_.size(); i++) {
+        auto &entry = queue_[i];
+        if (entry.dropped || entry.event.key.empty()) continue;
+        auto it = pending_keys_.find(entry.event.key);
+        if (it != pending_keys_.end() && it->second == front_seq_ + i) pending_keys_.erase(it);
+        entry.dropped = true;
+        entry.event = {};
+        num_pending_--;
+        stats_.dropped++;
+        return;
+    }
+}
+
+void EventSender::flush() {
+    std::unique_lock lock(lock_);
+    idle_cond_.wait(lock, [this]() { return queue_.empty() && !sending_; });
+}
+
+bool EventSender::is_pending(const std::string &key) {
+    std::lock_guard guard(lock_);
+    return pending_keys_.find(key) != pending_keys_.end();
+}
+
+EventStats EventSender::stats() {
+    std::lock_guard guard(lock_);
+    return stats_;
+}
+
+void EventSender::run() {
+    while (true) {
+        Event event;
+        {
+            std::unique_lock lock(lock_);
+            queue_cond_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) break;
+            auto entry = std::move(queue_.front());
+            queue_.pop_front();
+            auto seq = front_seq_++;
+            if (barrier_seq_ && *barrier_seq_ == seq) barrier_seq_ = std::nullopt;
+            if (entry.dropped) {
+                if (queue_.empty()) idle_cond_.notify_all();
+                continue;
+            }
+            if (!entry.event.key.empty()) {
+                auto it = pending_keys_.find(entry.event.key);
+                if (it != pending_keys_.end() && it->second == seq) pending_keys_.erase(it);
+                num_pending_--;
+            }
+            event = std::move(entry.event);
+            sending_ = true;
+        }
+        space_cond_.notify_all();
+        transport_(event);
+        {
+            std::lock_guard guard(lock_);
+            sending_ = false;
+            stats_.sent++;
+        }
+        idle_cond_.notify_all();
+    }
+    idle_cond_.notify_all();
+}
+
+void EventStream::publish(Event event) {
+    {
+        std::lock_guard guard(lock_);
+        events_.emplace_back(StreamEvent{next_seq_++, std::move(event)});
+        if (events_.size() > capacity_) events_.pop_front();
+    }
+    cond_.notify_all();
+}
+
+StreamBatch EventStream::poll(uint64_t since, std::chrono::milliseconds timeout) {
+    std::unique_lock lock(lock_);
+    cond_.wait_for(lock, timeout, [this, since]() { return closed_ || next_seq_ > since; });
+    StreamBatch batch{{}, next_seq_, false};
+    if (since > next_seq_) {
+        // the subscriber is from a different run. start over
+        batch.missed = true;
+        return batch;
+    }
+    auto first = events_.empty() ? next_seq_ : events_.front().seq;
+    batch.missed = since < first;
+    for (auto const &event : events_) {
+        if (event.seq >= since) batch.events.emplace_back(event);
+    }
+    return batch;
+}
+
+void EventStream::close() {
+    {
+        std::lock_guard guard(lock_);
+        closed_ = true;
+    }
+    cond_.notify_all();
+}
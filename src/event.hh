@@ -0,0 +1,121 @@
+#ifndef KRATOS_RUNTIME_EVENT_HH
+#define KRATOS_RUNTIME_EVENT_HH
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// notification sent from the simulator to the debugger
+struct Event {
+    std::string path;
+    std::string content;
+    std::string content_type;
+    // events with a key, e.g. signal values, can be coalesced or dropped when the queue is
+    // full. events without a key, such as breakpoint hits, are always delivered in order
+    std::string key;
+};
+
+// what to do when the simulator produces events faster than the debugger consumes them
+enum class BackpressurePolicy { Block, Coalesce, DropOldest };
+
+std::optional<BackpressurePolicy> parse_backpressure_policy(const std::string &policy);
+
+struct EventStats {
+    uint64_t sent = 0;
+    uint64_t coalesced = 0;
+    uint64_t dropped = 0;
+};
+
+// sends events on a dedicated thread so that the simulator never waits on the network
+class EventSender {
+public:
+    using Transport = std::function<void(const Event &)>;
+    // capacity only applies to events with a key
+    EventSender(Transport transport, size_t capacity, BackpressurePolicy policy);
+    // all the queued events are sent before the thread exits
+    ~EventSender();
+    EventSender(const EventSender &) = delete;
+    EventSender &operator=(const EventSender &) = delete;
+
+    void send(Event event);
+    // blocks until every queued event is sent
+    void flush();
+    // true if an event with the key is queued and not sent yet
+    bool is_pending(const std::string &key);
+    EventStats stats();
+
+private:
+    struct QueuedEvent {
+        Event event;
+        bool dropped = false;
+    };
+
+    void run();
+    void drop_oldest();
+
+    Transport transport_;
+    size_t capacity_;
+    BackpressurePolicy policy_;
+
+    std::mutex lock_;
+    std::condition_variable queue_cond_;
+    std::condition_variable space_cond_;
+    std::condition_variable idle_cond_;
+    std::deque<QueuedEvent> queue_;
+    // sequence number of the event at the front of the queue
+    uint64_t front_seq_ = 0;
+    // key -> sequence number of the queued event with that key
+    std::unordered_map<std::string, uint64_t> pending_keys_;
+    // events with a key are never coalesced across events without one
+    std::optional<uint64_t> barrier_seq_;
+    size_t num_pending_ = 0;
+    bool sending_ = false;
+    bool stop_ = false;
+    EventStats stats_;
+
+    std::thread thread_;
+};
+
+struct StreamEvent {
+    uint64_t seq;
+    Event event;
+};
+
+struct StreamBatch {
+    std::vector<StreamEvent> events;
+    // sequence number to use for the next poll
+    uint64_t next_seq;
+    // true if some events were evicted before the subscriber could read them
+    bool missed;
+};
+
+// recent events kept on the runtime side so that debuggers can subscribe through the
+// runtime's own server instead of opening a server themselves
+class EventStream {
+public:
+    explicit EventStream(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+    void publish(Event event);
+    // waits until there is any event at or after since, the timeout expires, or the
+    // stream is closed
+    StreamBatch poll(uint64_t since, std::chrono::milliseconds timeout);
+    void close();
+
+private:
+    size_t capacity_;
+    std::mutex lock_;
+    std::condition_variable cond_;
+    std::deque<StreamEvent> events_;
+    uint64_t next_seq_ = 0;
+    bool closed_ = false;
+};
+
+#endif  // KRATOS_RUNTIME_EVENT_HH
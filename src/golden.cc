@@ -0,0 +1,52 @@
+#include "golden.hh"
+
+#include <algorithm>
+#include <iterator>
+
+#include "monitor.hh"
+
+GoldenTrace::GoldenTrace(CaptureData data)
+    : names_(std::move(data.names)),
+      widths_(std::move(data.widths)),
+      times_(std::move(data.times)),
+      num_rows_(times_.size()),
+      zeros_(names_.size(), 0) {
+    auto num_signals = names_.size();
+    rows_.resize(data.values.size());
+    for (uint64_t i = 0; i < num_signals; i++) {
+        // bits above the width, e.g. from a sign-extended value, are not compared
+        auto mask = widths_[i] >= 64 ? ~uint64_t(0) : (uint64_t(1) << widths_[i]) - 1;
+        for (uint64_t row = 0; row < num_rows_; row++) {
+            rows_[row * num_signals + i] = data.values[i * num_rows_ + row] & mask;
+        }
+    }
+}
+
+uint64_t GoldenTrace::expected_time() const {
+    return cycle_ < num_rows_ ? times_[cycle_] : 0;
+}
+
+bool GoldenTrace::check(const std::vector<uint64_t> &values, const std::vector<uint64_t> &unknown,
+                        std::vector<GoldenMismatch> &mismatches) {
+    if (done() || values.size() != names_.size() || unknown.size() != names_.size())
+        return false;
+    auto size = static_cast<uint32_t>(values.size());
+    auto const *expected = rows_.data() + cycle_ * names_.size();
+    changes_.clear();
+    find_changes(expected, values.data(), size, changes_);
+    // signals with X or Z bits are the ones that differ from 0
+    unknown_changes_.clear();
+    find_changes(zeros_.data(), unknown.data(), size, unknown_changes_);
+    auto const *result = &changes_;
+    if (!unknown_changes_.empty()) {
+        merged_.clear();
+        std::set_union(changes_.begin(), changes_.end(), unknown_changes_.begin(),
+                       unknown_changes_.end(), std::back_inserter(merged_));
+        result = &merged_;
+    }
+    for (auto i : *result) {
+        mismatches.emplace_back(GoldenMismatch{i, expected[i], values[i], unknown[i]});
+    }
+    cycle_++;
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef KRATOS_RUNTIME_GOLDEN_HH
+#define KRATOS_RUNTIME_GOLDEN_HH
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "capture.hh"
+
+struct GoldenMismatch {
+    uint32_t signal;
+    uint64_t expected;
+    uint64_t actual;
+    // X or Z bits of the actual value
+    uint64_t unknown;
+};
+
+// compares the live state at every clock edge against an expected trace, such as a capture
+// from a passing run, so that the simulation can stop at the first diverging cycle instead of
+// being diffed after it finishes. rows are matched by clock edge, not by time
+class GoldenTrace {
+public:
+    explicit GoldenTrace(CaptureData data);
+
+    [[nodiscard]] const std::vector<std::string> &names() const { return names_; }
+    [[nodiscard]] const std::vector<uint32_t> &widths() const { return widths_; }
+    [[nodiscard]] uint64_t num_rows() const { return num_rows_; }
+    // rows compared so far
+    [[nodiscard]] uint64_t cycle() const { return cycle_; }
+    [[nodiscard]] bool done() const { return cycle_ >= num_rows_; }
+    [[nodiscard]] uint64_t expected_time() const;
+
+    // compares the values, in the same order as the names, with the next row. a value with X
+    // or Z bits in unknown never matches. returns false once every row has been compared
+    bool check(const std::vector<uint64_t> &values, const std::vector<uint64_t> &unknown,
+               std::vector<GoldenMismatch> &mismatches);
+
+private:
+    std::vector<std::string> names_;
+    std::vector<uint32_t> widths_;
+    std::vector<uint64_t> times_;
+    // row-major, so that every cycle compares one contiguous row
+    std::vector<uint64_t> rows_;
+    uint64_t num_rows_ = 0;
+    uint64_t cycle_ = 0;
+    std::vector<uint32_t> changes_;
+    std::vector<uint32_t> unknown_changes_;
+    std::vector<uint32_t> merged_;
+    std::vector<uint64_t> zeros_;
+};
+
+#endif  // KRATOS_RUNTIME_GOLDEN_HH
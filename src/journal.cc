@@ -0,0 +1,142 @@
+#include "journal.hh"
+
+#include <sqlite3.h>
+
+#include <filesystem>
+#include <iostream>
+
+BreakpointJournal::~BreakpointJournal() {
+    {
+        std::lock_guard guard(lock_);
+        stop_ = true;
+    }
+    queue_cond_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    if (!conn_) return;
+    // building the index once is cheaper than updating it on every insert. a journal left by
+    // a crash can still be queried, only slower
+    try {
+        conn_->exec("CREATE INDEX IF NOT EXISTS hit_line ON hit (filename, line_num)");
+    } catch (const std::exception &ex) {
+        std::cerr << "ERROR: " << ex.what() << std::endl;
+    }
+}
+
+// only the journal of a previous run is replaced, so that a wrong path doesn't delete an
+// unrelated file
+static bool is_journal(const std::string &filename) {
+    try {
+        SQLiteConnection conn(filename);
+        Query query(conn.statement(
+            "journal", "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'hit'"));
+        return query.next();
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+bool BreakpointJournal::open(const std::string &filename) {
+    std::error_code ec;
+    if (std::filesystem::exists(filename, ec) && !is_journal(filename)) {
+        std::cerr << "ERROR: " << filename << " is not a breakpoint journal" << std::endl;
+        return false;
+    }
+    for (auto const *suffix : {"", "-wal", "-shm"}) {
+        std::filesystem::remove(filename + suffix, ec);
+    }
+    sqlite3 *db;
+    if (sqlite3_open_v2(filename.c_str(), &db,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX,
+                        nullptr) != SQLITE_OK) {
+        sqlite3_close(db);
+        return false;
+    }
+    conn_ = std::make_unique<SQLiteConnection>(db);
+    try {
+        // queries on the journal don't block the writer while the simulation runs
+        conn_->exec("PRAGMA journal_mode=WAL");
+        // a crash may lose the last transactions, but never corrupts the file
+        conn_->exec("PRAGMA synchronous=NORMAL");
+        conn_->exec(
+            "CREATE TABLE hit (id INTEGER PRIMARY KEY, time INTEGER, instance_id INTEGER, "
+            "breakpoint_id INTEGER, filename TEXT, line_num INTEGER, frame TEXT)");
+    } catch (const std::exception &ex) {
+        std::cerr << ex.what() << std::endl;
+        conn_ = nullptr;
+        return false;
+    }
+    thread_ = std::thread([this]() { run(); });
+    return true;
+}
+
+void BreakpointJournal::add(BreakpointHit hit) {
+    std::lock_guard guard(lock_);
+    queue_.emplace_back(std::move(hit));
+    if (queue_.size() >= BATCH_SIZE) queue_cond_.notify_one();
+}
+
+void BreakpointJournal::flush() {
+    std::unique_lock lock(lock_);
+    flush_ = true;
+    queue_cond_.notify_one();
+    idle_cond_.wait(lock, [this]() { return queue_.empty() && !writing_; });
+}
+
+uint64_t BreakpointJournal::size() {
+    std::lock_guard guard(lock_);
+    return num_written_;
+}
+
+void BreakpointJournal::run() {
+    std::vector<BreakpointHit> hits;
+    while (true) {
+        {
+            std::unique_lock lock(lock_);
+            queue_cond_.wait_for(lock, COMMIT_INTERVAL, [this]() {
+                return stop_ || flush_ || queue_.size() >= BATCH_SIZE;
+            });
+            flush_ = false;
+            if (queue_.empty()) {
+                if (stop_) break;
+                continue;
+            }
+            hits.swap(queue_);
+            writing_ = true;
+        }
+        auto written = write(hits);
+        {
+            std::lock_guard guard(lock_);
+            if (written) num_written_ += hits.size();
+            writing_ = false;
+        }
+        hits.clear();
+        idle_cond_.notify_all();
+    }
+}
+
+bool BreakpointJournal::write(const std::vector<BreakpointHit> &hits) {
+    try {
+        conn_->exec("BEGIN TRANSACTION");
+        auto &stmt = conn_->statement(
+            "insert_hit",
+            "INSERT INTO hit (time, instance_id, breakpoint_id, filename, line_num, frame) "
+            "VALUES (?, ?, ?, ?, ?, ?)");
+        for (auto const &hit : hits) {
+            Query query(stmt);
+            query.bind(1, static_cast<int64_t>(hit.time))
+                .bind(2, static_cast<int64_t>(hit.instance_id))
+                .bind(3, static_cast<int64_t>(hit.breakpoint_id))
+                .bind(4, hit.filename)
+                .bind(5, static_cast<int64_t>(hit.line_num));
+            // unbound parameters are NULL
+            if (!hit.frame.empty()) query.bind(6, hit.frame);
+            query.next();
+        }
+        conn_->exec("COMMIT");
+        return true;
+    } catch (const std::exception &ex) {
+        std::cerr << "ERROR: failed to write breakpoint hits: " << ex.what() << std::endl;
+        sqlite3_exec(conn_->handle(), "ROLLBACK", nullptr, nullptr, nullptr);
+        return false;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef KRATOS_RUNTIME_JOURNAL_HH
+#define KRATOS_RUNTIME_JOURNAL_HH
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "query.hh"
+
+struct BreakpointHit {
+    uint64_t time;
+    uint32_t instance_id;
+    uint32_t breakpoint_id;
+    // empty and 0 if the debug database is not loaded
+    std::string filename;
+    uint32_t line_num;
+    // the frame sent with /status/breakpoint as JSON. stored as NULL if it's empty
+    std::string frame;
+};
+
+// keeps every breakpoint hit in a SQLite file, so that hits can be queried after the
+// simulation without running it again. the simulator thread only queues the hits; they are
+// inserted on a background thread, many per transaction, into a database in WAL mode
+class BreakpointJournal {
+public:
+    // hits per transaction
+    static constexpr uint32_t BATCH_SIZE = 4096;
+    // queued hits are committed at least this often, so that a crash loses few of them
+    static constexpr std::chrono::milliseconds COMMIT_INTERVAL{500};
+
+    BreakpointJournal() = default;
+    // all the queued hits are written and the indexes are built before the thread exits
+    ~BreakpointJournal();
+    BreakpointJournal(const BreakpointJournal &) = delete;
+    BreakpointJournal &operator=(const BreakpointJournal &) = delete;
+
+    // replaces the journal of a previous run. returns false if the file exists but is not a
+    // journal, or it can't be created
+    bool open(const std::string &filename);
+    void add(BreakpointHit hit);
+    // blocks until every queued hit is committed
+    void flush();
+    // number of hits committed
+    uint64_t size();
+
+private:
+    void run();
+    // returns false if the transaction is rolled back
+    bool write(const std::vector<BreakpointHit> &hits);
+
+    std::unique_ptr<SQLiteConnection> conn_;
+
+    std::mutex lock_;
+    std::condition_variable queue_cond_;
+    std::condition_variable idle_cond_;
+    std::vector<BreakpointHit> queue_;
+    uint64_t num_written_ = 0;
+    bool writing_ = false;
+    bool flush_ = false;
+    bool stop_ = false;
+
+    std::thread thread_;
+};
+
+#endif  // KRATOS_RUNTIME_JOURNAL_HH
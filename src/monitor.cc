@@ -0,0 +1,275 @@
+#include "monitor.hh"
+
+#include <algorithm>
+
+#include "capture.hh"
+
+// every monitor uses the same formats, so they are shared instead of stored per monitor
+static s_vpi_time monitor_time = {vpiSimTime, 0, 0, 0};
+static s_vpi_value monitor_value = {vpiVectorVal, {0}};
+
+// words compared at once. written so that the compiler can vectorize the inner loop
+constexpr uint32_t BLOCK_SIZE = 8;
+
+std::optional<MonitorMode> parse_monitor_mode(const std::string &mode) {
+    if (mode == "auto") return MonitorMode::Auto;
+    if (mode == "callback") return MonitorMode::Callback;
+    if (mode == "poll") return MonitorMode::Poll;
+    return std::nullopt;
+}
+
+void find_changes(const uint64_t *previous, const uint64_t *current, uint32_t size,
+                  std::vector<uint32_t> &changes) {
+    uint32_t i = 0;
+    for (; i + BLOCK_SIZE <= size; i += BLOCK_SIZE) {
+        uint64_t diff = 0;
+        for (uint32_t j = 0; j < BLOCK_SIZE; j++) {
+            diff |= previous[i + j] ^ current[i + j];
+        }
+        // most blocks are unchanged
+        if (!diff) continue;
+        for (uint32_t j = 0; j < BLOCK_SIZE; j++) {
+            if (previous[i + j] != current[i + j]) changes.emplace_back(i + j);
+        }
+    }
+    for (; i < size; i++) {
+        if (previous[i] != current[i]) changes.emplace_back(i);
+    }
+}
+
+MonitorRegistry::~MonitorRegistry() { clear(); }
+
+uint32_t MonitorRegistry::add_group(bool separate) {
+    std::lock_guard guard(lock_);
+    // reuse an empty group
+    uint32_t group = DEFAULT_GROUP + 1;
+    while (group < groups_.size() && !groups_[group].ids.empty()) group++;
+    if (group == groups_.size()) groups_.emplace_back(Group{});
+    groups_[group] = Group{};
+    groups_[group].polling = mode_ == MonitorMode::Poll;
+    groups_[group].separate = separate;
+    return group;
+}
+
+std::vector<uint32_t> MonitorRegistry::remove_group(uint32_t group) {
+    std::lock_guard guard(lock_);
+    if (group >= groups_.size()) return {};
+    auto ids = groups_[group].ids;
+    for (auto id : ids) {
+        ids_.erase(entries_[id].name);
+        release(id);
+    }
+    return ids;
+}
+
+bool MonitorRegistry::set_group_enabled(uint32_t group_id, bool enabled,
+                                        std::vector<std::pair<uint32_t, int64_t>> &changes) {
+    std::lock_guard guard(lock_);
+    if (group_id >= groups_.size() || groups_[group_id].ids.empty()) return false;
+    auto &group = groups_[group_id];
+    if (group.enabled == enabled) return true;
+    group.enabled = enabled;
+    if (!enabled && !group.polling) {
+        // callbacks have reported everything so far. the values are compared when the group
+        // is enabled again. polled groups compare with their last sample instead
+        for (uint32_t i = 0; i < group.ids.size(); i++) {
+            group.values[i] = read_value(entries_[group.ids[i]]);
+        }
+    } else if (enabled) {
+        read_changes(group, changes);
+    }
+    return true;
+}
+
+std::optional<uint32_t> MonitorRegistry::add(const std::string &name, vpiHandle handle,
+                                             uint32_t group_id) {
+    std::lock_guard guard(lock_);
+    auto it = ids_.find(name);
+    if (it != ids_.end()) return it->second;
+    if (group_id >= groups_.size()) return std::nullopt;
+    auto &group = groups_[group_id];
+    if (mode_ == MonitorMode::Poll) group.polling = true;
+
+    uint32_t id;
+    if (free_ids_.empty()) {
+        id = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back(Entry{});
+    } else {
+        id = free_ids_.back();
+    }
+    auto &entry = entries_[id];
+    entry.handle = handle;
+    entry.width = std::min<uint32_t>(64, static_cast<uint32_t>(vpi_get(vpiSize, handle)));
+    if (!group.polling && !register_callback(id)) {
+        entry = Entry{};
+        // keep the slot for the next monitor
+        if (free_ids_.empty() || free_ids_.back() != id) free_ids_.emplace_back(id);
+        return std::nullopt;
+    }
+    if (!free_ids_.empty() && free_ids_.back() == id) free_ids_.pop_back();
+
+    entry.name = name;
+    entry.group = group_id;
+    entry.index = static_cast<uint32_t>(group.ids.size());
+    group.ids.emplace_back(id);
+    group.values.emplace_back(group.polling ? read_value(entry) : 0);
+    ids_.emplace(name, id);
+    return id;
+}
+
+bool MonitorRegistry::register_callback(uint32_t id) {
+    auto &entry = entries_[id];
+    s_cb_data cb_data;
+    cb_data.reason = cbValueChange;
+    cb_data.cb_rtn = callback_;
+    cb_data.obj = entry.handle;
+    cb_data.time = &monitor_time;
+    cb_data.value = &monitor_value;
+    cb_data.index = 0;
+    cb_data.user_data = reinterpret_cast<PLI_BYTE8 *>(static_cast<uintptr_t>(id));
+    entry.cb_handle = vpi_register_cb(&cb_data);
+    return entry.cb_handle != nullptr;
+}
+
+void MonitorRegistry::remove_callback(Entry &entry) {
+    if (!entry.cb_handle) return;
+    vpi_remove_cb(entry.cb_handle);
+    vpi_free_object(entry.cb_handle);
+    entry.cb_handle = nullptr;
+}
+
+std::optional<uint32_t> MonitorRegistry::remove(const std::string &name) {
+    std::lock_guard guard(lock_);
+    auto it = ids_.find(name);
+    if (it == ids_.end()) return std::nullopt;
+    auto id = it->second;
+    ids_.erase(it);
+    release(id);
+    return id;
+}
+
+void MonitorRegistry::clear() {
+    std::lock_guard guard(lock_);
+    for (auto &entry : entries_) remove_callback(entry);
+    ids_.clear();
+    entries_.clear();
+    free_ids_.clear();
+    groups_.clear();
+    groups_.resize(DEFAULT_GROUP + 1);
+}
+
+void MonitorRegistry::release(uint32_t id) {
+    auto &entry = entries_[id];
+    remove_callback(entry);
+    // swap with the last monitor in the group
+    auto &group = groups_[entry.group];
+    auto last = group.ids.back();
+    group.ids[entry.index] = last;
+    group.values[entry.index] = group.values.back();
+    entries_[last].index = entry.index;
+    group.ids.pop_back();
+    group.values.pop_back();
+    entry = Entry{};
+    free_ids_.emplace_back(id);
+}
+
+std::optional<uint32_t> MonitorRegistry::find(const std::string &name) {
+    std::lock_guard guard(lock_);
+    auto it = ids_.find(name);
+    if (it == ids_.end()) return std::nullopt;
+    return it->second;
+}
+
+std::string MonitorRegistry::get_name(uint32_t id) {
+    std::lock_guard guard(lock_);
+    if (id >= entries_.size()) return {};
+    return entries_[id].name;
+}
+
+size_t MonitorRegistry::size() {
+    std::lock_guard guard(lock_);
+    return ids_.size();
+}
+
+bool MonitorRegistry::is_polling(uint32_t id) {
+    std::lock_guard guard(lock_);
+    if (id >= entries_.size() || entries_[id].name.empty()) return false;
+    return groups_[entries_[id].group].polling;
+}
+
+uint32_t MonitorRegistry::get_report_group(uint32_t id) {
+    std::lock_guard guard(lock_);
+    if (id >= entries_.size() || entries_[id].name.empty()) return DEFAULT_GROUP;
+    auto group = entries_[id].group;
+    return groups_[group].separate ? group : DEFAULT_GROUP;
+}
+
+uint32_t MonitorRegistry::get_width(uint32_t id) {
+    std::lock_guard guard(lock_);
+    if (id >= entries_.size()) return 0;
+    return entries_[id].width;
+}
+
+bool MonitorRegistry::record_change(uint32_t id) {
+    std::lock_guard guard(lock_);
+    if (id >= entries_.size() || entries_[id].name.empty()) return false;
+    auto &group = groups_[entries_[id].group];
+    if (!group.enabled) return false;
+    group.changes++;
+    return true;
+}
+
+void MonitorRegistry::sample(std::vector<std::pair<uint32_t, int64_t>> &changes) {
+    std::lock_guard guard(lock_);
+    for (auto &group : groups_) {
+        // a disabled group reports what changed in the meantime once it's enabled again
+        if (group.ids.empty() || !group.enabled) continue;
+        group.samples++;
+        if (group.polling) {
+            read_changes(group, changes);
+            group.changes += changed_.size();
+        }
+        if (mode_ == MonitorMode::Auto && group.samples >= SAMPLE_WINDOW) update_mode(group);
+    }
+}
+
+void MonitorRegistry::read_changes(Group &group,
+                                   std::vector<std::pair<uint32_t, int64_t>> &changes) {
+    auto size = static_cast<uint32_t>(group.ids.size());
+    current_.resize(size);
+    for (uint32_t i = 0; i < size; i++) {
+        current_[i] = read_value(entries_[group.ids[i]]);
+    }
+    changed_.clear();
+    find_changes(group.values.data(), current_.data(), size, changed_);
+    for (auto i : changed_) {
+        changes.emplace_back(group.ids[i], static_cast<int64_t>(current_[i]));
+    }
+    group.values.swap(current_);
+}
+
+void MonitorRegistry::update_mode(Group &group) {
+    auto rate = static_cast<double>(group.changes) /
+                (static_cast<double>(group.samples) * static_cast<double>(group.ids.size()));
+    group.changes = 0;
+    group.samples = 0;
+    if (!group.polling && rate > POLL_THRESHOLD) {
+        for (uint32_t i = 0; i < group.ids.size(); i++) {
+            auto &entry = entries_[group.ids[i]];
+            remove_callback(entry);
+            group.values[i] = read_value(entry);
+        }
+        group.polling = true;
+    } else if (group.polling && rate < CALLBACK_THRESHOLD) {
+        for (auto id : group.ids) register_callback(id);
+        group.polling = false;
+    }
+}
+
+uint64_t MonitorRegistry::read_value(const Entry &entry) {
+    return read_signal_value(entry.handle, entry.width);
+}
+
+uint32_t MonitorRegistry::get_id(p_cb_data cb_data) {
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(cb_data->user_data));
+}
@@ -0,0 +1,119 @@
+#ifndef KRATOS_RUNTIME_MONITOR_HH
+#define KRATOS_RUNTIME_MONITOR_HH
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "std/vpi_user.h"
+
+// signals that change often are cheaper to sample at clock edges than to watch with one value
+// change callback each. Auto picks the mode per group from the observed change rate
+enum class MonitorMode { Auto, Callback, Poll };
+
+std::optional<MonitorMode> parse_monitor_mode(const std::string &mode);
+
+// appends the indices where the two buffers differ
+void find_changes(const uint64_t *previous, const uint64_t *current, uint32_t size,
+                  std::vector<uint32_t> &changes);
+
+// value change callbacks and polling for monitored signals. monitors are identified by a dense
+// id that is passed to the callback as user data, and freed ids are reused, so adding and
+// removing a monitor doesn't allocate once the pool has grown
+class MonitorRegistry {
+public:
+    using Callback = PLI_INT32 (*)(p_cb_data);
+    // monitors added individually
+    static constexpr uint32_t DEFAULT_GROUP = 0;
+    // samples before a group's mode is reconsidered
+    static constexpr uint32_t SAMPLE_WINDOW = 64;
+    // fraction of a group's signals changing per sample to switch to polling and back
+    static constexpr double POLL_THRESHOLD = 0.25;
+    static constexpr double CALLBACK_THRESHOLD = 0.05;
+
+    explicit MonitorRegistry(Callback callback) : callback_(callback), groups_(1) {}
+    ~MonitorRegistry();
+    MonitorRegistry(const MonitorRegistry &) = delete;
+    MonitorRegistry &operator=(const MonitorRegistry &) = delete;
+
+    void set_mode(MonitorMode mode) { mode_ = mode; }
+    // monitors added together, e.g. a register file, form a group that switches modes as one.
+    // the values of a separate group are reported in their own messages
+    uint32_t add_group(bool separate = false);
+    // removes every monitor in the group and returns their ids
+    std::vector<uint32_t> remove_group(uint32_t group);
+    // a disabled group keeps its monitors but doesn't report changes. enabling it again
+    // appends the signals that changed in the meantime. returns false if the group has no
+    // monitors
+    bool set_group_enabled(uint32_t group, bool enabled,
+                           std::vector<std::pair<uint32_t, int64_t>> &changes);
+    // returns the existing id if the signal is already monitored, or nullopt if the callback
+    // can't be registered
+    std::optional<uint32_t> add(const std::string &name, vpiHandle handle,
+                                uint32_t group = DEFAULT_GROUP);
+    std::optional<uint32_t> remove(const std::string &name);
+    void clear();
+
+    std::optional<uint32_t> find(const std::string &name);
+    // empty if the id is not in use
+    std::string get_name(uint32_t id);
+    size_t size();
+    bool is_polling(uint32_t id);
+    // the monitor's group if it is separate, DEFAULT_GROUP otherwise
+    uint32_t get_report_group(uint32_t id);
+
+    // called from the value change callback. returns false if the change should be ignored
+    bool record_change(uint32_t id);
+    // width the signal is read with, at most 64 bits
+    uint32_t get_width(uint32_t id);
+    // reads every polled signal and appends the ones that changed since the last sample
+    void sample(std::vector<std::pair<uint32_t, int64_t>> &changes);
+
+    static uint32_t get_id(p_cb_data cb_data);
+
+private:
+    struct Entry {
+        vpiHandle handle = nullptr;
+        vpiHandle cb_handle = nullptr;
+        std::string name;
+        uint32_t width = 0;
+        uint32_t group = 0;
+        // index into the group's ids and values
+        uint32_t index = 0;
+    };
+
+    struct Group {
+        std::vector<uint32_t> ids;
+        // values from the last sample when polling, or from when the group was disabled
+        std::vector<uint64_t> values;
+        bool polling = false;
+        bool separate = false;
+        bool enabled = true;
+        uint64_t changes = 0;
+        uint32_t samples = 0;
+    };
+
+    bool register_callback(uint32_t id);
+    void remove_callback(Entry &entry);
+    void release(uint32_t id);
+    void update_mode(Group &group);
+    // reads every signal in the group and appends the ones that changed since the last read
+    void read_changes(Group &group, std::vector<std::pair<uint32_t, int64_t>> &changes);
+    static uint64_t read_value(const Entry &entry);
+
+    Callback callback_;
+    MonitorMode mode_ = MonitorMode::Auto;
+    std::mutex lock_;
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> free_ids_;
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::vector<Group> groups_;
+    // scratch buffers for sampling
+    std::vector<uint64_t> current_;
+    std::vector<uint32_t> changed_;
+};
+
+#endif  // KRATOS_RUNTIME_MONITOR_HH
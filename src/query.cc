@@ -0,0 +1,130 @@
+#include "query.hh"
+
+#include <sqlite3.h>
+
+#include <stdexcept>
+
+#include "fmt/format.h"
+
+PreparedStatement::PreparedStatement(sqlite3 *db, std::string name, const std::string &sql) {
+    stat_.name = std::move(name);
+    auto r = sqlite3_prepare_v3(db, sql.c_str(), static_cast<int>(sql.size()),
+                                SQLITE_PREPARE_PERSISTENT, &stmt_, nullptr);
+    if (r != SQLITE_OK) {
+        throw std::runtime_error(
+            fmt::format("Unable to prepare {0}: {1}", stat_.name, sqlite3_errmsg(db)));
+    }
+}
+
+PreparedStatement::~PreparedStatement() { sqlite3_finalize(stmt_); }
+
+QueryStat PreparedStatement::stat() {
+    std::lock_guard guard(lock_);
+    return stat_;
+}
+
+Query::Query(PreparedStatement &stmt)
+    : stmt_(stmt), guard_(stmt.lock_), start_(std::chrono::steady_clock::now()) {
+    sqlite3_reset(stmt_.stmt_);
+    sqlite3_clear_bindings(stmt_.stmt_);
+}
+
+Query::~Query() {
+    sqlite3_reset(stmt_.stmt_);
+    auto end = std::chrono::steady_clock::now();
+    stmt_.stat_.add(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count()));
+}
+
+Query &Query::bind(int index, const std::string &value) {
+    sqlite3_bind_text(stmt_.stmt_, index, value.c_str(), static_cast<int>(value.size()),
+                      SQLITE_TRANSIENT);
+    return *this;
+}
+
+Query &Query::bind(int index, int64_t value) {
+    sqlite3_bind_int64(stmt_.stmt_, index, value);
+    return *this;
+}
+
+bool Query::next() {
+    auto r = sqlite3_step(stmt_.stmt_);
+    if (r == SQLITE_ROW) return true;
+    if (r == SQLITE_DONE) return false;
+    throw std::runtime_error(fmt::format("Unable to execute {0}: {1}", stmt_.stat_.name,
+                                         sqlite3_errmsg(sqlite3_db_handle(stmt_.stmt_))));
+}
+
+std::string Query::text(int column) const {
+    auto const *str = sqlite3_column_text(stmt_.stmt_, column);
+    if (!str) return "";
+    return std::string(reinterpret_cast<const char *>(str),
+                       sqlite3_column_bytes(stmt_.stmt_, column));
+}
+
+int64_t Query::integer(int column) const { return sqlite3_column_int64(stmt_.stmt_, column); }
+
+std::vector<QueryStat> LookupStats::stats() {
+    std::lock_guard guard(lock_);
+    std::vector<QueryStat> result;
+    result.reserve(stats_.size());
+    for (auto const &iter : stats_) result.emplace_back(iter.second);
+    return result;
+}
+
+LookupTimer::LookupTimer(LookupStats &stats, const char *name)
+    : stats_(stats), name_(name), start_(std::chrono::steady_clock::now()) {}
+
+LookupTimer::~LookupTimer() {
+    auto end = std::chrono::steady_clock::now();
+    auto ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count());
+    std::lock_guard guard(stats_.lock_);
+    auto it = stats_.stats_.find(name_);
+    if (it == stats_.stats_.end()) it = stats_.stats_.emplace(name_, QueryStat{name_}).first;
+    it->second.add(ns);
+}
+
+SQLiteConnection::SQLiteConnection(const std::string &filename) {
+    auto r = sqlite3_open_v2(filename.c_str(), &db_, SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX,
+                             nullptr);
+    if (r != SQLITE_OK) {
+        std::string error = db_ ? sqlite3_errmsg(db_) : "out of memory";
+        sqlite3_close(db_);
+        throw std::runtime_error(fmt::format("Unable to open {0}: {1}", filename, error));
+    }
+}
+
+SQLiteConnection::~SQLiteConnection() {
+    // statements have to be finalized before the connection is closed
+    statements_.clear();
+    sqlite3_close(db_);
+}
+
+PreparedStatement &SQLiteConnection::statement(const std::string &name, const std::string &sql) {
+    std::lock_guard guard(lock_);
+    if (statements_.find(name) == statements_.end()) {
+        statements_.emplace(name, std::make_unique<PreparedStatement>(db_, name, sql));
+    }
+    return *statements_.at(name);
+}
+
+std::vector<QueryStat> SQLiteConnection::stats() {
+    std::lock_guard guard(lock_);
+    std::vector<QueryStat> result;
+    result.reserve(statements_.size());
+    for (auto const &iter : statements_) {
+        result.emplace_back(iter.second->stat());
+    }
+    return result;
+}
+
+void SQLiteConnection::exec(const std::string &sql) {
+    char *error = nullptr;
+    auto r = sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &error);
+    if (r != SQLITE_OK) {
+        std::string message = error ? error : "";
+        sqlite3_free(error);
+        throw std::runtime_error(fmt::format("Unable to execute {0}: {1}", sql, message));
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef KRATOS_RUNTIME_QUERY_HH
+#define KRATOS_RUNTIME_QUERY_HH
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+struct QueryStat {
+    std::string name;
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+
+    void add(uint64_t ns) {
+        count++;
+        total_ns += ns;
+        if (ns > max_ns) max_ns = ns;
+    }
+};
+
+// a statement is prepared once and re-bound for every query
+class PreparedStatement {
+public:
+    PreparedStatement(sqlite3 *db, std::string name, const std::string &sql);
+    ~PreparedStatement();
+    PreparedStatement(const PreparedStatement &) = delete;
+    PreparedStatement &operator=(const PreparedStatement &) = delete;
+
+    [[nodiscard]] QueryStat stat();
+
+private:
+    sqlite3_stmt *stmt_ = nullptr;
+    std::mutex lock_;
+    QueryStat stat_;
+
+    friend class Query;
+};
+
+// RAII wrapper for a single execution of a prepared statement. the statement is locked
+// while the query is alive
+class Query {
+public:
+    explicit Query(PreparedStatement &stmt);
+    ~Query();
+    Query(const Query &) = delete;
+    Query &operator=(const Query &) = delete;
+
+    // parameter index starts from 1, as in SQLite
+    Query &bind(int index, const std::string &value);
+    Query &bind(int index, int64_t value);
+
+    bool next();
+    [[nodiscard]] std::string text(int column) const;
+    [[nodiscard]] int64_t integer(int column) const;
+
+private:
+    PreparedStatement &stmt_;
+    std::lock_guard<std::mutex> guard_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// timing of lookups that don't run a statement, e.g. the ones served from memory
+class LookupStats {
+public:
+    // sorted by name
+    [[nodiscard]] std::vector<QueryStat> stats();
+
+private:
+    std::mutex lock_;
+    std::map<std::string, QueryStat> stats_;
+
+    friend class LookupTimer;
+};
+
+// times the enclosing scope as one lookup of the name
+class LookupTimer {
+public:
+    LookupTimer(LookupStats &stats, const char *name);
+    ~LookupTimer();
+    LookupTimer(const LookupTimer &) = delete;
+    LookupTimer &operator=(const LookupTimer &) = delete;
+
+private:
+    LookupStats &stats_;
+    const char *name_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// connection that owns all the prepared statements
+class SQLiteConnection {
+public:
+    // opens the file read-only
+    explicit SQLiteConnection(const std::string &filename);
+    explicit SQLiteConnection(sqlite3 *db) : db_(db) {}
+    ~SQLiteConnection();
+    SQLiteConnection(const SQLiteConnection &) = delete;
+    SQLiteConnection &operator=(const SQLiteConnection &) = delete;
+
+    PreparedStatement &statement(const std::string &name, const std::string &sql);
+    std::vector<QueryStat> stats();
+    void exec(const std::string &sql);
+
+    [[nodiscard]] sqlite3 *handle() const { return db_; }
+
+private:
+    sqlite3 *db_ = nullptr;
+    std::mutex lock_;
+    std::map<std::string, std::unique_ptr<PreparedStatement>> statements_;
+};
+
+#endif  // KRATOS_RUNTIME_QUERY_HH
@@ -0,0 +1,619 @@
+#include "recorder.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+constexpr char RECORD_MAGIC[8] = {'K', 'R', 'A', 'T', 'O', 'S', 'W', 'V'};
+constexpr uint32_t RECORD_VERSION = 3;
+
+struct RecordHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_size;
+};
+
+// every block in the file starts with this header. the summary follows the changes
+struct BlockHeader {
+    uint32_t size;
+    uint32_t num_changes;
+    uint64_t begin;
+    uint64_t end;
+    uint32_t summary_size;
+    uint32_t reserved;
+};
+
+static void write_varint(std::string &data, uint64_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7u;
+    }
+    data.push_back(static_cast<char>(value));
+}
+
+static bool read_varint(const std::string &data, uint64_t &pos, uint64_t &value) {
+    value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size()) return false;
+        auto byte = static_cast<uint8_t>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1u) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1u) ^ -static_cast<int64_t>(value & 1u);
+}
+
+std::string encode_change_block(const ChangeBlock &block) {
+    std::string data;
+    // about 3 bytes per change
+    data.reserve(block.changes.size() * 3 + 16);
+    write_varint(data, block.first_signal);
+    write_varint(data, block.names.size());
+    for (uint64_t i = 0; i < block.names.size(); i++) {
+        write_varint(data, block.names[i].size());
+        data.append(block.names[i]);
+        write_varint(data, block.widths[i]);
+    }
+    write_varint(data, block.changes.size());
+    uint64_t time = 0;
+    std::unordered_map<uint32_t, int64_t> values;
+    for (auto const &change : block.changes) {
+        write_varint(data, change.time - time);
+        write_varint(data, change.signal);
+        auto &value = values[change.signal];
+        write_varint(data, zigzag(static_cast<int64_t>(static_cast<uint64_t>(change.value) -
+                                                       static_cast<uint64_t>(value))));
+        time = change.time;
+        value = change.value;
+    }
+    return data;
+}
+
+std::optional<ChangeBlock> decode_change_block(const std::string &data) {
+    ChangeBlock block;
+    uint64_t pos = 0;
+    uint64_t value;
+    if (!read_varint(data, pos, value)) return std::nullopt;
+    block.first_signal = static_cast<uint32_t>(value);
+    uint64_t num_names;
+    if (!read_varint(data, pos, num_names) || num_names > data.size()) return std::nullopt;
+    block.names.reserve(num_names);
+    block.widths.reserve(num_names);
+    for (uint64_t i = 0; i < num_names; i++) {
+        uint64_t size, width;
+        if (!read_varint(data, pos, size) || size > data.size() - pos) return std::nullopt;
+        block.names.emplace_back(data.substr(pos, size));
+        pos += size;
+        if (!read_varint(data, pos, width) || width > 64) return std::nullopt;
+        block.widths.emplace_back(static_cast<uint32_t>(width));
+    }
+    uint64_t num_changes;
+    if (!read_varint(data, pos, num_changes) || num_changes > data.size()) return std::nullopt;
+    block.changes.reserve(num_changes);
+    uint64_t time = 0;
+    std::unordered_map<uint32_t, int64_t> values;
+    for (uint64_t i = 0; i < num_changes; i++) {
+        uint64_t delta, signal, diff;
+        if (!read_varint(data, pos, delta) || !read_varint(data, pos, signal) ||
+            !read_varint(data, pos, diff))
+            return std::nullopt;
+        time += delta;
+        auto &v = values[static_cast<uint32_t>(signal)];
+        // wraps around like the subtraction in encode_change_block
+        v = static_cast<int64_t>(static_cast<uint64_t>(v) +
+                                 static_cast<uint64_t>(unzigzag(diff)));
+        block.changes.emplace_back(ValueChange{time, static_cast<uint32_t>(signal), v});
+    }
+    return block;
+}
+
+std::string encode_block_summary(const std::vector<SignalSummary> &summaries) {
+    std::string data;
+    write_varint(data, summaries.size());
+    for (auto const &summary : summaries) {
+        write_varint(data, summary.signal);
+        for (uint32_t level = 0; level < SummaryPyramid::FINE_LEVELS; level++) {
+            auto shift = SummaryPyramid::get_shift(level);
+            auto const &buckets = summary.levels[level];
+            write_varint(data, buckets.size());
+            // buckets are stored by their index in the level
+            uint64_t index = 0;
+            for (auto const &bucket : buckets) {
+                write_varint(data, (bucket.time >> shift) - index);
+                index = bucket.time >> shift;
+                write_varint(data, zigzag(bucket.min));
+                write_varint(data, zigzag(bucket.max));
+                write_varint(data, bucket.count);
+                write_varint(data, zigzag(bucket.last));
+            }
+        }
+    }
+    return data;
+}
+
+std::optional<std::vector<SignalSummary>> decode_block_summary(const std::string &data) {
+    std::vector<SignalSummary> summaries;
+    uint64_t pos = 0;
+    uint64_t num_summaries;
+    if (!read_varint(data, pos, num_summaries) || num_summaries > data.size()) return std::nullopt;
+    summaries.reserve(num_summaries);
+    for (uint64_t i = 0; i < num_summaries; i++) {
+        uint64_t signal;
+        if (!read_varint(data, pos, signal)) return std::nullopt;
+        auto &summary = summaries.emplace_back(SignalSummary{static_cast<uint32_t>(signal), {}});
+        for (uint32_t level = 0; level < SummaryPyramid::FINE_LEVELS; level++) {
+            auto shift = SummaryPyramid::get_shift(level);
+            uint64_t num_buckets;
+            if (!read_varint(data, pos, num_buckets) || num_buckets > data.size())
+                return std::nullopt;
+            auto &buckets = summary.levels[level];
+            buckets.reserve(num_buckets);
+            uint64_t index = 0;
+            for (uint64_t j = 0; j < num_buckets; j++) {
+                uint64_t delta, min, max, count, last;
+                if (!read_varint(data, pos, delta) || !read_varint(data, pos, min) ||
+                    !read_varint(data, pos, max) || !read_varint(data, pos, count) ||
+                    !read_varint(data, pos, last))
+                    return std::nullopt;
+                index += delta;
+                buckets.emplace_back(SummaryBucket{index << shift, uint64_t(1) << shift,
+                                                   unzigzag(min), unzigzag(max), count,
+                                                   unzigzag(last)});
+            }
+        }
+    }
+    return summaries;
+}
+
+void merge_bucket(std::vector<SummaryBucket> &buckets, const SummaryBucket &bucket) {
+    if (buckets.empty() || buckets.back().time != bucket.time) {
+        buckets.emplace_back(bucket);
+        return;
+    }
+    auto &last = buckets.back();
+    last.min = std::min(last.min, bucket.min);
+    last.max = std::max(last.max, bucket.max);
+    last.count += bucket.count;
+    last.last = bucket.last;
+}
+
+void SummaryPyramid::add(uint64_t time, int64_t value) {
+    for (uint32_t level = 0; level < NUM_LEVELS; level++) {
+        auto shift = get_shift(level);
+        auto start = time >> shift << shift;
+        merge_bucket(levels_[level],
+                     SummaryBucket{start, uint64_t(1) << shift, value, value, 1, value});
+    }
+}
+
+void SummaryPyramid::add_bucket(const SummaryBucket &bucket) {
+    for (uint32_t level = FINE_LEVELS; level < NUM_LEVELS; level++) {
+        auto shift = get_shift(level);
+        auto start = bucket.time >> shift << shift;
+        merge_bucket(levels_[level], SummaryBucket{start, uint64_t(1) << shift, bucket.min,
+                                                   bucket.max, bucket.count, bucket.last});
+    }
+}
+
+SummaryPyramid::FineBuckets SummaryPyramid::take_fine_buckets() {
+    FineBuckets result;
+    for (uint32_t level = 0; level < FINE_LEVELS; level++) result[level].swap(levels_[level]);
+    return result;
+}
+
+SummaryPyramid::FineBuckets SummaryPyramid::get_fine_buckets() const {
+    FineBuckets result;
+    for (uint32_t level = 0; level < FINE_LEVELS; level++) result[level] = levels_[level];
+    return result;
+}
+
+std::optional<uint32_t> SummaryPyramid::get_level(uint64_t width) {
+    if (width < (uint64_t(1) << BASE_SHIFT)) return std::nullopt;
+    // the finest level whose buckets are at least as wide, so that no more buckets than
+    // requested are returned
+    for (uint32_t level = 0; level < NUM_LEVELS; level++) {
+        if ((uint64_t(1) << get_shift(level)) >= width) return level;
+    }
+    return NUM_LEVELS - 1;
+}
+
+std::vector<SummaryBucket> SummaryPyramid::get_buckets(uint32_t level, uint64_t begin,
+                                                       uint64_t end) const {
+    std::vector<SummaryBucket> result;
+    if (level >= NUM_LEVELS) return result;
+    auto const &buckets = levels_[level];
+    auto it = std::lower_bound(buckets.begin(), buckets.end(), begin,
+                               [](const SummaryBucket &bucket, uint64_t time) {
+                                   return bucket.time + (bucket.width - 1) < time;
+                               });
+    for (; it != buckets.end() && it->time <= end; it++) {
+        result.emplace_back(*it);
+    }
+    return result;
+}
+
+WaveformRecorder::~WaveformRecorder() {
+    {
+        std::lock_guard guard(lock_);
+        seal();
+        stop_ = true;
+    }
+    queue_cond_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    if (fd_ >= 0) ::close(fd_);
+}
+
+bool WaveformRecorder::open(const std::string &filename) {
+    fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) return false;
+    RecordHeader header{};
+    std::memcpy(header.magic, RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    header.version = RECORD_VERSION;
+    header.block_size = BLOCK_SIZE;
+    if (::pwrite(fd_, &header, sizeof(header), 0) != sizeof(header)) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    file_size_ = sizeof(header);
+    thread_ = std::thread([this]() { run(); });
+    return true;
+}
+
+bool WaveformRecorder::load(const std::string &filename) {
+    fd_ = ::open(filename.c_str(), O_RDONLY);
+    if (fd_ < 0) return false;
+    RecordHeader header{};
+    if (::pread(fd_, &header, sizeof(header), 0) != sizeof(header) ||
+        std::memcmp(header.magic, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0 ||
+        header.version != RECORD_VERSION) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    read_only_ = true;
+    // the index and the coarse summaries are rebuilt from the blocks, which are only kept in
+    // memory while recording
+    uint64_t offset = sizeof(header);
+    BlockHeader block_header{};
+    while (::pread(fd_, &block_header, sizeof(block_header), static_cast<off_t>(offset)) ==
+           sizeof(block_header)) {
+        std::string data(block_header.size + block_header.summary_size, '\0');
+        if (::pread(fd_, data.data(), data.size(),
+                    static_cast<off_t>(offset + sizeof(block_header))) !=
+            static_cast<ssize_t>(data.size()))
+            break;
+        auto block = decode_change_block(data.substr(0, block_header.size));
+        auto summaries = decode_block_summary(data.substr(block_header.size));
+        if (!block || !summaries || block->first_signal != signals_.size()) break;
+        for (uint64_t i = 0; i < block->names.size(); i++) {
+            signals_.emplace(block->names[i], static_cast<uint32_t>(signals_.size()));
+            widths_.emplace_back(block->widths[i]);
+            signal_blocks_.emplace_back();
+            summaries_.emplace_back();
+        }
+        auto index = static_cast<uint32_t>(index_.size());
+        bool valid = true;
+        for (auto const &change : block->changes) {
+            if (change.signal >= signals_.size()) {
+                valid = false;
+                break;
+            }
+            auto &blocks = signal_blocks_[change.signal];
+            if (blocks.empty() || blocks.back() != index) blocks.emplace_back(index);
+        }
+        for (auto const &summary : *summaries) {
+            if (summary.signal >= signals_.size()) {
+                valid = false;
+                break;
+            }
+            for (auto const &bucket : summary.levels.back()) {
+                summaries_[summary.signal].add_bucket(bucket);
+            }
+        }
+        if (!valid) break;
+        block_times_.emplace_back(block_header.begin, block_header.end);
+        index_.emplace_back(BlockInfo{offset + sizeof(block_header), block_header.size,
+                                      block_header.summary_size, block_header.begin,
+                                      block_header.end});
+        offset += sizeof(block_header) + data.size();
+    }
+    file_size_ = offset;
+    return true;
+}
+
+void WaveformRecorder::record(const std::string &name, uint64_t time, int64_t value,
+                              uint32_t width) {
+    std::lock_guard guard(lock_);
+    if (read_only_) return;
+    uint32_t signal;
+    auto it = signals_.find(name);
+    if (it == signals_.end()) {
+        signal = static_cast<uint32_t>(signals_.size());
+        signals_.emplace(name, signal);
+        widths_.emplace_back(width);
+        signal_blocks_.emplace_back();
+        summaries_.emplace_back();
+        current_.names.emplace_back(name);
+        current_.widths.emplace_back(width);
+    } else {
+        signal = it->second;
+    }
+    auto block = static_cast<uint32_t>(index_.size() + queue_.size());
+    if (current_.changes.empty()) block_times_.emplace_back(time, time);
+    block_times_.back().second = time;
+    auto &blocks = signal_blocks_[signal];
+    if (blocks.empty() || blocks.back() != block) {
+        blocks.emplace_back(block);
+        current_.summaries.emplace_back(SignalSummary{signal, {}});
+    }
+    current_.changes.emplace_back(ValueChange{time, signal, value});
+    summaries_[signal].add(time, value);
+    if (current_.changes.size() >= BLOCK_SIZE) seal();
+}
+
+// lock_ has to be held
+void WaveformRecorder::seal() {
+    if (current_.changes.empty()) return;
+    for (auto &summary : current_.summaries) {
+        summary.levels = summaries_[summary.signal].take_fine_buckets();
+    }
+    queue_.emplace_back(std::move(current_));
+    current_ = ChangeBlock{};
+    current_.first_signal = static_cast<uint32_t>(signals_.size());
+    queue_cond_.notify_one();
+}
+
+void WaveformRecorder::flush() {
+    std::unique_lock lock(lock_);
+    seal();
+    idle_cond_.wait(lock, [this]() { return queue_.empty(); });
+}
+
+void WaveformRecorder::run() {
+    while (true) {
+        const ChangeBlock *block;
+        {
+            std::unique_lock lock(lock_);
+            queue_cond_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) break;
+            // the block stays queued so that queries can read it while it's written
+            block = &queue_.front();
+        }
+        auto data = encode_change_block(*block);
+        auto summary = encode_block_summary(block->summaries);
+        BlockHeader header{static_cast<uint32_t>(data.size()),
+                           static_cast<uint32_t>(block->changes.size()),
+                           block->changes.front().time,
+                           block->changes.back().time,
+                           static_cast<uint32_t>(summary.size()),
+                           0};
+        data.insert(0, reinterpret_cast<const char *>(&header), sizeof(header));
+        data.append(summary);
+        auto offset = file_size_;
+        if (::pwrite(fd_, data.data(), data.size(), static_cast<off_t>(offset)) !=
+            static_cast<ssize_t>(data.size())) {
+            std::cerr << "ERROR: failed to write recorded values" << std::endl;
+            header.size = 0;
+            header.summary_size = 0;
+        }
+        file_size_ += data.size();
+        {
+            std::lock_guard guard(lock_);
+            index_.emplace_back(BlockInfo{offset + sizeof(header), header.size,
+                                          header.summary_size, header.begin, header.end});
+            queue_.pop_front();
+        }
+        idle_cond_.notify_all();
+    }
+}
+
+std::optional<ChangeBlock> WaveformRecorder::read_block(uint32_t block) {
+    BlockInfo info{};
+    {
+        std::lock_guard guard(lock_);
+        if (block >= index_.size()) {
+            auto pos = block - index_.size();
+            if (pos < queue_.size()) return queue_[pos];
+            return current_;
+        }
+        info = index_[block];
+    }
+    if (info.size == 0) return std::nullopt;
+    std::string data(info.size, '\0');
+    if (::pread(fd_, data.data(), info.size, static_cast<off_t>(info.offset)) !=
+        static_cast<ssize_t>(info.size))
+        return std::nullopt;
+    return decode_change_block(data);
+}
+
+std::vector<SummaryBucket> WaveformRecorder::read_buckets(uint32_t block, uint32_t signal,
+                                                         uint32_t level) {
+    BlockInfo info{};
+    {
+        std::lock_guard guard(lock_);
+        if (block >= index_.size()) {
+            auto pos = block - index_.size();
+            if (pos < queue_.size()) {
+                for (auto const &summary : queue_[pos].summaries) {
+                    if (summary.signal == signal) return summary.levels[level];
+                }
+                return {};
+            }
+            // the current block's buckets are still in the pyramid
+            return summaries_[signal].get_buckets(level, 0, std::numeric_limits<uint64_t>::max());
+        }
+        info = index_[block];
+    }
+    if (info.summary_size == 0) return {};
+    std::string data(info.summary_size, '\0');
+    if (::pread(fd_, data.data(), info.summary_size, static_cast<off_t>(info.offset + info.size)) !=
+        static_cast<ssize_t>(info.summary_size))
+        return {};
+    auto summaries = decode_block_summary(data);
+    if (!summaries) return {};
+    for (auto &summary : *summaries) {
+        if (summary.signal == signal) return std::move(summary.levels[level]);
+    }
+    return {};
+}
+
+std::vector<uint32_t> WaveformRecorder::find_blocks(uint32_t signal, uint64_t begin,
+                                                    uint64_t end) {
+    std::vector<uint32_t> result;
+    std::lock_guard guard(lock_);
+    auto const &blocks = signal_blocks_[signal];
+    // block times are non-decreasing, so the first block that ends at or after begin is found
+    // with a binary search
+    auto it = std::lower_bound(blocks.begin(), blocks.end(), begin,
+                               [this](uint32_t block, uint64_t time) {
+                                   return block_times_[block].second < time;
+                               });
+    for (; it != blocks.end() && block_times_[*it].first <= end; it++) {
+        result.emplace_back(*it);
+    }
+    return result;
+}
+
+bool WaveformRecorder::has_signal(const std::string &name) {
+    std::lock_guard guard(lock_);
+    return signals_.find(name) != signals_.end();
+}
+
+uint32_t WaveformRecorder::get_width(const std::string &name) {
+    std::lock_guard guard(lock_);
+    auto it = signals_.find(name);
+    if (it == signals_.end()) return 0;
+    return widths_[it->second];
+}
+
+std::optional<uint64_t> WaveformRecorder::find_time(uint64_t time) {
+    uint32_t index;
+    {
+        std::lock_guard guard(lock_);
+        // the first block that ends at or after the time
+        auto it = std::partition_point(
+            block_times_.begin(), block_times_.end(),
+            [time](const std::pair<uint64_t, uint64_t> &range) { return range.second < time; });
+        if (it == block_times_.end()) return std::nullopt;
+        if (it->first >= time) return it->first;
+        index = static_cast<uint32_t>(it - block_times_.begin());
+    }
+    auto block = read_block(index);
+    if (!block) return std::nullopt;
+    for (auto const &change : block->changes) {
+        if (change.time >= time) return change.time;
+    }
+    return std::nullopt;
+}
+
+std::optional<int64_t> WaveformRecorder::get_value(const std::string &name, uint64_t time) {
+    std::vector<uint32_t> blocks;
+    uint32_t signal;
+    {
+        std::lock_guard guard(lock_);
+        auto it = signals_.find(name);
+        if (it == signals_.end()) return std::nullopt;
+        signal = it->second;
+        auto const &signal_blocks = signal_blocks_[signal];
+        auto end = std::upper_bound(signal_blocks.begin(), signal_blocks.end(), time,
+                                    [this](uint64_t t, uint32_t block) {
+                                        return t < block_times_[block].first;
+                                    });
+        // the last block that starts before the time may only have later changes of the
+        // signal, in which case the one before has the value
+        auto count = std::min<int64_t>(2, end - signal_blocks.begin());
+        blocks.assign(end - count, end);
+    }
+    for (auto it = blocks.rbegin(); it != blocks.rend(); it++) {
+        auto block = read_block(*it);
+        if (!block) continue;
+        std::optional<int64_t> value;
+        for (auto const &change : block->changes) {
+            if (change.time > time) break;
+            if (change.signal == signal) value = change.value;
+        }
+        if (value) return value;
+    }
+    return std::nullopt;
+}
+
+std::vector<std::pair<uint64_t, int64_t>> WaveformRecorder::get_changes(const std::string &name,
+                                                                        uint64_t begin,
+                                                                        uint64_t end) {
+    std::vector<std::pair<uint64_t, int64_t>> result;
+    uint32_t signal;
+    {
+        std::lock_guard guard(lock_);
+        auto it = signals_.find(name);
+        if (it == signals_.end()) return result;
+        signal = it->second;
+    }
+    for (auto index : find_blocks(signal, begin, end)) {
+        auto block = read_block(index);
+        if (!block) continue;
+        for (auto const &change : block->changes) {
+            if (change.signal != signal || change.time < begin) continue;
+            if (change.time > end) break;
+            result.emplace_back(change.time, change.value);
+        }
+    }
+    return result;
+}
+
+std::vector<SummaryBucket> WaveformRecorder::get_summary(const std::string &name, uint64_t begin,
+                                                         uint64_t end, uint32_t max_buckets) {
+    if (end < begin || max_buckets == 0) return {};
+    auto range = end - begin;
+    auto width = range / max_buckets + (range % max_buckets != 0 || range == 0 ? 1 : 0);
+    auto level = SummaryPyramid::get_level(width);
+    if (level) {
+        uint32_t signal;
+        {
+            std::lock_guard guard(lock_);
+            auto it = signals_.find(name);
+            if (it == signals_.end()) return {};
+            signal = it->second;
+            if (*level >= SummaryPyramid::FINE_LEVELS) {
+                return summaries_[signal].get_buckets(*level, begin, end);
+            }
+        }
+        // fine buckets are stored with the blocks. a bucket can start before the first change
+        // in the range, and parts of it can be in consecutive blocks
+        auto shift = SummaryPyramid::get_shift(*level);
+        std::vector<SummaryBucket> result;
+        for (auto index : find_blocks(signal, begin >> shift << shift, end)) {
+            for (auto const &bucket : read_buckets(index, signal, *level)) {
+                if (bucket.time + (bucket.width - 1) < begin || bucket.time > end) continue;
+                merge_bucket(result, bucket);
+            }
+        }
+        return result;
+    }
+    // finer than the pyramid, so the window is small enough to summarize the changes directly
+    std::vector<SummaryBucket> result;
+    for (auto const &[time, value] : get_changes(name, begin, end)) {
+        auto start = begin + (time - begin) / width * width;
+        if (result.empty() || result.back().time != start) {
+            result.emplace_back(SummaryBucket{start, width, value, value, 1, value});
+            continue;
+        }
+        auto &bucket = result.back();
+        bucket.min = std::min(bucket.min, value);
+        bucket.max = std::max(bucket.max, value);
+        bucket.count++;
+        bucket.last = value;
+    }
+    return result;
+}
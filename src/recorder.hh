@@ -0,0 +1,181 @@
+#ifndef KRATOS_RUNTIME_RECORDER_HH
+#define KRATOS_RUNTIME_RECORDER_HH
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct ValueChange {
+    uint64_t time;
+    uint32_t signal;
+    int64_t value;
+};
+
+struct SummaryBucket {
+    uint64_t time;
+    uint64_t width;
+    int64_t min;
+    int64_t max;
+    // number of transitions in the bucket
+    uint64_t count;
+    int64_t last;
+};
+
+// summaries of a signal's changes at several time resolutions, so that overview queries are
+// answered in O(buckets shown) instead of O(changes). only buckets with changes are stored
+class SummaryPyramid {
+public:
+    // the finest level has buckets of 2^BASE_SHIFT time units and every level is 2^LEVEL_SHIFT
+    // times coarser than the one below
+    static constexpr uint32_t BASE_SHIFT = 12;
+    static constexpr uint32_t LEVEL_SHIFT = 4;
+    static constexpr uint32_t NUM_LEVELS = (64 - BASE_SHIFT) / LEVEL_SHIFT;
+    // the fine levels grow with the number of changes, so the recorder moves them into the
+    // block they were filled in. the coarse levels, 2^20 time units and wider, stay in memory
+    static constexpr uint32_t FINE_LEVELS = 2;
+    using FineBuckets = std::array<std::vector<SummaryBucket>, FINE_LEVELS>;
+
+    SummaryPyramid() : levels_(NUM_LEVELS) {}
+
+    // times have to be non-decreasing
+    void add(uint64_t time, int64_t value);
+    // adds a bucket of the coarsest fine level to the coarse levels, e.g. when the fine levels
+    // are read back from a recording
+    void add_bucket(const SummaryBucket &bucket);
+    // moves out the buckets of the fine levels. a bucket that gets more changes afterwards is
+    // started again, so the parts have to be merged when they are read
+    FineBuckets take_fine_buckets();
+    [[nodiscard]] FineBuckets get_fine_buckets() const;
+    // nullopt if the width is finer than the finest level
+    static std::optional<uint32_t> get_level(uint64_t width);
+    static constexpr uint32_t get_shift(uint32_t level) {
+        return BASE_SHIFT + level * LEVEL_SHIFT;
+    }
+    // buckets of the level that overlap [begin, end]
+    std::vector<SummaryBucket> get_buckets(uint32_t level, uint64_t begin, uint64_t end) const;
+
+private:
+    std::vector<std::vector<SummaryBucket>> levels_;
+};
+
+// merges the bucket into the last one if they start at the same time
+void merge_bucket(std::vector<SummaryBucket> &buckets, const SummaryBucket &bucket);
+
+// fine summary buckets of a signal that changed in a block
+struct SignalSummary {
+    uint32_t signal;
+    SummaryPyramid::FineBuckets levels;
+};
+
+// changes are stored in blocks with the names of the signals first seen in the block, so
+// every block can be decoded on its own
+struct ChangeBlock {
+    uint32_t first_signal = 0;
+    std::vector<std::string> names;
+    // width of every named signal, at most 64 bits
+    std::vector<uint32_t> widths;
+    std::vector<ValueChange> changes;
+    // one entry per signal, in the order they first change in the block
+    std::vector<SignalSummary> summaries;
+};
+
+// times and values are stored as varint deltas, since most changes are close in time and
+// value to the previous change of the same signal
+std::string encode_change_block(const ChangeBlock &block);
+std::optional<ChangeBlock> decode_change_block(const std::string &data);
+// the summaries are stored after the changes, so they can be read without the changes
+std::string encode_block_summary(const std::vector<SignalSummary> &summaries);
+std::optional<std::vector<SignalSummary>> decode_block_summary(const std::string &data);
+
+// records value changes of monitored signals into a compact change log, so that their history
+// can be queried without dumping the whole design. the simulator thread only appends to the
+// current block; full blocks are encoded and written on a background thread
+class WaveformRecorder {
+public:
+    static constexpr uint32_t BLOCK_SIZE = 4096;
+
+    WaveformRecorder() = default;
+    // all the recorded changes are written before the thread exits
+    ~WaveformRecorder();
+    WaveformRecorder(const WaveformRecorder &) = delete;
+    WaveformRecorder &operator=(const WaveformRecorder &) = delete;
+
+    // truncates the file. returns false if it can't be opened
+    bool open(const std::string &filename);
+    // reads a finished recording for queries. nothing can be recorded into it. a block that
+    // was cut off, e.g. by a crash, ends the recording
+    bool load(const std::string &filename);
+    // times have to be non-decreasing. the width is only stored the first time a signal is
+    // recorded
+    void record(const std::string &name, uint64_t time, int64_t value, uint32_t width);
+    // blocks until every recorded change is written
+    void flush();
+
+    bool has_signal(const std::string &name);
+    // 0 if the signal isn't recorded
+    uint32_t get_width(const std::string &name);
+    // the first time at or after the given time that has a change of any signal
+    std::optional<uint64_t> find_time(uint64_t time);
+    // value of the signal at the time, nullopt if it has no change recorded before that
+    std::optional<int64_t> get_value(const std::string &name, uint64_t time);
+    // changes in [begin, end]
+    std::vector<std::pair<uint64_t, int64_t>> get_changes(const std::string &name, uint64_t begin,
+                                                          uint64_t end);
+    // at most about max_buckets buckets covering [begin, end]. only buckets with changes are
+    // returned
+    std::vector<SummaryBucket> get_summary(const std::string &name, uint64_t begin, uint64_t end,
+                                           uint32_t max_buckets);
+
+private:
+    struct BlockInfo {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t summary_size;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    void seal();
+    void run();
+    // lock_ must not be held
+    std::optional<ChangeBlock> read_block(uint32_t block);
+    // fine summary buckets of the signal in the block. lock_ must not be held
+    std::vector<SummaryBucket> read_buckets(uint32_t block, uint32_t signal, uint32_t level);
+    // blocks of the signal that may have changes in [begin, end]
+    std::vector<uint32_t> find_blocks(uint32_t signal, uint64_t begin, uint64_t end);
+
+    int fd_ = -1;
+    uint64_t file_size_ = 0;
+
+    std::mutex lock_;
+    std::condition_variable queue_cond_;
+    std::condition_variable idle_cond_;
+    std::unordered_map<std::string, uint32_t> signals_;
+    std::vector<uint32_t> widths_;
+    // blocks each signal changes in
+    std::vector<std::vector<uint32_t>> signal_blocks_;
+    // the coarse levels of every signal. the fine levels of the current block are kept here
+    // until it's sealed
+    std::vector<SummaryPyramid> summaries_;
+    // time range of every block, including the current one
+    std::vector<std::pair<uint64_t, uint64_t>> block_times_;
+    // written blocks
+    std::vector<BlockInfo> index_;
+    // sealed blocks waiting to be written
+    std::deque<ChangeBlock> queue_;
+    ChangeBlock current_;
+    bool writing_ = false;
+    bool stop_ = false;
+    bool read_only_ = false;
+
+    std::thread thread_;
+};
+
+#endif  // KRATOS_RUNTIME_RECORDER_HH
@@ -0,0 +1,151 @@
+#include <atomic>
+#include <cstdarg>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "control.hh"
+#include "std/vpi_user.h"
+#include "trace.hh"
+
+// serves a recorded run through the runtime API. the runtime is linked as it is, and the VPI
+// calls it makes are answered from the recording instead of a simulator, so the same debugger
+// can inspect the run and move through it with POST /time/<t>
+
+static ReplayTrace trace;
+static std::atomic<uint64_t> current_time = 0;
+static std::atomic<bool> finished = false;
+
+struct ReplaySignal {
+    std::string name;
+    uint32_t width;
+};
+// handles have to stay valid, so signals are never moved
+static std::deque<ReplaySignal> signals;
+static std::unordered_map<std::string, vpiHandle> signal_handles;
+static std::mutex signal_lock;
+
+// callbacks that run at the next recorded time
+static std::vector<s_cb_data> next_time_callbacks;
+static std::mutex callback_lock;
+// returned for callbacks that never run, e.g. value changes since monitors poll in a replay
+static uint32_t dummy_handle = 0;
+
+// the vector is only read by the caller right after vpi_get_value
+static thread_local s_vpi_vecval vector_value[2];
+
+vpiHandle vpi_handle_by_name(PLI_BYTE8 *name, vpiHandle) {
+    std::lock_guard guard(signal_lock);
+    auto it = signal_handles.find(name);
+    if (it != signal_handles.end()) return it->second;
+    if (!trace.has_signal(name)) return nullptr;
+    auto &signal = signals.emplace_back(ReplaySignal{name, trace.get_width(name)});
+    auto handle = reinterpret_cast<vpiHandle>(&signal);
+    signal_handles.emplace(name, handle);
+    return handle;
+}
+
+void vpi_get_value(vpiHandle handle, p_vpi_value value_p) {
+    auto const *signal = reinterpret_cast<ReplaySignal *>(handle);
+    // signals without a value yet read as 0
+    auto value = static_cast<uint64_t>(trace.get_value(signal->name, current_time).value_or(0));
+    if (value_p->format == vpiVectorVal) {
+        vector_value[0] = {static_cast<PLI_UINT32>(value), 0};
+        vector_value[1] = {static_cast<PLI_UINT32>(value >> 32u), 0};
+        value_p->value.vector = vector_value;
+    } else {
+        value_p->value.integer = static_cast<PLI_INT32>(value);
+    }
+}
+
+PLI_INT32 vpi_get(PLI_INT32 property, vpiHandle handle) {
+    if (property != vpiSize || !handle) return 0;
+    return static_cast<PLI_INT32>(reinterpret_cast<ReplaySignal *>(handle)->width);
+}
+
+void vpi_get_time(vpiHandle, p_vpi_time time_p) {
+    uint64_t time = current_time;
+    time_p->low = static_cast<PLI_UINT32>(time);
+    time_p->high = static_cast<PLI_UINT32>(time >> 32u);
+}
+
+vpiHandle vpi_register_cb(p_cb_data cb_data_p) {
+    if (cb_data_p->reason == cbNextSimTime) {
+        std::lock_guard guard(callback_lock);
+        next_time_callbacks.emplace_back(*cb_data_p);
+    }
+    return &dummy_handle;
+}
+
+PLI_INT32 vpi_remove_cb(vpiHandle) { return 1; }
+PLI_INT32 vpi_free_object(vpiHandle) { return 1; }
+
+// scopes can't be walked, since only the recorded signals are known
+vpiHandle vpi_iterate(PLI_INT32, vpiHandle) { return nullptr; }
+vpiHandle vpi_scan(vpiHandle) { return nullptr; }
+PLI_BYTE8 *vpi_get_str(PLI_INT32, vpiHandle) { return nullptr; }
+
+// a recorded run can't be changed
+vpiHandle vpi_put_value(vpiHandle, p_vpi_value, p_vpi_time, PLI_INT32) { return nullptr; }
+
+PLI_INT32 vpi_control(PLI_INT32 operation, ...) {
+    if (operation == vpiFinish || operation == vpiStop) finished = true;
+    return 1;
+}
+
+static void run_next_time_callbacks() {
+    std::vector<s_cb_data> callbacks;
+    {
+        std::lock_guard guard(callback_lock);
+        callbacks.swap(next_time_callbacks);
+    }
+    for (auto &cb_data : callbacks) cb_data.cb_rtn(&cb_data);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <recording>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!trace.open(argv[1])) {
+        std::cerr << "Unable to read recording " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto first_time = trace.find_time(0);
+    if (!first_time) {
+        std::cerr << argv[1] << " has no recorded values" << std::endl;
+        return EXIT_FAILURE;
+    }
+    current_time = *first_time;
+    std::cout << "Replaying " << argv[1] << std::endl;
+    set_time_seek([](uint64_t time) { current_time = time; });
+    // nothing triggers value change callbacks, so monitors are sampled at every recorded time
+    // unless the mode is set explicitly
+    setenv("KRATOS_MONITOR_MODE", "poll", 0);
+    auto const *monitor_mode = std::getenv("KRATOS_MONITOR_MODE");
+    if (std::string(monitor_mode) != "poll") {
+        std::cerr << "WARNING: KRATOS_MONITOR_MODE is " << monitor_mode
+                  << ", monitors only report changes in a replay when they poll" << std::endl;
+    }
+
+    // the replay is paused at the first recorded time until the debugger continues it. every
+    // recorded time after that is a clock edge
+    initialize_runtime();
+    while (!finished) {
+        uint64_t time = current_time;
+        if (time == std::numeric_limits<uint64_t>::max()) break;
+        auto next_time = trace.find_time(time + 1);
+        if (!next_time) break;
+        current_time = *next_time;
+        run_next_time_callbacks();
+        breakpoint_clock();
+    }
+    std::cout << "Replay finished at " << current_time << std::endl;
+    teardown_runtime();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,329 @@
+#include "socket.hh"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+#include "fmt/format.h"
+
+constexpr size_t MAX_HEADER_SIZE = 64 * 1024;
+constexpr size_t READ_SIZE = 4096;
+
+UnixSocketServer::~UnixSocketServer() {
+    stop();
+    if (fd_ >= 0) ::close(fd_);
+}
+
+void UnixSocketServer::Get(const std::string &pattern, Handler handler) {
+    add_route("GET", pattern, std::move(handler));
+}
+
+void UnixSocketServer::Post(const std::string &pattern, Handler handler) {
+    add_route("POST", pattern, std::move(handler));
+}
+
+void UnixSocketServer::Delete(const std::string &pattern, Handler handler) {
+    add_route("DELETE", pattern, std::move(handler));
+}
+
+void UnixSocketServer::add_route(const std::string &method, const std::string &pattern,
+                                 Handler handler) {
+    routes_[method].emplace_back(Route{std::regex(pattern), std::move(handler)});
+}
+
+bool UnixSocketServer::bind(const std::string &path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path is too long: " << path << std::endl;
+        return false;
+    }
+    // remove the socket left behind by a previous run, but never a regular file
+    struct stat st {};
+    if (::lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) ::unlink(path.c_str());
+
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) return false;
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        ::listen(fd_, SOMAXCONN) != 0) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    path_ = path;
+    running_ = true;
+    return true;
+}
+
+void UnixSocketServer::listen() {
+    while (running_) {
+        auto fd = ::accept(fd_, nullptr, nullptr);
+        join_finished();
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        std::lock_guard guard(lock_);
+        if (!running_) {
+            ::close(fd);
+            break;
+        }
+        auto id = next_connection_++;
+        auto &entry = connections_[id];
+        entry.second = fd;
+        entry.first = std::thread([this, id, fd]() {
+            serve(fd);
+            std::lock_guard guard(lock_);
+            ::close(fd);
+            // stop() may have taken the thread already
+            auto it = connections_.find(id);
+            if (it == connections_.end()) return;
+            it->second.second = -1;
+            finished_.emplace_back(id);
+        });
+    }
+}
+
+void UnixSocketServer::stop() {
+    if (!running_.exchange(false)) return;
+    // wake up accept() and any connection waiting for a request
+    ::shutdown(fd_, SHUT_RDWR);
+    {
+        std::lock_guard guard(lock_);
+        for (auto &[id, entry] : connections_) {
+            if (entry.second >= 0) ::shutdown(entry.second, SHUT_RDWR);
+        }
+    }
+    while (true) {
+        std::thread thread;
+        {
+            std::lock_guard guard(lock_);
+            if (connections_.empty()) break;
+            auto it = connections_.begin();
+            thread = std::move(it->second.first);
+            connections_.erase(it);
+        }
+        if (thread.joinable()) thread.join();
+    }
+    // the listening socket is closed in the destructor, after listen() has returned
+    ::unlink(path_.c_str());
+}
+
+void UnixSocketServer::join_finished() {
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard guard(lock_);
+        for (auto id : finished_) {
+            auto it = connections_.find(id);
+            if (it == connections_.end()) continue;
+            threads.emplace_back(std::move(it->second.first));
+            connections_.erase(it);
+        }
+        finished_.clear();
+    }
+    for (auto &thread : threads) thread.join();
+}
+
+static std::string decode_url(const std::string &value, bool plus_as_space) {
+    std::string result;
+    result.reserve(value.size());
+    for (uint64_t i = 0; i < value.size(); i++) {
+        auto c = value[i];
+        if (c == '%' && i + 2 < value.size() && std::isxdigit(value[i + 1]) &&
+            std::isxdigit(value[i + 2])) {
+            result += static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else if (c == '+' && plus_as_space) {
+            result += ' ';
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+static void parse_query(const std::string &query, httplib::Params &params) {
+    uint64_t pos = 0;
+    while (pos <= query.size()) {
+        auto end = query.find('&', pos);
+        if (end == std::string::npos) end = query.size();
+        auto item = query.substr(pos, end - pos);
+        if (!item.empty()) {
+            auto eq = item.find('=');
+            auto key = item.substr(0, eq);
+            auto value = eq == std::string::npos ? "" : item.substr(eq + 1);
+            params.emplace(decode_url(key, true), decode_url(value, true));
+        }
+        pos = end + 1;
+    }
+}
+
+static std::string_view trim(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+        value.remove_prefix(1);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t' || value.back() == '\r'))
+        value.remove_suffix(1);
+    return value;
+}
+
+static bool equal_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (uint64_t i = 0; i < a.size(); i++) {
+        if (std::tolower(a[i]) != std::tolower(b[i])) return false;
+    }
+    return true;
+}
+
+static bool write_all(int fd, const std::string &data) {
+    uint64_t pos = 0;
+    while (pos < data.size()) {
+        auto n = ::send(fd, data.data() + pos, data.size() - pos, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        pos += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+static const char *status_reason(int status) {
+    switch (status) {
+        case 200:
+            return "OK";
+        case 400:
+            return "Bad Request";
+        case 401:
+            return "Unauthorized";
+        case 403:
+            return "Forbidden";
+        case 404:
+            return "Not Found";
+        case 500:
+            return "Internal Server Error";
+        default:
+            return "";
+    }
+}
+
+void UnixSocketServer::serve(int fd) {
+    std::string buffer;
+    char data[READ_SIZE];
+    // reads more data into the buffer. returns false when the connection is closed
+    auto read_more = [&]() {
+        while (true) {
+            auto n = ::recv(fd, data, sizeof(data), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buffer.append(data, static_cast<uint64_t>(n));
+            return true;
+        }
+    };
+
+    while (running_) {
+        uint64_t header_end;
+        while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (buffer.size() > MAX_HEADER_SIZE || !read_more()) return;
+        }
+
+        httplib::Request req;
+        httplib::Response res;
+        bool keep_alive = true;
+        uint64_t content_length = 0;
+        bool bad_request = false;
+
+        auto header = std::string_view(buffer).substr(0, header_end);
+        auto line_end = header.find("\r\n");
+        auto request_line = header.substr(0, line_end);
+        auto first_space = request_line.find(' ');
+        auto second_space = request_line.find(' ', first_space + 1);
+        if (first_space == std::string::npos || second_space == std::string::npos) return;
+        req.method = request_line.substr(0, first_space);
+        auto target = std::string(request_line.substr(first_space + 1,
+                                                      second_space - first_space - 1));
+        auto version = request_line.substr(second_space + 1);
+        if (version == "HTTP/1.0") keep_alive = false;
+
+        while (line_end != std::string::npos) {
+            auto start = line_end + 2;
+            line_end = header.find("\r\n", start);
+            auto line = header.substr(start, line_end == std::string::npos ? std::string::npos
+                                                                           : line_end - start);
+            auto colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            auto key = trim(line.substr(0, colon));
+            auto value = trim(line.substr(colon + 1));
+            if (equal_ignore_case(key, "Content-Length")) {
+                try {
+                    content_length = std::stoull(std::string(value));
+                } catch (const std::exception &) {
+                    bad_request = true;
+                }
+            } else if (equal_ignore_case(key, "Transfer-Encoding")) {
+                // chunked requests are not supported
+                bad_request = true;
+            } else if (equal_ignore_case(key, "Connection")) {
+                if (equal_ignore_case(value, "close")) keep_alive = false;
+                if (equal_ignore_case(value, "keep-alive")) keep_alive = true;
+            }
+            req.headers.emplace(key, value);
+        }
+        buffer.erase(0, header_end + 4);
+
+        while (buffer.size() < content_length) {
+            if (!read_more()) return;
+        }
+        req.body = buffer.substr(0, content_length);
+        buffer.erase(0, content_length);
+
+        parse_target(target, req);
+
+        if (bad_request) {
+            res.status = 400;
+            keep_alive = false;
+        } else {
+            handle(req, res);
+        }
+
+        std::string response = fmt::format("HTTP/1.1 {0} {1}\r\n", res.status,
+                                           status_reason(res.status));
+        for (auto const &[key, value] : res.headers) {
+            if (equal_ignore_case(key, "Content-Length") || equal_ignore_case(key, "Connection"))
+                continue;
+            response.append(fmt::format("{0}: {1}\r\n", key, value));
+        }
+        response.append(fmt::format("Content-Length: {0}\r\n", res.body.size()));
+        response.append(keep_alive ? "Connection: keep-alive\r\n\r\n"
+                                   : "Connection: close\r\n\r\n");
+        response.append(res.body);
+        if (!write_all(fd, response) || !keep_alive) return;
+    }
+}
+
+void UnixSocketServer::parse_target(const std::string &target, httplib::Request &req) {
+    auto query = target.find('?');
+    if (query != std::string::npos) parse_query(target.substr(query + 1), req.params);
+    req.path = decode_url(target.substr(0, query), false);
+}
+
+void UnixSocketServer::handle(httplib::Request &req, httplib::Response &res) {
+    auto routes = routes_.find(req.method);
+    if (routes != routes_.end()) {
+        for (auto const &route : routes->second) {
+            if (!std::regex_match(req.path, req.matches, route.pattern)) continue;
+            try {
+                route.handler(req, res);
+                if (res.status == -1) res.status = 200;
+            } catch (const std::exception &ex) {
+                res.status = 500;
+                res.body = ex.what();
+            }
+            return;
+        }
+    }
+    res.status = 404;
+}
@@ -0,0 +1,63 @@
+#ifndef KRATOS_RUNTIME_SOCKET_HH
+#define KRATOS_RUNTIME_SOCKET_HH
+
+#include <atomic>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "httplib.h"
+
+// serves the same handlers as the TCP server over a Unix domain socket, which is faster and
+// doesn't need a free port when the debugger runs on the same host. only what the runtime
+// uses is supported: HTTP/1.1 with keep-alive and Content-Length bodies
+class UnixSocketServer {
+public:
+    using Handler = httplib::Server::Handler;
+
+    UnixSocketServer() = default;
+    ~UnixSocketServer();
+    UnixSocketServer(const UnixSocketServer &) = delete;
+    UnixSocketServer &operator=(const UnixSocketServer &) = delete;
+
+    void Get(const std::string &pattern, Handler handler);
+    void Post(const std::string &pattern, Handler handler);
+    void Delete(const std::string &pattern, Handler handler);
+
+    // binds the socket and returns false on failure. an existing socket file at the path is
+    // replaced
+    bool bind(const std::string &path);
+    // blocks until stop() is called
+    void listen();
+    void stop();
+
+    // runs the handler of the matching route. also used to run batched requests
+    void handle(httplib::Request &req, httplib::Response &res);
+    // sets the decoded path and query parameters of the request
+    static void parse_target(const std::string &target, httplib::Request &req);
+
+private:
+    struct Route {
+        std::regex pattern;
+        Handler handler;
+    };
+
+    void add_route(const std::string &method, const std::string &pattern, Handler handler);
+    void serve(int fd);
+    void join_finished();
+
+    std::unordered_map<std::string, std::vector<Route>> routes_;
+    std::string path_;
+    int fd_ = -1;
+    std::atomic<bool> running_ = false;
+
+    std::mutex lock_;
+    uint64_t next_connection_ = 0;
+    std::unordered_map<uint64_t, std::pair<std::thread, int>> connections_;
+    std::vector<uint64_t> finished_;
+};
+
+#endif  // KRATOS_RUNTIME_SOCKET_HH
@@ -0,0 +1,49 @@
+#include "trace.hh"
+
+#include <algorithm>
+
+bool ReplayTrace::open(const std::string &filename) {
+    auto recording = std::make_unique<WaveformRecorder>();
+    if (recording->load(filename)) {
+        recording_ = std::move(recording);
+        return true;
+    }
+    capture_ = read_capture_file(filename);
+    if (!capture_) return false;
+    for (uint32_t i = 0; i < capture_->names.size(); i++) {
+        capture_signals_.emplace(capture_->names[i], i);
+    }
+    return true;
+}
+
+bool ReplayTrace::has_signal(const std::string &name) {
+    if (recording_) return recording_->has_signal(name);
+    return capture_signals_.find(name) != capture_signals_.end();
+}
+
+uint32_t ReplayTrace::get_width(const std::string &name) {
+    if (recording_) return recording_->get_width(name);
+    auto it = capture_signals_.find(name);
+    if (it == capture_signals_.end()) return 32;
+    return std::min<uint32_t>(capture_->widths[it->second], 64);
+}
+
+std::optional<int64_t> ReplayTrace::get_value(const std::string &name, uint64_t time) {
+    if (recording_) return recording_->get_value(name, time);
+    auto it = capture_signals_.find(name);
+    if (it == capture_signals_.end()) return std::nullopt;
+    auto const &times = capture_->times;
+    // the last row at or before the time
+    auto row = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+    if (row == 0) return std::nullopt;
+    return static_cast<int64_t>(capture_->values[it->second * times.size() + row - 1]);
+}
+
+std::optional<uint64_t> ReplayTrace::find_time(uint64_t time) {
+    if (recording_) return recording_->find_time(time);
+    if (!capture_) return std::nullopt;
+    auto const &times = capture_->times;
+    auto it = std::lower_bound(times.begin(), times.end(), time);
+    if (it == times.end()) return std::nullopt;
+    return *it;
+}
@@ -0,0 +1,35 @@
+#ifndef KRATOS_RUNTIME_TRACE_HH
+#define KRATOS_RUNTIME_TRACE_HH
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "capture.hh"
+#include "recorder.hh"
+
+// values of a finished run, read from either a change log written through KRATOS_RECORD or a
+// capture file written through POST /capture, so that the run can be inspected without the
+// simulator. signals are looked up by their full names
+class ReplayTrace {
+public:
+    // the format is detected from the file. returns false if it's neither
+    bool open(const std::string &filename);
+
+    bool has_signal(const std::string &name);
+    // width the signal was recorded with. values wider than 64 bits are truncated
+    uint32_t get_width(const std::string &name);
+    // value at the time, nullopt if nothing is recorded for the signal at or before it
+    std::optional<int64_t> get_value(const std::string &name, uint64_t time);
+    // the first recorded time at or after the given time
+    std::optional<uint64_t> find_time(uint64_t time);
+
+private:
+    std::unique_ptr<WaveformRecorder> recording_;
+    std::optional<CaptureData> capture_;
+    std::unordered_map<std::string, uint32_t> capture_signals_;
+};
+
+#endif  // KRATOS_RUNTIME_TRACE_HH
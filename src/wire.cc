@@ -0,0 +1,163 @@
+#include "wire.hh"
+
+#include <cstring>
+
+bool accept_msgpack(const std::string &accept) {
+    return accept.find(MSGPACK_CONTENT_TYPE) != std::string::npos;
+}
+
+template <typename T>
+void MsgPackWriter::write_be(T value) {
+    for (auto i = sizeof(T); i > 0; i--) {
+        write_byte(static_cast<uint8_t>(value >> ((i - 1) * 8)));
+    }
+}
+
+void MsgPackWriter::write_nil() { write_byte(0xc0); }
+
+void MsgPackWriter::write_bool(bool value) { write_byte(value ? 0xc3 : 0xc2); }
+
+void MsgPackWriter::write_uint(uint64_t value) {
+    if (value < 128) {
+        write_byte(static_cast<uint8_t>(value));
+    } else if (value <= 0xFF) {
+        write_byte(0xcc);
+        write_byte(static_cast<uint8_t>(value));
+    } else if (value <= 0xFFFF) {
+        write_byte(0xcd);
+        write_be(static_cast<uint16_t>(value));
+    } else if (value <= 0xFFFFFFFF) {
+        write_byte(0xce);
+        write_be(static_cast<uint32_t>(value));
+    } else {
+        write_byte(0xcf);
+        write_be(value);
+    }
+}
+
+void MsgPackWriter::write_int(int64_t value) {
+    if (value >= 0) {
+        write_uint(static_cast<uint64_t>(value));
+    } else if (value >= -32) {
+        write_byte(static_cast<uint8_t>(value));
+    } else {
+        write_byte(0xd3);
+        write_be(static_cast<uint64_t>(value));
+    }
+}
+
+void MsgPackWriter::write_double(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    write_byte(0xcb);
+    write_be(bits);
+}
+
+void MsgPackWriter::write_str(std::string_view value) {
+    auto size = value.size();
+    if (size < 32) {
+        write_byte(static_cast<uint8_t>(0xa0u | size));
+    } else if (size <= 0xFF) {
+        write_byte(0xd9);
+        write_byte(static_cast<uint8_t>(size));
+    } else if (size <= 0xFFFF) {
+        write_byte(0xda);
+        write_be(static_cast<uint16_t>(size));
+    } else {
+        write_byte(0xdb);
+        write_be(static_cast<uint32_t>(size));
+    }
+    data_.append(value.data(), size);
+}
+
+void MsgPackWriter::write_bin(const void *data, size_t size) {
+    if (size <= 0xFF) {
+        write_byte(0xc4);
+        write_byte(static_cast<uint8_t>(size));
+    } else if (size <= 0xFFFF) {
+        write_byte(0xc5);
+        write_be(static_cast<uint16_t>(size));
+    } else {
+        write_byte(0xc6);
+        write_be(static_cast<uint32_t>(size));
+    }
+    data_.append(reinterpret_cast<const char *>(data), size);
+}
+
+void MsgPackWriter::write_array(uint32_t size) {
+    if (size < 16) {
+        write_byte(static_cast<uint8_t>(0x90u | size));
+    } else if (size <= 0xFFFF) {
+        write_byte(0xdc);
+        write_be(static_cast<uint16_t>(size));
+    } else {
+        write_byte(0xdd);
+        write_be(size);
+    }
+}
+
+void MsgPackWriter::write_map(uint32_t size) {
+    if (size < 16) {
+        write_byte(static_cast<uint8_t>(0x80u | size));
+    } else if (size <= 0xFFFF) {
+        write_byte(0xde);
+        write_be(static_cast<uint16_t>(size));
+    } else {
+        write_byte(0xdf);
+        write_be(size);
+    }
+}
+
+void MsgPackWriter::write_value(const RawValue &value) {
+    if (value.width <= 64) {
+        uint64_t v = value.words.empty() ? 0 : value.words[0];
+        if (value.words.size() > 1) v |= static_cast<uint64_t>(value.words[1]) << 32u;
+        write_uint(v);
+        return;
+    }
+    std::string bytes;
+    bytes.reserve((value.width + 7) / 8);
+    for (auto word : value.words) {
+        for (uint32_t i = 0; i < 4 && bytes.size() < (value.width + 7) / 8; i++) {
+            bytes.push_back(static_cast<char>(word >> (i * 8)));
+        }
+    }
+    write_bin(bytes.data(), bytes.size());
+}
+
+void MsgPackWriter::write_json(const json11::Json &json) {
+    switch (json.type()) {
+        case json11::Json::NUL:
+            write_nil();
+            break;
+        case json11::Json::BOOL:
+            write_bool(json.bool_value());
+            break;
+        case json11::Json::NUMBER: {
+            auto value = json.number_value();
+            // json11 stores every number as a double
+            auto is_int = value >= -9.2e18 && value <= 9.2e18 &&
+                          static_cast<double>(static_cast<int64_t>(value)) == value;
+            if (is_int) {
+                write_int(static_cast<int64_t>(value));
+            } else {
+                write_double(value);
+            }
+            break;
+        }
+        case json11::Json::STRING:
+            write_str(json.string_value());
+            break;
+        case json11::Json::ARRAY:
+            write_array(static_cast<uint32_t>(json.array_items().size()));
+            for (auto const &item : json.array_items()) write_json(item);
+            break;
+        case json11::Json::OBJECT:
+            write_map(static_cast<uint32_t>(json.object_items().size()));
+            for (auto const &[key, item] : json.object_items()) {
+                write_str(key);
+                write_json(item);
+            }
+            break;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef KRATOS_RUNTIME_WIRE_HH
+#define KRATOS_RUNTIME_WIRE_HH
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json11/json11.hpp"
+
+// binary encoding for value-heavy responses. clients opt in with
+// "Accept: application/msgpack", otherwise JSON is used
+constexpr auto MSGPACK_CONTENT_TYPE = "application/msgpack";
+
+bool accept_msgpack(const std::string &accept);
+
+// signal value at its real width. words are little-endian
+struct RawValue {
+    uint32_t width;
+    std::vector<uint32_t> words;
+};
+
+// minimal MessagePack writer
+class MsgPackWriter {
+public:
+    void write_nil();
+    void write_bool(bool value);
+    void write_uint(uint64_t value);
+    void write_int(int64_t value);
+    void write_double(double value);
+    void write_str(std::string_view value);
+    void write_bin(const void *data, size_t size);
+    void write_array(uint32_t size);
+    void write_map(uint32_t size);
+    // values up to 64 bits are sent as integers, wider ones as little-endian binary
+    void write_value(const RawValue &value);
+    // strings are sent as they are. responses with signal values encode them with write_value
+    // instead
+    void write_json(const json11::Json &json);
+    // appends an already encoded object
+    void write_raw(const std::string &data) { data_.append(data); }
+
+    [[nodiscard]] const std::string &data() const { return data_; }
+
+private:
+    void write_byte(uint8_t value) { data_.push_back(static_cast<char>(value)); }
+    template <typename T>
+    void write_be(T value);
+
+    std::string data_;
+};
+
+#endif  // KRATOS_RUNTIME_WIRE_HH
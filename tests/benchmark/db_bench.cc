@@ -0,0 +1,200 @@
+#include <sqlite3.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+
+#include "../../src/db.hh"
+#include "../vpi_impl.hh"
+#include "fmt/format.h"
+
+// micro-benchmark for the debug database queries on a large synthetic design.
+// the schema follows docs/README.md
+constexpr const char *SCHEMA_SQL = R"(
+CREATE TABLE IF NOT EXISTS 'instance' ( 'id' INTEGER PRIMARY KEY NOT NULL , 'handle_name' TEXT NOT NULL );
+CREATE TABLE IF NOT EXISTS 'hierarchy' ( 'parent_handle' INTEGER , 'name' TEXT NOT NULL , 'handle' INTEGER , FOREIGN KEY( parent_handle ) REFERENCES instance ( id ) );
+CREATE TABLE IF NOT EXISTS 'variable' ( 'id' INTEGER PRIMARY KEY NOT NULL , 'handle' INTEGER , 'value' TEXT NOT NULL , 'is_verilog_var' INTEGER NOT NULL , FOREIGN KEY( handle ) REFERENCES instance ( id ) );
+CREATE TABLE IF NOT EXISTS 'generator_variable' ( 'variable_id' INTEGER , 'handle' INTEGER , 'name' TEXT NOT NULL , FOREIGN KEY( variable_id ) REFERENCES variable ( id ) , FOREIGN KEY( handle ) REFERENCES instance ( id ) );
+CREATE TABLE IF NOT EXISTS 'context' ( 'variable_id' INTEGER , 'breakpoint_id' INTEGER , 'name' TEXT NOT NULL , FOREIGN KEY( variable_id ) REFERENCES variable ( id ) , FOREIGN KEY( breakpoint_id ) REFERENCES breakpoint ( id ) );
+CREATE TABLE IF NOT EXISTS 'connection' ( 'handle_from' INTEGER , 'var_from' TEXT NOT NULL , 'handle_to' INTEGER , 'var_to' TEXT NOT NULL , FOREIGN KEY( handle_from ) REFERENCES instance ( id ) , FOREIGN KEY( handle_to ) REFERENCES instance ( id ) );
+CREATE TABLE IF NOT EXISTS 'breakpoint' ( 'id' INTEGER PRIMARY KEY NOT NULL , 'filename' TEXT NOT NULL , 'line_num' INTEGER NOT NULL , 'column_num' INTEGER NOT NULL );
+CREATE TABLE IF NOT EXISTS 'metadata' ( 'name' TEXT NOT NULL , 'value' TEXT NOT NULL );
+CREATE TABLE IF NOT EXISTS 'instance_set' ( 'instance_id' INTEGER , 'breakpoint_id' INTEGER , FOREIGN KEY( instance_id ) REFERENCES instance ( id ) , FOREIGN KEY( breakpoint_id ) REFERENCES breakpoint ( id ) );
+)";
+
+constexpr uint32_t FANOUT = 8;
+constexpr uint32_t NUM_VARS = 16;
+constexpr uint32_t NUM_BREAKPOINTS = 8;
+constexpr uint32_t NUM_CONNECTIONS = 4;
+constexpr uint32_t NUM_FILES = 64;
+
+void exec(sqlite3 *db, const std::string &sql) {
+    char *error = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+        std::cerr << error << std::endl;
+        sqlite3_free(error);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+std::vector<std::string> create_db(const std::string &filename, uint32_t num_instances) {
+    sqlite3 *db;
+    sqlite3_open(filename.c_str(), &db);
+    exec(db, SCHEMA_SQL);
+    exec(db, "BEGIN TRANSACTION");
+    std::vector<std::string> names = {"top"};
+    names.reserve(num_instances);
+    exec(db, "INSERT INTO metadata VALUES ('top_name', 'top')");
+    exec(db, "INSERT INTO instance VALUES (0, 'top')");
+    uint32_t var_id = 0;
+    uint32_t bp_id = 0;
+    for (uint32_t id = 0; id < num_instances; id++) {
+        if (id > 0) {
+            auto parent = (id - 1) / FANOUT;
+            auto child = fmt::format("inst{0}", (id - 1) % FANOUT);
+            names.emplace_back(fmt::format("{0}.{1}", names[parent], child));
+            exec(db, fmt::format("INSERT INTO instance VALUES ({0}, '{1}')", id, names.back()));
+            exec(db, fmt::format("INSERT INTO hierarchy VALUES ({0}, '{1}', {2})", parent,
+                                 child, id));
+            for (uint32_t i = 0; i < NUM_CONNECTIONS; i++) {
+                exec(db, fmt::format("INSERT INTO connection VALUES ({0}, 'out{1}', {2}, "
+                                     "'{3}_{1}')",
+                                     id, i, parent, child));
+            }
+        }
+        for (uint32_t i = 0; i < NUM_VARS; i++) {
+            exec(db, fmt::format("INSERT INTO variable VALUES ({0}, {1}, 'var{2}', 1)", var_id,
+                                 id, i));
+            exec(db, fmt::format("INSERT INTO generator_variable VALUES ({0}, {1}, 'var{2}')",
+                                 var_id, id, i));
+            var_id++;
+        }
+        for (uint32_t i = 0; i < NUM_BREAKPOINTS; i++) {
+            auto file = (id * NUM_BREAKPOINTS + i) % NUM_FILES;
+            exec(db, fmt::format("INSERT INTO breakpoint VALUES ({0}, '/tmp/mod{1}.py', {2}, 0)",
+                                 bp_id, file, bp_id / NUM_FILES + 1));
+            exec(db, fmt::format("INSERT INTO instance_set VALUES ({0}, {1})", id, bp_id));
+            exec(db, fmt::format("INSERT INTO context VALUES ({0}, {1}, 'self.var{2}')",
+                                 var_id - 1, bp_id, NUM_VARS - 1));
+            bp_id++;
+        }
+    }
+    exec(db, "COMMIT");
+    sqlite3_close(db);
+    return names;
+}
+
+template <typename F>
+double measure_us(uint32_t iterations, F &&f) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) f(i);
+    auto end = std::chrono::steady_clock::now();
+    return static_cast<double>(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) /
+           1000.0 / iterations;
+}
+
+constexpr auto CONNECTION_FROM_SQL =
+    "SELECT a.handle_name, c.var_from, b.handle_name, c.var_to FROM "
+    "instance a, instance b, connection c WHERE a.id = c.handle_from AND "
+    "a.handle_name = ?1 AND b.id = c.handle_to";
+
+// reference implementation that queries SQLite directly and prepares the statement
+// every time
+uint32_t query_adhoc(sqlite3 *db, const std::string &handle_name) {
+    sqlite3_stmt *stmt;
+    sqlite3_prepare_v2(db, CONNECTION_FROM_SQL, -1, &stmt, nullptr);
+    sqlite3_bind_text(stmt, 1, handle_name.c_str(), -1, SQLITE_TRANSIENT);
+    uint32_t count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) count++;
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t num_instances = argc > 1 ? std::stoul(argv[1]) : 100000;
+    uint32_t iterations = argc > 2 ? std::stoul(argv[2]) : 1000;
+    auto filename =
+        (std::filesystem::temp_directory_path() / fmt::format("db_bench_{0}.db", getpid()))
+            .string();
+
+    auto start = std::chrono::steady_clock::now();
+    auto names = create_db(filename, num_instances);
+    auto end = std::chrono::steady_clock::now();
+    printf("Create %u instances: %ld ms\n", num_instances,
+           static_cast<long>(
+               std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()));
+
+    std::mt19937 gen(0);  // NOLINT
+    std::uniform_int_distribution<uint32_t> dist(0, num_instances - 1);
+    std::vector<uint32_t> samples(iterations);
+    for (auto &v : samples) v = dist(gen);
+
+    // keep the compiled debug info away from the user's cache
+    auto cache_dir =
+        std::filesystem::temp_directory_path() / fmt::format("db_bench_cache_{0}", getpid());
+    setenv("KRATOS_CACHE_DIR", cache_dir.c_str(), 1);
+    {
+        // the first load compiles the debug info and writes the cache
+        start = std::chrono::steady_clock::now();
+        { Database db(filename); }
+        end = std::chrono::steady_clock::now();
+        printf("Load database (cold): %ld ms\n",
+               static_cast<long>(
+                   std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()));
+    }
+    {
+        start = std::chrono::steady_clock::now();
+        Database db(filename);
+        end = std::chrono::steady_clock::now();
+        printf("Load database (cached): %ld ms\n",
+               static_cast<long>(
+                   std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()));
+
+        auto bp_us = measure_us(iterations, [&](uint32_t i) {
+            auto id = samples[i] * NUM_BREAKPOINTS;
+            auto info = db.get_breakpoint_info(id);
+            db.get_breakpoints(info->first, info->second);
+            db.get_variable_mapping(samples[i], id);
+            db.get_context_variable(samples[i], id);
+        });
+        printf("Breakpoint frame lookup: %.2f us\n", bp_us);
+        auto hierarchy_us =
+            measure_us(iterations, [&](uint32_t i) { db.get_hierarchy(names[samples[i]]); });
+        printf("Hierarchy: %.2f us\n", hierarchy_us);
+        auto conn_us =
+            measure_us(iterations, [&](uint32_t i) { db.get_connection_from(names[samples[i]]); });
+        printf("Connection: %.2f us\n", conn_us);
+
+        // the same lookup in SQLite, with the statement prepared once and rebound per call
+        SQLiteConnection conn(filename);
+        auto &stmt = conn.statement("connection_from", CONNECTION_FROM_SQL);
+        auto prepared_us = measure_us(iterations, [&](uint32_t i) {
+            Query query(stmt);
+            query.bind(1, names[samples[i]]);
+            while (query.next()) {
+            }
+        });
+        printf("Connection (SQLite, prepared once): %.2f us\n", prepared_us);
+        auto adhoc_us = measure_us(
+            iterations, [&](uint32_t i) { query_adhoc(conn.handle(), names[samples[i]]); });
+        printf("Connection (SQLite, prepared per call): %.2f us\n", adhoc_us);
+
+        auto stats = db.get_query_stats();
+        auto conn_stats = conn.stats();
+        stats.insert(stats.end(), conn_stats.begin(), conn_stats.end());
+        for (auto const &stat : stats) {
+            printf("  %-20s count: %8lu mean: %10.2f us max: %10.2f us\n", stat.name.c_str(),
+                   static_cast<unsigned long>(stat.count),
+                   stat.count ? static_cast<double>(stat.total_ns) / 1000 / stat.count : 0.0,
+                   static_cast<double>(stat.max_ns) / 1000);
+        }
+    }
+
+    std::filesystem::remove(filename);
+    std::filesystem::remove_all(cache_dir);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,29 @@
+#ifndef KRATOS_RUNTIME_TEMP_FILE_HH
+#define KRATOS_RUNTIME_TEMP_FILE_HH
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+
+// a file in the temp directory that is unique to the test process. it's removed when the test
+// ends, together with the -wal and -shm files SQLite leaves next to it
+class TempFile {
+public:
+    TempFile(const std::string &name, const std::string &extension)
+        : path_((std::filesystem::temp_directory_path() /
+                 (name + "_" + std::to_string(getpid()) + extension))
+                    .string()) {}
+    ~TempFile() {
+        std::error_code ec;
+        for (auto const *suffix : {"", "-wal", "-shm"}) std::filesystem::remove(path_ + suffix, ec);
+    }
+    TempFile(const TempFile &) = delete;
+    TempFile &operator=(const TempFile &) = delete;
+
+    [[nodiscard]] const std::string &path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+#endif  // KRATOS_RUNTIME_TEMP_FILE_HH
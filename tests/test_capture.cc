@@ -0,0 +1,86 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "gtest/gtest.h"
+#include "../src/capture.hh"
+#include "temp_file.hh"
+#include "vpi_impl.hh"
+
+TEST(capture, columns) {  // NOLINT
+    TempFile file("test_capture", ".kcap");
+    auto const &filename = file.path();
+    constexpr uint64_t num_rows = StateCapture::CHUNK_SIZE + 10;
+    {
+        StateCapture capture;
+        ASSERT_TRUE(capture.open(filename, {"TOP.a", "TOP.b"}, {&v, &v}));
+        for (uint64_t i = 0; i < num_rows; i++) {
+            vec[0].aval = static_cast<PLI_INT32>(i);
+            capture.sample(i * 10);
+        }
+        EXPECT_EQ(capture.close(), num_rows);
+    }
+    std::ifstream stream(filename, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    // header, two signals with 4 + 4 + 5 bytes each, then two chunks of 3 columns
+    auto header_size = 16 + 2 * 13;
+    EXPECT_EQ(data.size(), header_size + 2 * 8 + num_rows * 3 * 8);
+    EXPECT_EQ(data.substr(0, 8), "KRATOSCP");
+    EXPECT_EQ(data.substr(16 + 8, 5), "TOP.a");
+
+    auto read_u64 = [&](uint64_t pos) {
+        uint64_t value;
+        std::memcpy(&value, data.data() + pos, sizeof(value));
+        return value;
+    };
+    uint32_t chunk_rows;
+    std::memcpy(&chunk_rows, data.data() + header_size, sizeof(chunk_rows));
+    EXPECT_EQ(chunk_rows, StateCapture::CHUNK_SIZE);
+    auto times = header_size + 8;
+    auto column_b = times + 2 * StateCapture::CHUNK_SIZE * 8;
+    EXPECT_EQ(read_u64(times + 8 * 5), 50);
+    EXPECT_EQ(read_u64(column_b + 8 * 5), 5);
+}
+
+TEST(capture, read) {  // NOLINT
+    TempFile file("test_capture_read", ".kcap");
+    auto const &filename = file.path();
+    constexpr uint64_t num_rows = StateCapture::CHUNK_SIZE * 2 + 1;
+    uint32_t a = 0, b = 0;
+    {
+        StateCapture capture;
+        ASSERT_TRUE(capture.open(filename, {"TOP.a", "TOP.b"}, {&a, &b}));
+        for (uint64_t i = 0; i < num_rows; i++) {
+            a = b = static_cast<uint32_t>(i);
+            capture.sample(i);
+        }
+    }
+    auto data = read_capture_file(filename);
+    ASSERT_TRUE(data);
+    EXPECT_EQ(data->names, std::vector<std::string>({"TOP.a", "TOP.b"}));
+    EXPECT_EQ(data->widths, std::vector<uint32_t>({32, 32}));
+    ASSERT_EQ(data->times.size(), num_rows);
+    EXPECT_EQ(data->times[num_rows - 1], num_rows - 1);
+    ASSERT_EQ(data->values.size(), num_rows * 2);
+    EXPECT_EQ(data->values[StateCapture::CHUNK_SIZE + 3], StateCapture::CHUNK_SIZE + 3);
+    EXPECT_EQ(data->values[num_rows + 7], 7);
+    std::filesystem::remove(filename);
+    EXPECT_FALSE(read_capture_file(filename));
+}
+
+TEST(capture, read_signal_value) {  // NOLINT
+    vec[0] = {0xFFFFFFFF, 0};
+    vec[1] = {0x12345678, 0};
+    uint64_t unknown = 1;
+    EXPECT_EQ(read_signal_value(&v, 64, &unknown), 0x12345678FFFFFFFF);
+    EXPECT_EQ(unknown, 0);
+    // bits above the width are dropped
+    EXPECT_EQ(read_signal_value(&v, 4, &unknown), 0xF);
+    // an X in bit 1 and a Z in bit 33
+    vec[0] = {0b10, 0b10};
+    vec[1] = {0, 0b10};
+    EXPECT_EQ(read_signal_value(&v, 40, &unknown), 0b10);
+    EXPECT_EQ(unknown, (uint64_t(1) << 33u) | 0b10u);
+    vec[0] = {};
+    vec[1] = {};
+}
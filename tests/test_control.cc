@@ -0,0 +1,235 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "../src/control.hh"
+#include "vpi_impl.hh"
+
+// a thread that stands in for the simulator and stays paused until the test ends
+class PausedTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        pause();
+        put_value_calls.clear();
+    }
+
+    void TearDown() override { resume(); }
+
+    // pauses like a breakpoint does
+    void pause() {
+        sim_thread = std::thread([]() {
+            begin_pause_values();
+            pause_sim();
+        });
+        // the pause has started once tasks run on the simulator thread
+        while (true) {
+            std::thread::id id;
+            run_on_sim_thread([&id]() { id = std::this_thread::get_id(); });
+            if (id == sim_thread.get_id()) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void resume() {
+        un_pause_sim();
+        sim_thread.join();
+    }
+
+    std::thread sim_thread;
+};
+
+TEST(control, put_values_not_paused) {  // NOLINT
+    put_value_calls.clear();
+    std::string error;
+    EXPECT_FALSE(put_values(R"([{"handle": "a", "value": 1}])", error));
+    EXPECT_EQ(error, "Simulation is not paused");
+    EXPECT_TRUE(put_value_calls.empty());
+}
+
+TEST_F(PausedTest, put_values_mode) {  // NOLINT
+    std::string error;
+    EXPECT_TRUE(put_values(R"([{"handle": "a", "value": 1},
+                               {"handle": "b", "value": "2", "mode": "force"},
+                               {"handle": "c", "mode": "release"}])",
+                           error));
+    ASSERT_EQ(put_value_calls.size(), 3);
+    EXPECT_EQ(put_value_calls[0].format, vpiDecStrVal);
+    EXPECT_EQ(put_value_calls[0].value, "1");
+    EXPECT_EQ(put_value_calls[0].flags, vpiNoDelay);
+    EXPECT_EQ(put_value_calls[1].value, "2");
+    EXPECT_EQ(put_value_calls[1].flags, vpiForceFlag);
+    // the simulator writes back the released value
+    EXPECT_EQ(put_value_calls[2].format, vpiIntVal);
+    EXPECT_EQ(put_value_calls[2].flags, vpiReleaseFlag);
+}
+
+TEST_F(PausedTest, put_values_format) {  // NOLINT
+    std::string error;
+    EXPECT_TRUE(put_values(R"([{"handle": "a", "value": "0xDEADbeef0123456789"},
+                               {"handle": "b", "value": "0b1010"},
+                               {"handle": "c", "value": "-5"},
+                               {"handle": "d", "value": -5},
+                               {"handle": "e", "value": "123456789012345678901234567890"},
+                               {"handle": "f", "value": 9007199254740992}])",
+                           error));
+    ASSERT_EQ(put_value_calls.size(), 6);
+    EXPECT_EQ(put_value_calls[0].format, vpiHexStrVal);
+    EXPECT_EQ(put_value_calls[0].value, "DEADbeef0123456789");
+    EXPECT_EQ(put_value_calls[1].format, vpiBinStrVal);
+    EXPECT_EQ(put_value_calls[1].value, "1010");
+    EXPECT_EQ(put_value_calls[2].format, vpiDecStrVal);
+    EXPECT_EQ(put_value_calls[2].value, "-5");
+    EXPECT_EQ(put_value_calls[3].value, "-5");
+    EXPECT_EQ(put_value_calls[4].value, "123456789012345678901234567890");
+    EXPECT_EQ(put_value_calls[5].value, "9007199254740992");
+}
+
+TEST_F(PausedTest, put_values_invalid) {  // NOLINT
+    // the valid entries before a bad one are not written either
+    for (auto const *entry : {R"({"handle": "b", "value": "abc"})",
+                              R"({"handle": "b", "value": "0x"})",
+                              R"({"handle": "b", "value": "1", "mode": "poke"})",
+                              R"({"handle": "b"})",
+                              R"({"value": 1})",
+                              R"({"handle": "b", "value": 1.5})",
+                              R"({"handle": "b", "value": 9007199254740994})"}) {
+        std::string error;
+        auto content = std::string(R"([{"handle": "a", "value": 1}, )") + entry + "]";
+        EXPECT_FALSE(put_values(content, error)) << entry;
+        EXPECT_FALSE(error.empty()) << entry;
+        EXPECT_TRUE(put_value_calls.empty()) << entry;
+    }
+    std::string error;
+    EXPECT_FALSE(put_values(R"({"handle": "a", "value": 1})", error));
+    EXPECT_EQ(error, "Expect a list of values");
+    EXPECT_FALSE(put_values("[", error));
+    EXPECT_TRUE(put_value_calls.empty());
+}
+
+TEST_F(PausedTest, pause_values) {  // NOLINT
+    v = 7;
+    get_value_calls = 0;
+    std::optional<std::string> value;
+    read_sim([&value]() {
+        value = get_pause_value("a");
+        get_pause_value("a");
+    });
+    read_sim([&value]() { value = get_pause_value("a"); });
+    EXPECT_EQ(value, "7");
+    // each signal is read once per pause
+    EXPECT_EQ(get_value_calls, 1);
+
+    // a write changes the values
+    v = 8;
+    std::string error;
+    write_sim([&]() { EXPECT_TRUE(put_values(R"([{"handle": "a", "value": 8}])", error)); });
+    get_value_calls = 0;
+    read_sim([&value]() { value = get_pause_value("a"); });
+    EXPECT_EQ(value, "8");
+    EXPECT_EQ(get_value_calls, 1);
+
+    // values are read every time once the simulation continues
+    resume();
+    v = 9;
+    get_value_calls = 0;
+    EXPECT_EQ(get_pause_value("a"), "9");
+    EXPECT_EQ(get_pause_value("a"), "9");
+    EXPECT_EQ(get_value_calls, 2);
+
+    // and memoized again at the next pause
+    pause();
+    v = 10;
+    get_value_calls = 0;
+    read_sim([&value]() { value = get_pause_value("a"); });
+    read_sim([&value]() { value = get_pause_value("a"); });
+    EXPECT_EQ(value, "10");
+    EXPECT_EQ(get_value_calls, 1);
+}
+
+TEST_F(PausedTest, read_sim_nested) {  // NOLINT
+    // nested calls run inline on the simulator thread instead of waiting for it
+    std::thread::id outer, inner, task;
+    read_sim([&]() {
+        outer = std::this_thread::get_id();
+        read_sim([&inner]() { inner = std::this_thread::get_id(); });
+        run_on_sim_thread([&task]() { task = std::this_thread::get_id(); });
+    });
+    EXPECT_EQ(outer, sim_thread.get_id());
+    EXPECT_EQ(inner, sim_thread.get_id());
+    EXPECT_EQ(task, sim_thread.get_id());
+    inner = {};
+    write_sim([&inner]() { read_sim([&inner]() { inner = std::this_thread::get_id(); }); });
+    EXPECT_EQ(inner, sim_thread.get_id());
+}
+
+TEST(control, read_sim_not_paused) {  // NOLINT
+    // a read inside a write would wait for the exclusive lock if it took vpi_lock again
+    std::thread::id inner;
+    write_sim([&inner]() { read_sim([&inner]() { inner = std::this_thread::get_id(); }); });
+    EXPECT_EQ(inner, std::this_thread::get_id());
+}
+
+TEST(control, early_resume) {  // NOLINT
+    // the debugger continues before the simulator thread starts waiting
+    begin_pause();
+    un_pause_sim();
+    std::thread sim_thread([]() { pause_sim(); });
+    sim_thread.join();
+    // the pause is over, so nothing is written and tasks run on the calling thread
+    std::string error;
+    EXPECT_FALSE(put_values(R"([{"handle": "a", "value": 1}])", error));
+    EXPECT_EQ(error, "Simulation is not paused");
+    std::thread::id id;
+    run_on_sim_thread([&id]() { id = std::this_thread::get_id(); });
+    EXPECT_EQ(id, std::this_thread::get_id());
+}
+
+TEST(control, stray_resume) {  // NOLINT
+    // a resume while the simulation is running doesn't skip the next pause
+    un_pause_sim();
+    std::thread sim_thread([]() { pause_sim(); });
+    while (true) {
+        std::thread::id id;
+        run_on_sim_thread([&id]() { id = std::this_thread::get_id(); });
+        if (id == sim_thread.get_id()) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    un_pause_sim();
+    sim_thread.join();
+}
+
+TEST(control, db_state) {  // NOLINT
+    // nothing waits before the debugger connects
+    EXPECT_EQ(get_db_state(), DatabaseState::Disconnected);
+    EXPECT_EQ(wait_db(), nullptr);
+
+    auto dir = std::filesystem::temp_directory_path() /
+               ("test_control_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+    setenv("KRATOS_CACHE_DIR", dir.c_str(), 1);
+    load_db((dir / "missing" / "debug.db").string());
+    EXPECT_EQ(wait_db(), nullptr);
+    EXPECT_EQ(get_db_state(), DatabaseState::Error);
+
+    load_db((dir / "debug.db").string());
+    std::shared_ptr<Database> db;
+    auto state = DatabaseState::Loading;
+    // holding vpi_lock returns whatever is loaded so far instead of waiting
+    write_sim([&]() {
+        db = wait_db();
+        state = get_db_state();
+    });
+    if (state == DatabaseState::Loading) EXPECT_EQ(db, nullptr);
+    EXPECT_NE(wait_db(), nullptr);
+    EXPECT_EQ(get_db_state(), DatabaseState::Ready);
+
+    unload_db();
+    EXPECT_EQ(get_db_state(), DatabaseState::Disconnected);
+    EXPECT_EQ(wait_db(), nullptr);
+    unsetenv("KRATOS_CACHE_DIR");
+    std::filesystem::remove_all(dir);
+}
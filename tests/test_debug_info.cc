@@ -0,0 +1,211 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "gtest/gtest.h"
+#include "../src/debug_info.hh"
+#include "temp_file.hh"
+#include "vpi_impl.hh"
+
+DebugInfo build_info() {
+    DebugInfoBuilder builder;
+    builder.add_instance(0, "top");
+    builder.add_instance(1, "top.child");
+    builder.add_breakpoint(0, "/tmp/a.py", 10, 0);
+    builder.add_breakpoint(1, "/tmp/a.py", 10, 4);
+    builder.add_breakpoint(2, "/tmp/a.py", 12, 0);
+    builder.add_breakpoint(3, "/tmp/b.py", 10, 0);
+    builder.add_instance_set(0, 0);
+    builder.add_instance_set(1, 0);
+    builder.add_instance_set(1, 3);
+    builder.add_generator_variable(0, "a", "a", true);
+    builder.add_generator_variable(1, "b", "b", true);
+    builder.add_context_variable(1, 0, "width", "8", false);
+    builder.add_context_variable(1, 0, "self.b", "b", true);
+    builder.add_child(0, "child");
+    builder.add_connection(1, "out", 0, "child_out");
+    builder.set_top_name("top");
+    return builder.build(42);
+}
+
+TEST(debug_info, breakpoint) {  // NOLINT
+    auto info = build_info();
+    auto bps = info.get_breakpoints("/tmp/a.py", 10);
+    EXPECT_EQ(bps.size, 2);
+    EXPECT_EQ(bps[0], 0);
+    EXPECT_EQ(bps[1], 1);
+    EXPECT_TRUE(info.get_breakpoints("/tmp/a.py", 11).empty());
+    EXPECT_EQ(info.get_breakpoint(1)->column_num, 4);
+    EXPECT_EQ(info.get_breakpoint(4), nullptr);
+    EXPECT_EQ(info.get_file_breakpoints("/tmp/a.py").size(), 3);
+    EXPECT_EQ(info.get_files().size, 2);
+}
+
+TEST(debug_info, frame) {  // NOLINT
+    auto info = build_info();
+    EXPECT_EQ(info.get_instances(0).size, 2);
+    EXPECT_EQ(info.get_instance_name(1), "top.child");
+    auto const *frame = info.get_frame(1, 0);
+    ASSERT_NE(frame, nullptr);
+    auto gen_vars = info.get_generator_variables(*frame);
+    EXPECT_EQ(gen_vars.size, 1);
+    EXPECT_EQ(info.str(gen_vars[0].name), "b");
+    auto context_vars = info.get_context_variables(*frame);
+    EXPECT_EQ(context_vars.size, 2);
+    EXPECT_EQ(info.str(context_vars[0].name), "width");
+    EXPECT_FALSE(context_vars[0].is_var);
+    // frame without context variables
+    frame = info.get_frame(0, 0);
+    ASSERT_NE(frame, nullptr);
+    EXPECT_TRUE(info.get_context_variables(*frame).empty());
+    auto frames = info.get_frames(1);
+    ASSERT_EQ(frames.size, 2);
+    EXPECT_EQ(frames[0].breakpoint_id, 0);
+    EXPECT_EQ(frames[1].breakpoint_id, 3);
+    EXPECT_TRUE(info.get_frames(2).empty());
+}
+
+TEST(debug_info, hierarchy) {  // NOLINT
+    auto info = build_info();
+    EXPECT_EQ(info.get_top_name(), "top");
+    EXPECT_EQ(info.get_instance_id("top.child"), 1);
+    EXPECT_FALSE(info.get_instance_id("top.foo"));
+    auto children = info.get_children(0);
+    ASSERT_EQ(children.size, 1);
+    EXPECT_EQ(info.str(children[0].name), "child");
+    EXPECT_TRUE(info.get_children(1).empty());
+    auto from = info.get_connections_from(1);
+    ASSERT_EQ(from.size, 1);
+    EXPECT_EQ(info.str(from[0].var_to), "child_out");
+    auto to = info.get_connections_to(0);
+    ASSERT_EQ(to.size(), 1);
+    EXPECT_EQ(info.str(to[0]->var_from), "out");
+    EXPECT_TRUE(info.get_connections_to(1).empty());
+}
+
+TEST(debug_info, hierarchy_search) {  // NOLINT
+    DebugInfoBuilder builder;
+    builder.add_instance(0, "top");
+    builder.add_instance(1, "top.b");
+    builder.add_instance(2, "top.a");
+    builder.add_instance(3, "top.a.x");
+    builder.add_instance(4, "top.a.y");
+    builder.add_instance(5, "top.a.x.z[0].w");
+    builder.add_child(0, "b");
+    builder.add_child(0, "a");
+    builder.add_child(2, "y");
+    builder.add_child(2, "x");
+    builder.add_child(3, "z[0].w");
+    auto info = builder.build();
+    // children are sorted by name
+    auto children = info.get_children(0);
+    ASSERT_EQ(children.size, 2);
+    EXPECT_EQ(info.str(children[0].name), "a");
+    EXPECT_EQ(children[0].child_id, 2);
+    EXPECT_EQ(info.get_subtree_size(0), 6);
+    EXPECT_EQ(info.get_subtree_size(2), 4);
+    EXPECT_EQ(info.get_subtree_size(1), 1);
+    EXPECT_EQ(info.find_instance("top.a.y"), 4);
+    EXPECT_EQ(info.find_instance("top.a.x.z[0].w"), 5);
+    EXPECT_FALSE(info.find_instance("top.c"));
+    EXPECT_EQ(info.search_instances("top.a", 10).size(), 4);
+    EXPECT_EQ(info.search_instances("top.a", 2).size(), 2);
+    auto ids = info.search_instances("top.a.?", 10);
+    ASSERT_EQ(ids.size(), 2);
+    EXPECT_EQ(ids[0], 3);
+    EXPECT_EQ(ids[1], 4);
+    EXPECT_TRUE(DebugInfo::glob_match("top.*.w", "top.a.x.z[0].w"));
+    EXPECT_FALSE(DebugInfo::glob_match("top.?", "top.ab"));
+}
+
+TEST(debug_info, nets) {  // NOLINT
+    DebugInfoBuilder builder;
+    builder.set_top_name("top");
+    builder.add_instance(0, "top");
+    builder.add_instance(1, "top.a");
+    builder.add_instance(2, "top.b");
+    builder.add_instance(3, "top.c");
+    builder.add_child(0, "a");
+    builder.add_child(0, "b");
+    builder.add_child(0, "c");
+    // a.out fans out to b and, through the parent, to c
+    builder.add_connection(1, "out", 2, "in");
+    builder.add_connection(1, "out", 0, "x");
+    builder.add_connection(0, "x", 3, "in");
+    builder.add_connection(2, "out", 1, "in");
+    auto info = builder.build();
+
+    auto nets = info.compute_nets("");
+    ASSERT_EQ(nets.size(), 2);
+    EXPECT_EQ(nets[0].driver, "top.a.out");
+    EXPECT_EQ(nets[0].handles,
+              std::vector<std::string>({"top.a.out", "top.b.in", "top.x", "top.c.in"}));
+    EXPECT_EQ(nets[1].driver, "top.b.out");
+    EXPECT_EQ(nets[1].handles, std::vector<std::string>({"top.b.out", "top.a.in"}));
+    EXPECT_EQ(info.compute_nets("top").size(), 2);
+    // no children, so no connections
+    EXPECT_TRUE(info.compute_nets("top.a").empty());
+    EXPECT_TRUE(info.compute_nets("top.d").empty());
+}
+
+TEST(debug_info, cache) {  // NOLINT
+    TempFile file("test_debug_info", ".kdbg");
+    auto const &filename = file.path();
+    {
+        auto info = build_info();
+        EXPECT_TRUE(info.write_cache(filename));
+    }
+    // mismatched key
+    EXPECT_FALSE(DebugInfo::open_cache(filename, 0));
+    auto info = DebugInfo::open_cache(filename, 42);
+    ASSERT_TRUE(info);
+    EXPECT_EQ(info->key(), 42);
+    EXPECT_EQ(info->get_breakpoints("/tmp/a.py", 10).size, 2);
+    EXPECT_EQ(info->get_top_name(), "top");
+    auto const *frame = info->get_frame(1, 0);
+    ASSERT_NE(frame, nullptr);
+    EXPECT_EQ(info->str(info->get_context_variables(*frame)[1].name), "self.b");
+    std::filesystem::remove(filename);
+    // corrupted file
+    {
+        std::ofstream stream(filename);
+        stream << "KRATOSDI";
+    }
+    EXPECT_FALSE(DebugInfo::open_cache(filename, 42));
+}
+
+TEST(debug_info, cache_corrupt) {  // NOLINT
+    TempFile file("test_debug_info_corrupt", ".kdbg");
+    auto const &filename = file.path();
+    EXPECT_TRUE(build_info().write_cache(filename));
+    std::string content;
+    {
+        std::ifstream stream(filename, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(stream), {});
+    }
+    // the section table follows the 24-byte magic, version, count and size fields. every entry
+    // is a 64-bit offset and size
+    auto section_offset = [&](uint32_t section) {
+        uint64_t offset;
+        std::memcpy(&offset, content.data() + 24 + section * 16, sizeof(offset));
+        return offset;
+    };
+    auto corrupt = [&](uint64_t offset, uint32_t value) {
+        auto copy = content;
+        std::memcpy(copy.data() + offset, &value, sizeof(value));
+        std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+        stream.write(copy.data(), static_cast<std::streamsize>(copy.size()));
+    };
+    // string size of the first instance name, which is past the string section
+    corrupt(section_offset(1) + 8, 0xFFFF);
+    EXPECT_FALSE(DebugInfo::open_cache(filename, 42));
+    // end of the first file's line range
+    corrupt(section_offset(7) + 12, 100);
+    EXPECT_FALSE(DebugInfo::open_cache(filename, 42));
+    // index into the connection array
+    corrupt(section_offset(16), 1);
+    EXPECT_FALSE(DebugInfo::open_cache(filename, 42));
+    // untouched content still loads
+    corrupt(0, *reinterpret_cast<const uint32_t *>(content.data()));
+    EXPECT_TRUE(DebugInfo::open_cache(filename, 42));
+}
@@ -0,0 +1,108 @@
+#include <chrono>
+
+#include "gtest/gtest.h"
+#include "../src/event.hh"
+#include "vpi_impl.hh"
+
+class EventTest : public ::testing::Test {
+protected:
+    EventSender::Transport transport(bool slow = false) {
+        return [this, slow](const Event &event) {
+            if (slow) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            std::lock_guard guard(lock);
+            events.emplace_back(event);
+        };
+    }
+
+    std::mutex lock;
+    std::vector<Event> events;
+};
+
+TEST_F(EventTest, block) {  // NOLINT
+    {
+        EventSender sender(transport(), 2, BackpressurePolicy::Block);
+        for (int i = 0; i < 100; i++) {
+            sender.send(Event{"/value", std::to_string(i), "text/plain", "a"});
+        }
+    }
+    ASSERT_EQ(events.size(), 100);
+    for (int i = 0; i < 100; i++) EXPECT_EQ(events[i].content, std::to_string(i));
+}
+
+TEST_F(EventTest, coalesce) {  // NOLINT
+    EventSender sender(transport(true), 16, BackpressurePolicy::Coalesce);
+    for (int i = 0; i < 100; i++) {
+        sender.send(Event{"/value", std::to_string(i), "text/plain", "a"});
+    }
+    sender.send(Event{"/status/breakpoint", "", "text/plain"});
+    sender.send(Event{"/value", "100", "text/plain", "a"});
+    sender.flush();
+    auto stats = sender.stats();
+    EXPECT_GT(stats.coalesced, 0);
+    EXPECT_EQ(stats.dropped, 0);
+    ASSERT_GE(events.size(), 3);
+    // values are never coalesced across other events
+    auto const &n = events.size();
+    EXPECT_EQ(events[n - 3].content, "99");
+    EXPECT_EQ(events[n - 2].path, "/status/breakpoint");
+    EXPECT_EQ(events[n - 1].content, "100");
+}
+
+TEST_F(EventTest, drop_oldest) {  // NOLINT
+    EventSender sender(transport(true), 2, BackpressurePolicy::DropOldest);
+    sender.send(Event{"/status/breakpoint", "", "text/plain"});
+    for (int i = 0; i < 100; i++) {
+        sender.send(Event{"/value", std::to_string(i), "text/plain", std::to_string(i)});
+    }
+    sender.send(Event{"/stop", "", "text/plain"});
+    sender.flush();
+    EXPECT_GT(sender.stats().dropped, 0);
+    // events without a key are always delivered
+    EXPECT_EQ(events.front().path, "/status/breakpoint");
+    EXPECT_EQ(events.back().path, "/stop");
+    EXPECT_EQ(events[events.size() - 2].content, "99");
+}
+
+TEST_F(EventTest, is_pending) {  // NOLINT
+    std::mutex block;
+    block.lock();
+    EventSender sender(
+        [&](const Event &) {
+            std::lock_guard guard(block);
+        },
+        4, BackpressurePolicy::Coalesce);
+    // the first event is taken by the sender thread right away
+    sender.send(Event{"/status/breakpoint", "", "text/plain"});
+    sender.send(Event{"/values", "", "application/json", "/values"});
+    EXPECT_TRUE(sender.is_pending("/values"));
+    EXPECT_FALSE(sender.is_pending("/value"));
+    block.unlock();
+    sender.flush();
+    EXPECT_FALSE(sender.is_pending("/values"));
+}
+
+TEST(event_stream, poll) {  // NOLINT
+    EventStream stream(2);
+    auto batch = stream.poll(0, std::chrono::milliseconds(0));
+    EXPECT_TRUE(batch.events.empty());
+    EXPECT_EQ(batch.next_seq, 0);
+    for (int i = 0; i < 3; i++) stream.publish(Event{"/value", std::to_string(i), "text/plain"});
+    batch = stream.poll(0, std::chrono::milliseconds(0));
+    // the first event is evicted
+    EXPECT_TRUE(batch.missed);
+    ASSERT_EQ(batch.events.size(), 2);
+    EXPECT_EQ(batch.events[0].event.content, "1");
+    EXPECT_EQ(batch.next_seq, 3);
+    batch = stream.poll(2, std::chrono::milliseconds(0));
+    EXPECT_FALSE(batch.missed);
+    ASSERT_EQ(batch.events.size(), 1);
+    // wake up by a new event
+    auto thread = std::thread([&]() { stream.publish(Event{"/stop", "", "text/plain"}); });
+    batch = stream.poll(3, std::chrono::seconds(10));
+    thread.join();
+    ASSERT_EQ(batch.events.size(), 1);
+    EXPECT_EQ(batch.events[0].seq, 3);
+    stream.close();
+    batch = stream.poll(4, std::chrono::seconds(10));
+    EXPECT_TRUE(batch.events.empty());
+}
@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "../src/golden.hh"
+#include "vpi_impl.hh"
+
+CaptureData build_trace() {
+    // 3 rows of 10 signals where signal i is i * row
+    CaptureData data;
+    for (uint64_t i = 0; i < 10; i++) {
+        data.names.emplace_back("TOP.s" + std::to_string(i));
+        data.widths.emplace_back(32);
+    }
+    data.times = {0, 10, 20};
+    for (uint64_t i = 0; i < 10; i++) {
+        for (uint64_t row = 0; row < 3; row++) data.values.emplace_back(i * row);
+    }
+    return data;
+}
+
+TEST(golden, match) {  // NOLINT
+    GoldenTrace trace(build_trace());
+    EXPECT_EQ(trace.num_rows(), 3);
+    std::vector<GoldenMismatch> mismatches;
+    std::vector<uint64_t> unknown(10, 0);
+    for (uint64_t row = 0; row < 3; row++) {
+        EXPECT_EQ(trace.expected_time(), row * 10);
+        std::vector<uint64_t> values;
+        for (uint64_t i = 0; i < 10; i++) values.emplace_back(i * row);
+        EXPECT_TRUE(trace.check(values, unknown, mismatches));
+    }
+    EXPECT_TRUE(mismatches.empty());
+    EXPECT_TRUE(trace.done());
+    EXPECT_FALSE(trace.check(std::vector<uint64_t>(10, 0), unknown, mismatches));
+}
+
+TEST(golden, mismatch) {  // NOLINT
+    GoldenTrace trace(build_trace());
+    std::vector<GoldenMismatch> mismatches;
+    std::vector<uint64_t> unknown(10, 0);
+    EXPECT_TRUE(trace.check(std::vector<uint64_t>(10, 0), unknown, mismatches));
+    EXPECT_TRUE(mismatches.empty());
+    std::vector<uint64_t> values;
+    for (uint64_t i = 0; i < 10; i++) values.emplace_back(i);
+    values[9] = 42;
+    EXPECT_TRUE(trace.check(values, unknown, mismatches));
+    ASSERT_EQ(mismatches.size(), 1);
+    EXPECT_EQ(mismatches[0].signal, 9);
+    EXPECT_EQ(mismatches[0].expected, 9);
+    EXPECT_EQ(mismatches[0].actual, 42);
+    EXPECT_EQ(trace.cycle(), 2);
+}
+
+TEST(golden, unknown) {  // NOLINT
+    GoldenTrace trace(build_trace());
+    std::vector<GoldenMismatch> mismatches;
+    // an X or Z reads as 0 in aval, which the first row expects
+    std::vector<uint64_t> unknown(10, 0);
+    unknown[3] = 0b100;
+    EXPECT_TRUE(trace.check(std::vector<uint64_t>(10, 0), unknown, mismatches));
+    ASSERT_EQ(mismatches.size(), 1);
+    EXPECT_EQ(mismatches[0].signal, 3);
+    EXPECT_EQ(mismatches[0].expected, 0);
+    EXPECT_EQ(mismatches[0].actual, 0);
+    EXPECT_EQ(mismatches[0].unknown, 0b100);
+
+    // value mismatches and unknown bits are reported once per signal, in order
+    mismatches.clear();
+    std::vector<uint64_t> values;
+    for (uint64_t i = 0; i < 10; i++) values.emplace_back(i);
+    values[1] = 42;
+    values[5] = 42;
+    unknown[3] = 0;
+    unknown[5] = 1;
+    unknown[7] = 1;
+    EXPECT_TRUE(trace.check(values, unknown, mismatches));
+    ASSERT_EQ(mismatches.size(), 3);
+    EXPECT_EQ(mismatches[0].signal, 1);
+    EXPECT_EQ(mismatches[1].signal, 5);
+    EXPECT_EQ(mismatches[2].signal, 7);
+    EXPECT_EQ(mismatches[2].unknown, 1);
+}
+
+TEST(golden, mask) {  // NOLINT
+    // values saved sign-extended are compared within their width
+    auto data = build_trace();
+    data.values[0] = ~uint64_t(0);
+    GoldenTrace trace(std::move(data));
+    std::vector<GoldenMismatch> mismatches;
+    std::vector<uint64_t> values(10, 0);
+    values[0] = 0xFFFFFFFF;
+    EXPECT_TRUE(trace.check(values, std::vector<uint64_t>(10, 0), mismatches));
+    EXPECT_TRUE(mismatches.empty());
+}
@@ -0,0 +1,79 @@
+#include <filesystem>
+#include <fstream>
+
+#include "gtest/gtest.h"
+#include "../src/journal.hh"
+#include "temp_file.hh"
+#include "vpi_impl.hh"
+
+TEST(journal, write) {  // NOLINT
+    TempFile file("test_journal", ".db");
+    auto const &filename = file.path();
+    constexpr uint64_t num_hits = BreakpointJournal::BATCH_SIZE + 10;
+    {
+        BreakpointJournal journal;
+        ASSERT_TRUE(journal.open(filename));
+        for (uint64_t i = 0; i < num_hits; i++) {
+            auto line_num = static_cast<uint32_t>(i % 4 + 1);
+            std::string frame;
+            if (line_num == 2) frame = R"({"local": [["addr", ")" + std::to_string(i) + R"("]]})";
+            journal.add(BreakpointHit{i * 10, 1, line_num, "test.py", line_num, frame});
+        }
+        journal.flush();
+        EXPECT_EQ(journal.size(), num_hits);
+        // the journal can be read while it's written
+        SQLiteConnection conn(filename);
+        Query query(conn.statement("count", "SELECT COUNT(*) FROM hit"));
+        ASSERT_TRUE(query.next());
+        EXPECT_EQ(query.integer(0), num_hits);
+    }
+    {
+        SQLiteConnection conn(filename);
+        // all the hits of a line with a given local value
+        Query query(conn.statement(
+            "addr", "SELECT time, json_extract(frame, '$.local[0][1]') FROM hit "
+                    "WHERE filename = 'test.py' AND line_num = 2 AND frame IS NOT NULL "
+                    "ORDER BY time LIMIT 2"));
+        ASSERT_TRUE(query.next());
+        EXPECT_EQ(query.integer(0), 10);
+        EXPECT_EQ(query.text(1), "1");
+        ASSERT_TRUE(query.next());
+        EXPECT_EQ(query.integer(0), 50);
+
+        Query null_frames(conn.statement("null", "SELECT COUNT(*) FROM hit WHERE frame IS NULL"));
+        ASSERT_TRUE(null_frames.next());
+        EXPECT_EQ(null_frames.integer(0), num_hits - (num_hits + 2) / 4);
+    }
+}
+
+TEST(journal, replace) {  // NOLINT
+    TempFile file("test_journal_replace", ".db");
+    auto const &filename = file.path();
+    {
+        std::ofstream stream(filename);
+        stream << "results";
+    }
+    // other files are never deleted
+    EXPECT_FALSE(BreakpointJournal().open(filename));
+    {
+        std::ifstream stream(filename);
+        std::string content;
+        stream >> content;
+        EXPECT_EQ(content, "results");
+    }
+    std::filesystem::remove(filename);
+    {
+        BreakpointJournal journal;
+        ASSERT_TRUE(journal.open(filename));
+        journal.add(BreakpointHit{10, 1, 1, "test.py", 1, ""});
+    }
+    // the journal of a previous run is replaced
+    {
+        BreakpointJournal journal;
+        ASSERT_TRUE(journal.open(filename));
+    }
+    SQLiteConnection conn(filename);
+    Query query(conn.statement("count", "SELECT COUNT(*) FROM hit"));
+    ASSERT_TRUE(query.next());
+    EXPECT_EQ(query.integer(0), 0);
+}
@@ -39,6 +39,21 @@ def test_verilator_continue():
         debugger.wait_till_finish()
 
 
+def test_verilator_socket(monkeypatch):
+    file = get_file_path("verilator/test.sv")
+    tb_file = get_file_path("verilator/test.cc")
+    with tempfile.TemporaryDirectory() as temp:
+        socket_path = os.path.join(temp, "kratos.sock")
+        monkeypatch.setenv("KRATOS_SOCKET", socket_path)
+        with VerilatorTester(tb_file, file) as tester:
+            tester.run()
+            debugger = DebuggerMock(socket_path=socket_path)
+            debugger.connect()
+            assert debugger.is_paused()
+            debugger.continue_()
+            debugger.wait_till_finish()
+
+
 @pytest.mark.skipif(not use_ncsim, reason="NCSim not available")
 def test_ncsim_continue():
     files = [get_file_path("ncsim/test.sv"), get_file_path("ncsim/test_tb.sv")]
@@ -0,0 +1,199 @@
+#include "gtest/gtest.h"
+#include "../src/monitor.hh"
+#include "vpi_impl.hh"
+
+PLI_INT32 monitor_callback(p_cb_data) { return 0; }
+
+TEST(monitor, add_remove) {  // NOLINT
+    MonitorRegistry registry(monitor_callback);
+    uint32_t handle = 0;
+    auto a = registry.add("TOP.a", &handle);
+    auto b = registry.add("TOP.b", &handle);
+    ASSERT_TRUE(a && b);
+    EXPECT_NE(*a, *b);
+    // monitoring the same signal twice returns the same id
+    EXPECT_EQ(registry.add("TOP.a", &handle), a);
+    EXPECT_EQ(registry.size(), 2);
+    EXPECT_EQ(registry.get_name(*b), "TOP.b");
+
+    EXPECT_EQ(registry.remove("TOP.a"), a);
+    EXPECT_FALSE(registry.remove("TOP.a"));
+    EXPECT_FALSE(registry.find("TOP.a"));
+    EXPECT_TRUE(registry.get_name(*a).empty());
+    // the id is reused
+    EXPECT_EQ(registry.add("TOP.c", &handle), a);
+    EXPECT_EQ(registry.get_name(*a), "TOP.c");
+
+    registry.clear();
+    EXPECT_EQ(registry.size(), 0);
+}
+
+TEST(monitor, callback_id) {  // NOLINT
+    MonitorRegistry registry(monitor_callback);
+    uint32_t handle = 0;
+    for (uint32_t i = 0; i < 1000; i++) {
+        auto id = registry.add("TOP.reg_file." + std::to_string(i), &handle);
+        ASSERT_TRUE(id);
+        s_cb_data cb_data{};
+        cb_data.user_data = reinterpret_cast<PLI_BYTE8 *>(static_cast<uintptr_t>(*id));
+        EXPECT_EQ(MonitorRegistry::get_id(&cb_data), *id);
+    }
+    EXPECT_EQ(registry.size(), 1000);
+}
+
+TEST(monitor, find_changes) {  // NOLINT
+    std::vector<uint64_t> previous(100, 0);
+    auto current = previous;
+    std::vector<uint32_t> changes;
+    find_changes(previous.data(), current.data(), 100, changes);
+    EXPECT_TRUE(changes.empty());
+    // in a full block and in the remainder
+    current[3] = 1;
+    current[9] = 1ull << 63u;
+    current[99] = 42;
+    find_changes(previous.data(), current.data(), 100, changes);
+    EXPECT_EQ(changes, std::vector<uint32_t>({3, 9, 99}));
+}
+
+TEST(monitor, poll) {  // NOLINT
+    MonitorRegistry registry(monitor_callback);
+    registry.set_mode(MonitorMode::Poll);
+    std::vector<uint32_t> signals(20, 0);
+    auto group = registry.add_group();
+    std::vector<uint32_t> ids;
+    for (uint32_t i = 0; i < signals.size(); i++) {
+        auto id = registry.add("TOP.reg_file." + std::to_string(i), &signals[i], group);
+        ASSERT_TRUE(id);
+        EXPECT_TRUE(registry.is_polling(*id));
+        ids.emplace_back(*id);
+    }
+    std::vector<std::pair<uint32_t, int64_t>> changes;
+    registry.sample(changes);
+    EXPECT_TRUE(changes.empty());
+
+    signals[5] = 1;
+    signals[17] = 2;
+    registry.sample(changes);
+    using Changes = std::vector<std::pair<uint32_t, int64_t>>;
+    EXPECT_EQ(changes, Changes({{ids[5], 1}, {ids[17], 2}}));
+    changes.clear();
+    registry.sample(changes);
+    EXPECT_TRUE(changes.empty());
+
+    // removing a monitor moves the last one in its place
+    registry.remove("TOP.reg_file.5");
+    signals[19] = 3;
+    registry.sample(changes);
+    EXPECT_EQ(changes, Changes({{ids[19], 3}}));
+}
+
+TEST(monitor, auto_mode) {  // NOLINT
+    MonitorRegistry registry(monitor_callback);
+    std::vector<uint32_t> signals(4, 0);
+    auto group = registry.add_group();
+    std::vector<uint32_t> ids;
+    for (uint32_t i = 0; i < signals.size(); i++) {
+        ids.emplace_back(*registry.add("TOP.data." + std::to_string(i), &signals[i], group));
+    }
+    EXPECT_FALSE(registry.is_polling(ids[0]));
+
+    // every signal changes at every clock edge
+    std::vector<std::pair<uint32_t, int64_t>> changes;
+    for (uint32_t i = 0; i < MonitorRegistry::SAMPLE_WINDOW; i++) {
+        for (auto id : ids) registry.record_change(id);
+        registry.sample(changes);
+    }
+    EXPECT_TRUE(registry.is_polling(ids[0]));
+
+    // the signals stop changing
+    for (uint32_t i = 0; i < MonitorRegistry::SAMPLE_WINDOW; i++) {
+        registry.sample(changes);
+    }
+    EXPECT_TRUE(changes.empty());
+    EXPECT_FALSE(registry.is_polling(ids[0]));
+}
+
+TEST(monitor, group) {  // NOLINT
+    MonitorRegistry registry(monitor_callback);
+    std::vector<uint32_t> signals(10, 0);
+    auto single = registry.add("TOP.a", &signals[0]);
+    auto group = registry.add_group(true);
+    std::vector<uint32_t> ids;
+    for (uint32_t i = 1; i < signals.size(); i++) {
+        ids.emplace_back(*registry.add("TOP.block." + std::to_string(i), &signals[i], group));
+    }
+    EXPECT_EQ(registry.get_report_group(*single), MonitorRegistry::DEFAULT_GROUP);
+    EXPECT_EQ(registry.get_report_group(ids[0]), group);
+
+    // disabled groups drop their changes
+    std::vector<std::pair<uint32_t, int64_t>> changes;
+    EXPECT_TRUE(registry.set_group_enabled(group, false, changes));
+    EXPECT_FALSE(registry.record_change(ids[0]));
+    EXPECT_TRUE(registry.record_change(*single));
+    EXPECT_TRUE(registry.set_group_enabled(group, true, changes));
+    EXPECT_TRUE(registry.record_change(ids[0]));
+
+    EXPECT_EQ(registry.remove_group(group).size(), ids.size());
+    EXPECT_EQ(registry.size(), 1);
+    EXPECT_FALSE(registry.find("TOP.block.1"));
+    EXPECT_FALSE(registry.set_group_enabled(group, true, changes));
+    EXPECT_FALSE(registry.record_change(ids[0]));
+}
+
+TEST(monitor, disabled_poll) {  // NOLINT
+    MonitorRegistry registry(monitor_callback);
+    registry.set_mode(MonitorMode::Poll);
+    uint32_t signal = 0;
+    auto group = registry.add_group(true);
+    auto id = registry.add("TOP.a", &signal, group);
+    std::vector<std::pair<uint32_t, int64_t>> changes;
+    registry.set_group_enabled(group, false, changes);
+    signal = 1;
+    registry.sample(changes);
+    EXPECT_TRUE(changes.empty());
+    // the change is reported once the group is enabled again, and only once
+    registry.set_group_enabled(group, true, changes);
+    registry.sample(changes);
+    EXPECT_EQ(changes, (std::vector<std::pair<uint32_t, int64_t>>{{*id, 1}}));
+}
+
+TEST(monitor, disabled_callback) {  // NOLINT
+    MonitorRegistry registry(monitor_callback);
+    registry.set_mode(MonitorMode::Callback);
+    uint32_t a = 0;
+    uint32_t b = 2;
+    auto group = registry.add_group(true);
+    auto id_a = registry.add("TOP.a", &a, group);
+    auto id_b = registry.add("TOP.b", &b, group);
+    ASSERT_TRUE(id_a && id_b);
+    std::vector<std::pair<uint32_t, int64_t>> changes;
+    registry.set_group_enabled(group, false, changes);
+    a = 1;
+    EXPECT_FALSE(registry.record_change(*id_a));
+    // the callback was dropped, so the signal is read when the group is enabled again
+    EXPECT_TRUE(registry.set_group_enabled(group, true, changes));
+    EXPECT_EQ(changes, (std::vector<std::pair<uint32_t, int64_t>>{{*id_a, 1}}));
+    // nothing changed since
+    changes.clear();
+    registry.set_group_enabled(group, false, changes);
+    registry.set_group_enabled(group, true, changes);
+    EXPECT_TRUE(changes.empty());
+}
+
+TEST(monitor, wide_poll) {  // NOLINT
+    MonitorRegistry registry(monitor_callback);
+    registry.set_mode(MonitorMode::Poll);
+    // signals are read up to 64 bits
+    signal_size = 72;
+    auto id = registry.add("TOP.wide", &v);
+    signal_size = 32;
+    ASSERT_TRUE(id);
+    EXPECT_EQ(registry.get_width(*id), 64);
+    vec[0] = {0x89ABCDEF, 0};
+    vec[1] = {0x01234567, 0};
+    std::vector<std::pair<uint32_t, int64_t>> changes;
+    registry.sample(changes);
+    EXPECT_EQ(changes, (std::vector<std::pair<uint32_t, int64_t>>{{*id, 0x0123456789ABCDEF}}));
+    vec[0] = {};
+    vec[1] = {};
+}
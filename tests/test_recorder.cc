@@ -0,0 +1,224 @@
+#include <filesystem>
+#include <limits>
+
+#include "gtest/gtest.h"
+#include "../src/recorder.hh"
+#include "temp_file.hh"
+#include "vpi_impl.hh"
+
+TEST(recorder, encode) {  // NOLINT
+    ChangeBlock block;
+    block.first_signal = 3;
+    block.names = {"TOP.a", "TOP.b"};
+    block.widths = {1, 64};
+    block.changes = {{10, 3, 1},
+                     {10, 4, -1},
+                     {25, 3, std::numeric_limits<int64_t>::max()},
+                     {1ull << 40u, 4, std::numeric_limits<int64_t>::min()}};
+    auto data = encode_change_block(block);
+    auto result = decode_change_block(data);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->first_signal, 3);
+    EXPECT_EQ(result->names, block.names);
+    EXPECT_EQ(result->widths, block.widths);
+    ASSERT_EQ(result->changes.size(), block.changes.size());
+    for (uint64_t i = 0; i < block.changes.size(); i++) {
+        EXPECT_EQ(result->changes[i].time, block.changes[i].time);
+        EXPECT_EQ(result->changes[i].signal, block.changes[i].signal);
+        EXPECT_EQ(result->changes[i].value, block.changes[i].value);
+    }
+    // truncated
+    EXPECT_FALSE(decode_change_block(data.substr(0, data.size() - 1)));
+}
+
+TEST(recorder, query) {  // NOLINT
+    TempFile file("test_recorder", ".kwave");
+    auto const &filename = file.path();
+    {
+        WaveformRecorder recorder;
+        ASSERT_TRUE(recorder.open(filename));
+        // a changes at every time step and b only every 1000, so b spans several blocks
+        constexpr uint64_t num_steps = WaveformRecorder::BLOCK_SIZE * 3;
+        for (uint64_t time = 0; time < num_steps; time++) {
+            recorder.record("TOP.a", time, static_cast<int64_t>(time % 7), 32);
+            if (time % 1000 == 0) {
+                recorder.record("TOP.b", time, static_cast<int64_t>(time), 32);
+            }
+        }
+        // queries work before the blocks are written
+        EXPECT_EQ(recorder.get_value("TOP.a", 100), 100 % 7);
+        recorder.flush();
+        EXPECT_EQ(recorder.get_value("TOP.a", num_steps - 1), (num_steps - 1) % 7);
+        EXPECT_EQ(recorder.get_value("TOP.b", 0), 0);
+        EXPECT_EQ(recorder.get_value("TOP.b", 4500), 4000);
+        EXPECT_EQ(recorder.get_value("TOP.b", num_steps), 12000);
+        EXPECT_FALSE(recorder.get_value("TOP.c", 10));
+
+        auto changes = recorder.get_changes("TOP.b", 500, 9000);
+        std::vector<std::pair<uint64_t, int64_t>> expected;
+        for (uint64_t time = 1000; time <= 9000; time += 1000) {
+            expected.emplace_back(time, static_cast<int64_t>(time));
+        }
+        EXPECT_EQ(changes, expected);
+        EXPECT_EQ(recorder.get_changes("TOP.a", 4090, 4100).size(), 11);
+        EXPECT_TRUE(recorder.get_changes("TOP.b", 12001, 20000).empty());
+    }
+}
+
+TEST(recorder, summary) {  // NOLINT
+    SummaryPyramid pyramid;
+    // one change every 1024 time units over 2^20
+    for (uint64_t time = 0; time < (1u << 20u); time += 1024) {
+        pyramid.add(time, static_cast<int64_t>(time >> 10u));
+    }
+    EXPECT_FALSE(SummaryPyramid::get_level(100));
+    auto level = SummaryPyramid::get_level(1u << 16u);
+    ASSERT_TRUE(level);
+    auto buckets = pyramid.get_buckets(*level, 0, (1u << 20u) - 1);
+    ASSERT_EQ(buckets.size(), 16);
+    EXPECT_EQ(buckets[1].time, 1u << 16u);
+    EXPECT_EQ(buckets[1].width, 1u << 16u);
+    EXPECT_EQ(buckets[1].count, 64);
+    EXPECT_EQ(buckets[1].min, 64);
+    EXPECT_EQ(buckets[1].max, 127);
+    EXPECT_EQ(buckets[1].last, 127);
+    // only the buckets that overlap the range
+    EXPECT_EQ(pyramid.get_buckets(*level, 70000, 140000).size(), 2);
+
+    // only the coarse levels stay after the fine ones are taken
+    auto fine = pyramid.take_fine_buckets();
+    EXPECT_EQ(fine[0].size(), 256);
+    EXPECT_EQ(fine[1].size(), 16);
+    EXPECT_TRUE(pyramid.get_buckets(0, 0, (1u << 20u) - 1).empty());
+    EXPECT_EQ(pyramid.get_buckets(SummaryPyramid::FINE_LEVELS, 0, (1u << 20u) - 1).size(), 1);
+    auto data = encode_block_summary({SignalSummary{2, fine}});
+    auto summaries = decode_block_summary(data);
+    ASSERT_TRUE(summaries);
+    ASSERT_EQ(summaries->size(), 1);
+    EXPECT_EQ((*summaries)[0].signal, 2);
+    ASSERT_EQ((*summaries)[0].levels[1].size(), 16);
+    EXPECT_EQ((*summaries)[0].levels[1][1].time, buckets[1].time);
+    EXPECT_EQ((*summaries)[0].levels[1][1].width, buckets[1].width);
+    EXPECT_EQ((*summaries)[0].levels[1][1].count, buckets[1].count);
+    EXPECT_EQ((*summaries)[0].levels[1][1].last, buckets[1].last);
+    EXPECT_FALSE(decode_block_summary(data.substr(0, data.size() - 1)));
+}
+
+TEST(recorder, get_summary) {  // NOLINT
+    TempFile file("test_recorder_summary", ".kwave");
+    auto const &filename = file.path();
+    {
+        WaveformRecorder recorder;
+        ASSERT_TRUE(recorder.open(filename));
+        for (uint64_t time = 0; time < 100000; time += 10) {
+            recorder.record("TOP.a", time, static_cast<int64_t>(time % 3), 32);
+        }
+        // coarse queries use the pyramid
+        auto buckets = recorder.get_summary("TOP.a", 0, 99999, 10);
+        EXPECT_LE(buckets.size(), 11);
+        uint64_t count = 0;
+        for (auto const &bucket : buckets) count += bucket.count;
+        EXPECT_EQ(count, 10000);
+        // fine queries are summarized from the changes
+        buckets = recorder.get_summary("TOP.a", 1000, 1099, 5);
+        ASSERT_EQ(buckets.size(), 5);
+        EXPECT_EQ(buckets[0].time, 1000);
+        EXPECT_EQ(buckets[0].width, 20);
+        EXPECT_EQ(buckets[0].count, 2);
+        EXPECT_TRUE(recorder.get_summary("TOP.b", 0, 100, 10).empty());
+    }
+}
+
+TEST(recorder, fine_summary) {  // NOLINT
+    // fine buckets move into the blocks when they are sealed, so they are checked against
+    // buckets computed from the changes while blocks are queued, written and loaded. the
+    // offset puts the block boundaries inside buckets
+    constexpr uint64_t step = 7;
+    constexpr uint64_t offset = 1000;
+    constexpr uint64_t num_steps = WaveformRecorder::BLOCK_SIZE * 3 + 100;
+    constexpr uint64_t width = uint64_t(1) << SummaryPyramid::BASE_SHIFT;
+    std::vector<SummaryBucket> expected;
+    for (uint64_t i = 0; i < num_steps; i++) {
+        auto value = static_cast<int64_t>(i % 11) - 5;
+        auto time = offset + i * step;
+        merge_bucket(expected, SummaryBucket{time / width * width, width, value, value, 1, value});
+    }
+    auto check = [&](WaveformRecorder &recorder) {
+        // buckets exactly as wide as the finest level
+        auto num_buckets = static_cast<uint32_t>(expected.size());
+        auto buckets = recorder.get_summary("TOP.a", 0, num_buckets * width - 1, num_buckets);
+        ASSERT_EQ(buckets.size(), expected.size());
+        for (uint64_t i = 0; i < buckets.size(); i++) {
+            EXPECT_EQ(buckets[i].time, expected[i].time);
+            EXPECT_EQ(buckets[i].width, width);
+            EXPECT_EQ(buckets[i].min, expected[i].min);
+            EXPECT_EQ(buckets[i].max, expected[i].max);
+            EXPECT_EQ(buckets[i].count, expected[i].count);
+            EXPECT_EQ(buckets[i].last, expected[i].last);
+        }
+        // a range inside a bucket still returns the whole bucket
+        buckets = recorder.get_summary("TOP.a", width + 1, width * 2, 1);
+        ASSERT_EQ(buckets.size(), 1);
+        EXPECT_EQ(buckets[0].count, expected[1].count);
+    };
+
+    TempFile file("test_recorder_fine", ".kwave");
+    auto const &filename = file.path();
+    {
+        WaveformRecorder recorder;
+        ASSERT_TRUE(recorder.open(filename));
+        for (uint64_t i = 0; i < num_steps; i++) {
+            recorder.record("TOP.a", offset + i * step, static_cast<int64_t>(i % 11) - 5,
+                            32);
+        }
+        check(recorder);
+        recorder.flush();
+        check(recorder);
+    }
+    WaveformRecorder recorder;
+    ASSERT_TRUE(recorder.load(filename));
+    check(recorder);
+    // the coarse levels are rebuilt from the stored buckets
+    auto buckets = recorder.get_summary("TOP.a", 0, offset + num_steps * step, 1);
+    ASSERT_EQ(buckets.size(), 1);
+    EXPECT_EQ(buckets[0].count, num_steps);
+    EXPECT_EQ(buckets[0].min, -5);
+    EXPECT_EQ(buckets[0].max, 5);
+}
+
+TEST(recorder, load) {  // NOLINT
+    TempFile file("test_recorder_load", ".kwave");
+    auto const &filename = file.path();
+    constexpr uint64_t num_steps = WaveformRecorder::BLOCK_SIZE * 2 + 100;
+    {
+        WaveformRecorder recorder;
+        ASSERT_TRUE(recorder.open(filename));
+        for (uint64_t time = 0; time < num_steps; time++) {
+            recorder.record("TOP.a", time * 10, static_cast<int64_t>(time), 32);
+            // b is first seen in the second block
+            if (time > WaveformRecorder::BLOCK_SIZE) {
+                recorder.record("TOP.b", time * 10, 1, 1);
+            }
+        }
+    }
+    WaveformRecorder recorder;
+    ASSERT_TRUE(recorder.load(filename));
+    EXPECT_TRUE(recorder.has_signal("TOP.b"));
+    EXPECT_FALSE(recorder.has_signal("TOP.c"));
+    EXPECT_EQ(recorder.get_width("TOP.a"), 32);
+    EXPECT_EQ(recorder.get_width("TOP.b"), 1);
+    EXPECT_EQ(recorder.get_width("TOP.c"), 0);
+    EXPECT_EQ(recorder.get_value("TOP.a", 12345), 1234);
+    EXPECT_EQ(recorder.get_value("TOP.b", (num_steps - 1) * 10), 1);
+    EXPECT_FALSE(recorder.get_value("TOP.b", 10));
+    EXPECT_EQ(recorder.find_time(0), 0);
+    EXPECT_EQ(recorder.find_time(12341), 12350);
+    EXPECT_FALSE(recorder.find_time(num_steps * 10));
+    EXPECT_EQ(recorder.get_summary("TOP.a", 0, num_steps * 10, 1)[0].count, num_steps);
+    // nothing is recorded into a loaded file
+    recorder.record("TOP.a", num_steps * 10, 0, 32);
+    EXPECT_FALSE(recorder.find_time(num_steps * 10));
+    std::filesystem::remove(filename);
+
+    EXPECT_FALSE(recorder.load(filename));
+}
@@ -0,0 +1,102 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+
+#include "gtest/gtest.h"
+#include "../src/socket.hh"
+#include "vpi_impl.hh"
+
+class SocketTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path = std::filesystem::temp_directory_path() /
+               ("kratos-" + std::to_string(::getpid()) + ".sock");
+        server.Get(R"(/value/([\w.$]+))", [](const httplib::Request &req, httplib::Response &res) {
+            std::string name = req.matches[1];
+            res.set_content(name + req.get_param_value("suffix"), "text/plain");
+        });
+        server.Post("/echo", [](const httplib::Request &req, httplib::Response &res) {
+            res.status = 201;
+            res.set_content(req.body, "text/plain");
+        });
+        ASSERT_TRUE(server.bind(path));
+        thread = std::thread([this]() { server.listen(); });
+    }
+
+    void TearDown() override {
+        server.stop();
+        thread.join();
+        EXPECT_FALSE(std::filesystem::exists(path));
+    }
+
+    int connect() const {
+        auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        EXPECT_EQ(::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+        return fd;
+    }
+
+    static std::string request(int fd, const std::string &content) {
+        EXPECT_EQ(::write(fd, content.data(), content.size()),
+                  static_cast<ssize_t>(content.size()));
+        // read until the whole body arrives
+        std::string result;
+        char buffer[1024];
+        while (true) {
+            auto header_end = result.find("\r\n\r\n");
+            if (header_end != std::string::npos) {
+                auto pos = result.find("Content-Length: ");
+                auto length = std::stoul(result.substr(pos + 16));
+                if (result.size() >= header_end + 4 + length) break;
+            }
+            auto n = ::read(fd, buffer, sizeof(buffer));
+            if (n <= 0) break;
+            result.append(buffer, n);
+        }
+        return result;
+    }
+
+    std::string path;
+    UnixSocketServer server;
+    std::thread thread;
+};
+
+TEST_F(SocketTest, keep_alive) {  // NOLINT
+    auto fd = connect();
+    auto r = request(fd, "GET /value/a.b?suffix=%21 HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    EXPECT_EQ(r.substr(0, 15), "HTTP/1.1 200 OK");
+    EXPECT_EQ(r.substr(r.size() - 4), "a.b!");
+    // same connection
+    r = request(fd, "POST /echo HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello");
+    EXPECT_EQ(r.substr(0, 12), "HTTP/1.1 201");
+    EXPECT_EQ(r.substr(r.size() - 5), "hello");
+    r = request(fd, "GET /missing HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(r.substr(0, 12), "HTTP/1.1 404");
+    ::close(fd);
+}
+
+TEST_F(SocketTest, stop_with_open_connection) {  // NOLINT
+    // stop() must not wait for idle clients
+    auto fd = connect();
+    auto r = request(fd, "GET /value/a HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(r.substr(0, 15), "HTTP/1.1 200 OK");
+    server.stop();
+    ::close(fd);
+}
+
+TEST_F(SocketTest, handle) {  // NOLINT
+    // requests can be dispatched without a connection, e.g. for /batch
+    httplib::Request req;
+    httplib::Response res;
+    req.method = "GET";
+    UnixSocketServer::parse_target("/value/a%2Eb?suffix=+c", req);
+    EXPECT_EQ(req.path, "/value/a.b");
+    server.handle(req, res);
+    EXPECT_EQ(res.status, 200);
+    EXPECT_EQ(res.body, "a.b c");
+}
@@ -0,0 +1,74 @@
+#include <filesystem>
+
+#include "gtest/gtest.h"
+#include "../src/trace.hh"
+#include "temp_file.hh"
+#include "vpi_impl.hh"
+
+TEST(trace, recording) {  // NOLINT
+    TempFile file("test_trace", ".kwave");
+    auto const &filename = file.path();
+    {
+        WaveformRecorder recorder;
+        ASSERT_TRUE(recorder.open(filename));
+        recorder.record("TOP.a", 5, 1, 32);
+        recorder.record("TOP.a", 20, -1, 32);
+        recorder.record("TOP.b", 20, 3, 32);
+    }
+    ReplayTrace trace;
+    ASSERT_TRUE(trace.open(filename));
+    EXPECT_TRUE(trace.has_signal("TOP.a"));
+    EXPECT_FALSE(trace.has_signal("TOP.c"));
+    EXPECT_EQ(trace.get_width("TOP.a"), 32);
+    EXPECT_FALSE(trace.get_value("TOP.a", 4));
+    EXPECT_EQ(trace.get_value("TOP.a", 19), 1);
+    EXPECT_EQ(trace.get_value("TOP.a", 20), -1);
+    EXPECT_EQ(trace.find_time(0), 5);
+    EXPECT_EQ(trace.find_time(6), 20);
+    EXPECT_FALSE(trace.find_time(21));
+}
+
+TEST(trace, recording_width) {  // NOLINT
+    TempFile file("test_trace_width", ".kwave");
+    auto const &filename = file.path();
+    // monitors record up to 64 bits
+    constexpr int64_t wide = (int64_t(1) << 40) + 5;
+    {
+        WaveformRecorder recorder;
+        ASSERT_TRUE(recorder.open(filename));
+        recorder.record("TOP.wide", 5, wide, 48);
+        recorder.record("TOP.bit", 5, 1, 1);
+    }
+    ReplayTrace trace;
+    ASSERT_TRUE(trace.open(filename));
+    EXPECT_EQ(trace.get_width("TOP.wide"), 48);
+    EXPECT_EQ(trace.get_width("TOP.bit"), 1);
+    EXPECT_EQ(trace.get_value("TOP.wide", 5), wide);
+}
+
+TEST(trace, capture) {  // NOLINT
+    TempFile file("test_trace", ".kcap");
+    auto const &filename = file.path();
+    {
+        StateCapture capture;
+        ASSERT_TRUE(capture.open(filename, {"TOP.a", "TOP.b"}, {&v, &v}));
+        for (uint32_t i = 1; i <= 10; i++) {
+            vec[0].aval = i;
+            capture.sample(i * 10);
+        }
+    }
+    ReplayTrace trace;
+    ASSERT_TRUE(trace.open(filename));
+    EXPECT_TRUE(trace.has_signal("TOP.b"));
+    EXPECT_FALSE(trace.has_signal("TOP.c"));
+    EXPECT_EQ(trace.get_width("TOP.b"), 32);
+    EXPECT_FALSE(trace.get_value("TOP.a", 9));
+    EXPECT_EQ(trace.get_value("TOP.b", 35), 3);
+    EXPECT_EQ(trace.get_value("TOP.b", 1000), 10);
+    EXPECT_EQ(trace.find_time(0), 10);
+    EXPECT_EQ(trace.find_time(41), 50);
+    EXPECT_FALSE(trace.find_time(101));
+    std::filesystem::remove(filename);
+
+    EXPECT_FALSE(trace.open(filename));
+}
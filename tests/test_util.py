@@ -28,5 +28,78 @@ def test_dump_icc_report():
         assert os.path.isfile(os.path.join(temp, dst_filename))
 
 
+def test_decode_msgpack():
+    from kratos_runtime.util import decode_msgpack
+    # [["a", 42], ["b", <72-bit value>], ["c", nil]]
+    data = bytes([0x93, 0x92, 0xa1, ord("a"), 42,
+                  0x92, 0xa1, ord("b"), 0xc4, 9, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                  0x92, 0xa1, ord("c"), 0xc0])
+    assert decode_msgpack(data) == [["a", 42], ["b", 0x090807060504030201],
+                                    ["c", None]]
+    data = bytes([0x82, 0xa1, ord("x"), 0xcd, 0x12, 0x34, 0xa1, ord("y"),
+                  0xcb, 0x3f, 0xf8, 0, 0, 0, 0, 0, 0])
+    assert decode_msgpack(data) == {"x": 0x1234, "y": 1.5}
+
+
+def test_read_capture():
+    from kratos_runtime.util import read_capture
+    import struct
+    data = struct.pack("<8sII", b"KRATOSCP", 1, 2)
+    for name in ["TOP.a", "TOP.b"]:
+        data += struct.pack("<II", 32, len(name)) + name.encode()
+    # two chunks
+    data += struct.pack("<II3Q3Q3Q", 3, 0, 0, 10, 20, 1, 2, 3, 4, 5, 6)
+    data += struct.pack("<IIQQQ", 1, 0, 30, 7, 8)
+    with tempfile.TemporaryDirectory() as temp:
+        filename = os.path.join(temp, "state.kcap")
+        with open(filename, "wb") as f:
+            f.write(data)
+        names, times, columns = read_capture(filename)
+    assert names == ["TOP.a", "TOP.b"]
+    assert list(times) == [0, 10, 20, 30]
+    assert list(columns[0]) == [1, 2, 3, 7]
+    assert list(columns[1]) == [4, 5, 6, 8]
+
+
+def test_convert_state():
+    from kratos_runtime.util import convert_state, read_capture
+    import json
+    # dump_state saved 0xFFFFFFFF as -1
+    state = [{"in": {"a": 1}, "reg": {"r": 2}, "out": {"o": 3}},
+             {"in": {"a": 4}, "reg": {"r": -1}, "out": {"o": 6}}]
+    with tempfile.TemporaryDirectory() as temp:
+        state_filename = os.path.join(temp, "state.json")
+        capture_filename = os.path.join(temp, "golden.kcap")
+        with open(state_filename, "w") as f:
+            json.dump(state, f)
+        convert_state(state_filename, capture_filename)
+        names, times, columns = read_capture(capture_filename)
+    assert names == ["a", "r", "o"]
+    assert list(times) == [0, 1]
+    assert [list(c) for c in columns] == [[1, 4], [2, 0xFFFFFFFF], [3, 6]]
+
+
+def test_write_capture():
+    from kratos_runtime.util import write_capture, read_capture
+    import struct
+    with tempfile.TemporaryDirectory() as temp:
+        filename = os.path.join(temp, "golden.kcap")
+        write_capture(filename, ["TOP.a", "TOP.b"], [0, 10],
+                      [[-1, 3], [-2, 0x1FF]], [64, 8])
+        with open(filename, "rb") as f:
+            data = f.read()
+        names, times, columns = read_capture(filename)
+    assert struct.unpack_from("<I", data, 16)[0] == 64
+    assert struct.unpack_from("<I", data, 16 + 8 + 5)[0] == 8
+    assert names == ["TOP.a", "TOP.b"]
+    assert list(times) == [0, 10]
+    assert list(columns[0]) == [(1 << 64) - 1, 3]
+    assert list(columns[1]) == [0xFE, 0xFF]
+
+
 if __name__ == "__main__":
     test_dump_icc_report()
+    test_decode_msgpack()
+    test_read_capture()
+    test_convert_state()
+    test_write_capture()
@@ -0,0 +1,48 @@
+#include "gtest/gtest.h"
+#include "../src/wire.hh"
+#include "vpi_impl.hh"
+
+std::string bytes(std::initializer_list<uint8_t> values) {
+    return std::string(values.begin(), values.end());
+}
+
+TEST(wire, msgpack_uint) {  // NOLINT
+    MsgPackWriter writer;
+    writer.write_uint(1);
+    writer.write_uint(200);
+    writer.write_uint(0x1234);
+    writer.write_uint(0x100000000);
+    EXPECT_EQ(writer.data(),
+              bytes({0x01, 0xcc, 200, 0xcd, 0x12, 0x34, 0xcf, 0, 0, 0, 1, 0, 0, 0, 0}));
+}
+
+TEST(wire, msgpack_value) {  // NOLINT
+    MsgPackWriter writer;
+    writer.write_value(RawValue{8, {42}});
+    // 72-bit value is sent as 9 little-endian bytes
+    writer.write_value(RawValue{72, {0x04030201, 0x08070605, 0xFF09}});
+    EXPECT_EQ(writer.data(), bytes({42, 0xc4, 9, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(wire, msgpack_json) {  // NOLINT
+    MsgPackWriter writer;
+    auto json = json11::Json::object{{"a", 12}, {"b", json11::Json::array{"x", 1.5, nullptr}}};
+    writer.write_json(json);
+    EXPECT_EQ(writer.data(), bytes({0x82, 0xa1, 'a', 12, 0xa1, 'b', 0x93, 0xa1, 'x', 0xcb, 0x3f,
+                                    0xf8, 0, 0, 0, 0, 0, 0, 0xc0}));
+}
+
+TEST(wire, msgpack_json_string) {  // NOLINT
+    // strings are never re-typed, even when they look like numbers
+    MsgPackWriter writer;
+    auto json = json11::Json::array{"12", "-5", "01"};
+    writer.write_json(json);
+    EXPECT_EQ(writer.data(), bytes({0x93, 0xa2, '1', '2', 0xa2, '-', '5', 0xa2, '0', '1'}));
+}
+
+TEST(wire, accept) {  // NOLINT
+    EXPECT_TRUE(accept_msgpack("application/msgpack"));
+    EXPECT_TRUE(accept_msgpack("application/msgpack, application/json;q=0.5"));
+    EXPECT_FALSE(accept_msgpack("application/json"));
+    EXPECT_FALSE(accept_msgpack(""));
+}
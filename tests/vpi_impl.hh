@@ -1,15 +1,55 @@
 #ifndef KRATOS_RUNTIME_VPI_IMPL_HH
 #define KRATOS_RUNTIME_VPI_IMPL_HH
+#include <string>
+#include <vector>
+
 #include "../src/std/vpi_user.h"
 
 // provide dummy implementation
-vpiHandle vpi_register_cb(p_cb_data) { return nullptr; }
-void vpi_get_value(vpiHandle, p_vpi_value v) { v->value.integer = 0; }
+uint32_t v = 0;
+vpiHandle vpi_register_cb(p_cb_data) { return &v; }
+s_vpi_vecval vec[2] = {};
+// size of every signal
+PLI_INT32 signal_size = 32;
+// number of vpi_get_value calls
+uint32_t get_value_calls = 0;
+// handles point to the signal value. vectors of the handle from vpi_handle_by_name are read
+// from vec instead
+void vpi_get_value(vpiHandle handle, p_vpi_value value) {
+    static s_vpi_vecval handle_vec[2] = {};
+    get_value_calls++;
+    if (value->format != vpiVectorVal) {
+        value->value.integer = handle ? static_cast<PLI_INT32>(*handle) : 0;
+    } else if (handle && handle != &v) {
+        handle_vec[0] = {*handle, 0};
+        value->value.vector = handle_vec;
+    } else {
+        value->value.vector = vec;
+    }
+}
+PLI_INT32 vpi_get(PLI_INT32, vpiHandle) { return signal_size; }
 PLI_INT32 vpi_remove_cb(vpiHandle) { return 0; }
 PLI_INT32 vpi_free_object(vpiHandle) { return 0; }
-uint32_t v = 0;
 vpiHandle vpi_handle_by_name(PLI_BYTE8 *, vpiHandle) { return &v; }
+vpiHandle vpi_iterate(PLI_INT32, vpiHandle) { return nullptr; }
+vpiHandle vpi_scan(vpiHandle) { return nullptr; }
+PLI_BYTE8 *vpi_get_str(PLI_INT32, vpiHandle) { return nullptr; }
 void vpi_get_time(vpiHandle, p_vpi_time t) { t->real = 0;}
 PLI_INT32 vpi_control(PLI_INT32, ...) { return 0; }
+// every vpi_put_value call. string values are copied
+struct PutValue {
+    vpiHandle handle;
+    PLI_INT32 format;
+    std::string value;
+    PLI_INT32 flags;
+};
+std::vector<PutValue> put_value_calls;
+vpiHandle vpi_put_value(vpiHandle handle, p_vpi_value value, p_vpi_time, PLI_INT32 flags) {
+    auto is_str = value->format == vpiDecStrVal || value->format == vpiHexStrVal ||
+                  value->format == vpiBinStrVal;
+    put_value_calls.emplace_back(
+        PutValue{handle, value->format, is_str ? value->value.str : "", flags});
+    return nullptr;
+}
 
 #endif  // KRATOS_RUNTIME_VPI_IMPL_HH